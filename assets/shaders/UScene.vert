@@ -43,16 +43,62 @@ layout( std140, set = 1, binding = 0 ) uniform ObjectUBO {
 #define DEFAULT_BONE_COUNT 128
 #endif
 
-layout( constant_id = 0 ) const int kBoneCount = DEFAULT_BONE_COUNT;
+// Bone palette formats (see SceneRenderer::EBonePaletteFormat):
+// 0 - offset and normal 4x4 matrices (4 + 4 vectors per bone),
+// 1 - offset 3x4 matrices (3 vectors per bone), the normal matrices are derived from the blended matrices,
+// 2 - dual quaternions (2 vectors per bone), the real and the dual parts.
+#define BONE_PALETTE_FORMAT_MATRIX4X4 0
+#define BONE_PALETTE_FORMAT_AFFINE3X4 1
+#define BONE_PALETTE_FORMAT_DUAL_QUATERNION 2
+
+layout( constant_id = 0 ) const int kBonePaletteVectorCount = DEFAULT_BONE_COUNT * 4;
+layout( constant_id = 1 ) const int kBonePaletteFormat = BONE_PALETTE_FORMAT_MATRIX4X4;
+layout( constant_id = 2 ) const int kBoneNormalCount = DEFAULT_BONE_COUNT;
+
+#ifdef BONE_PALETTE_SSBO
+// layout( std430, set = 2, binding = 0 ) readonly buffer BoneOffsetsSSBO;
+// layout( std430, set = 2, binding = 1 ) readonly buffer BoneNormalsSSBO;
+// layout( push_constant ) uniform BonePalettePC;
+
+// The palettes of all the skins are in the same storage buffer, the offsets of the skin are pushed per draw.
+layout( std430, set = 2, binding = 0 ) readonly buffer BoneOffsetsSSBO {
+    vec4 BonePalette[];
+};
+
+layout( std430, set = 2, binding = 1 ) readonly buffer BoneNormalsSSBO {
+    mat4 BoneNormalMatrices[];
+};
+
+layout( push_constant ) uniform BonePalettePC {
+    uint BonePaletteOffset; // In vectors.
+    uint BoneNormalOffset;  // In matrices.
+};
 
+vec4 GetBonePaletteVector( int i ) {
+    return BonePalette[ int( BonePaletteOffset ) + i ];
+}
+
+mat4 GetBoneNormalMatrix( int i ) {
+    return BoneNormalMatrices[ int( BoneNormalOffset ) + i ];
+}
+#else
 layout( std140, set = 2, binding = 0 ) uniform BoneOffsetsUBO {
-    mat4 BoneOffsetMatrices[ kBoneCount ];
+    vec4 BonePalette[ kBonePaletteVectorCount ];
 };
 
 layout( std140, set = 2, binding = 1 ) uniform BoneNormalsUBO {
-    mat4 BoneNormalMatrices[ kBoneCount ];
+    mat4 BoneNormalMatrices[ kBoneNormalCount ];
 };
 
+vec4 GetBonePaletteVector( int i ) {
+    return BonePalette[ i ];
+}
+
+mat4 GetBoneNormalMatrix( int i ) {
+    return BoneNormalMatrices[ i ];
+}
+#endif
+
 layout( location = 0 ) in vec3 inPosition;
 layout( location = 1 ) in vec2 inTexcoords;
 layout( location = 2 ) in vec4 inQTangent;
@@ -83,21 +129,26 @@ vec3 GetCameraWorldPosition( ) {
     return InvViewMatrix[ 3 ].xyz;
 }
 
+mat4 GetBoneOffsetMatrix( int boneIndex ) {
+    int i = boneIndex * 4;
+    return mat4( GetBonePaletteVector( i + 0 ), GetBonePaletteVector( i + 1 ), GetBonePaletteVector( i + 2 ), GetBonePaletteVector( i + 3 ) );
+}
+
 mat4 AccumulatedBoneOffsetTransform( vec4 weights, vec4 indices ) {
     mat4 offsetTransform;
-    offsetTransform = BoneOffsetMatrices[ int( indices[ 0 ] ) ] * weights[ 0 ];
-    offsetTransform += BoneOffsetMatrices[ int( indices[ 1 ] ) ] * weights[ 1 ];
-    offsetTransform += BoneOffsetMatrices[ int( indices[ 2 ] ) ] * weights[ 2 ];
-    offsetTransform += BoneOffsetMatrices[ int( indices[ 3 ] ) ] * weights[ 3 ];
+    offsetTransform = GetBoneOffsetMatrix( int( indices[ 0 ] ) ) * weights[ 0 ];
+    offsetTransform += GetBoneOffsetMatrix( int( indices[ 1 ] ) ) * weights[ 1 ];
+    offsetTransform += GetBoneOffsetMatrix( int( indices[ 2 ] ) ) * weights[ 2 ];
+    offsetTransform += GetBoneOffsetMatrix( int( indices[ 3 ] ) ) * weights[ 3 ];
     return offsetTransform;
 }
 
 mat3 AccumulatedBoneNormalTransform( vec4 weights, vec4 indices ) {
     mat3 normalTransfrom;
-    normalTransfrom = mat3( BoneNormalMatrices[ int( indices[ 0 ] ) ] ) * weights[ 0 ];
-    normalTransfrom += mat3( BoneNormalMatrices[ int( indices[ 1 ] ) ] ) * weights[ 1 ];
-    normalTransfrom += mat3( BoneNormalMatrices[ int( indices[ 2 ] ) ] ) * weights[ 2 ];
-    normalTransfrom += mat3( BoneNormalMatrices[ int( indices[ 3 ] ) ] ) * weights[ 3 ];
+    normalTransfrom = mat3( GetBoneNormalMatrix( int( indices[ 0 ] ) ) ) * weights[ 0 ];
+    normalTransfrom += mat3( GetBoneNormalMatrix( int( indices[ 1 ] ) ) ) * weights[ 1 ];
+    normalTransfrom += mat3( GetBoneNormalMatrix( int( indices[ 2 ] ) ) ) * weights[ 2 ];
+    normalTransfrom += mat3( GetBoneNormalMatrix( int( indices[ 3 ] ) ) ) * weights[ 3 ];
     return normalTransfrom;
 }
 
@@ -126,6 +177,49 @@ void UnpackQTangent( vec4 q, out vec3 t, out vec3 n, out float r ) {
     r = ( q.w < 0.0 ) ? -1.0 : 1.0;
 }
 
+void AccumulateBoneAffineRows( vec4 weights, vec4 indices, inout vec4 row0, inout vec4 row1, inout vec4 row2 ) {
+    for ( int i = 0; i < 4; ++i ) {
+        int j = int( indices[ i ] ) * 3;
+        row0 += GetBonePaletteVector( j + 0 ) * weights[ i ];
+        row1 += GetBonePaletteVector( j + 1 ) * weights[ i ];
+        row2 += GetBonePaletteVector( j + 2 ) * weights[ i ];
+    }
+}
+
+// The real parts are blended in the hemisphere of the pivot (the first bone) to take the shortest path.
+void AccumulateBoneDualQuaternions( vec4 weights, vec4 indices, vec4 pivot, inout vec4 real, inout vec4 dual ) {
+    for ( int i = 0; i < 4; ++i ) {
+        int   j = int( indices[ i ] ) * 2;
+        vec4  r = GetBonePaletteVector( j + 0 );
+        float w = dot( pivot, r ) < 0.0 ? -weights[ i ] : weights[ i ];
+        real += r * w;
+        dual += GetBonePaletteVector( j + 1 ) * w;
+    }
+}
+
+mat4 AffineRowsToMatrix( vec4 row0, vec4 row1, vec4 row2 ) {
+    return transpose( mat4( row0, row1, row2, vec4( 0, 0, 0, 1 ) ) );
+}
+
+mat4 DualQuaternionToMatrix( vec4 real, vec4 dual ) {
+    float invLength = 1.0 / length( real );
+    real *= invLength;
+    dual *= invLength;
+
+    vec3 x;
+    vec3 y;
+    UnpackQTangentAxes( real, x, y );
+
+    vec3 t = 2.0 * ( real.w * dual.xyz - dual.w * real.xyz + cross( real.xyz, dual.xyz ) );
+    return mat4( vec4( x, 0 ), vec4( y, 0 ), vec4( cross( x, y ), 0 ), vec4( t, 1 ) );
+}
+
+// The inverse-transpose of the 3x3 matrix up to the scale (the cofactor matrix), the orientation is preserved.
+mat3 CalculateNormalMatrix( mat3 m ) {
+    mat3 cofactors = mat3( cross( m[ 1 ], m[ 2 ] ), cross( m[ 2 ], m[ 0 ] ), cross( m[ 0 ], m[ 1 ] ) );
+    return dot( m[ 0 ], cofactors[ 0 ] ) < 0.0 ? -cofactors : cofactors;
+}
+
 vec3 kBaryCoords[ 3 ] = {
     vec3( 1, 0, 0 ), vec3( 0, 1, 0 ), vec3( 0, 0, 1 ),
 };
@@ -134,18 +228,51 @@ void main( ) {
     vec3 modelPosition = inPosition.xyz;
 
 #if defined( SKINNING )
-    vec4 boneWeights = fract( inBoneIndicesWeights );
-    vec4 boneIndices = inBoneIndicesWeights - boneWeights;
-
-    mat4 accumBoneMatrix = AccumulatedBoneOffsetTransform( boneWeights, boneIndices );
+    vec4 boneWeights0 = fract( inBoneIndicesWeights );
+    vec4 boneIndices0 = inBoneIndicesWeights - boneWeights0;
 #elif defined( SKINNING8 )
     vec4 boneWeights0 = fract( inBoneIndicesWeights0 );
     vec4 boneIndices0 = inBoneIndicesWeights0 - boneWeights0;
     vec4 boneWeights1 = fract( inBoneIndicesWeights1 );
     vec4 boneIndices1 = inBoneIndicesWeights1 - boneWeights1;
+#endif
 
-    mat4 accumBoneMatrix = AccumulatedBoneOffsetTransform( boneWeights1, boneIndices1 ) +
-                           AccumulatedBoneOffsetTransform( boneWeights0, boneIndices0 );
+#if defined( SKINNING ) || defined( SKINNING8 )
+    mat4 accumBoneMatrix;
+    mat3 accumBoneNormalMatrix;
+
+    // The branches are resolved when the pipeline is created (specialization constant).
+    if ( kBonePaletteFormat == BONE_PALETTE_FORMAT_AFFINE3X4 ) {
+        vec4 row0 = vec4( 0 );
+        vec4 row1 = vec4( 0 );
+        vec4 row2 = vec4( 0 );
+        AccumulateBoneAffineRows( boneWeights0, boneIndices0, row0, row1, row2 );
+#if defined( SKINNING8 )
+        AccumulateBoneAffineRows( boneWeights1, boneIndices1, row0, row1, row2 );
+#endif
+        accumBoneMatrix       = AffineRowsToMatrix( row0, row1, row2 );
+        accumBoneNormalMatrix = CalculateNormalMatrix( mat3( accumBoneMatrix ) );
+    } else if ( kBonePaletteFormat == BONE_PALETTE_FORMAT_DUAL_QUATERNION ) {
+        vec4 pivot = GetBonePaletteVector( int( boneIndices0[ 0 ] ) * 2 );
+        vec4 real  = vec4( 0 );
+        vec4 dual  = vec4( 0 );
+        AccumulateBoneDualQuaternions( boneWeights0, boneIndices0, pivot, real, dual );
+#if defined( SKINNING8 )
+        AccumulateBoneDualQuaternions( boneWeights1, boneIndices1, pivot, real, dual );
+#endif
+        accumBoneMatrix       = DualQuaternionToMatrix( real, dual );
+        accumBoneNormalMatrix = mat3( accumBoneMatrix );
+    } else {
+#if defined( SKINNING )
+        accumBoneMatrix       = AccumulatedBoneOffsetTransform( boneWeights0, boneIndices0 );
+        accumBoneNormalMatrix = AccumulatedBoneNormalTransform( boneWeights0, boneIndices0 );
+#else
+        accumBoneMatrix = AccumulatedBoneOffsetTransform( boneWeights1, boneIndices1 ) +
+                          AccumulatedBoneOffsetTransform( boneWeights0, boneIndices0 );
+        accumBoneNormalMatrix = AccumulatedBoneNormalTransform( boneWeights1, boneIndices1 ) +
+                                AccumulatedBoneNormalTransform( boneWeights0, boneIndices0 );
+#endif
+    }
 #endif
 
 #if defined( SKINNING ) || defined( SKINNING8 )
@@ -174,13 +301,6 @@ void main( ) {
     float reflection;
     UnpackQTangent( inQTangent, tangent, normal, reflection );
 
-#if defined( SKINNING )
-    mat3 accumBoneNormalMatrix = AccumulatedBoneNormalTransform( boneWeights, boneIndices );
-#elif defined( SKINNING8 )
-    mat3 accumBoneNormalMatrix = AccumulatedBoneNormalTransform( boneWeights1, boneIndices1 ) +
-                                 AccumulatedBoneNormalTransform( boneWeights0, boneIndices0 );
-#endif
-
 #if defined( SKINNING ) || defined( SKINNING8 )
     vec3 worldNormal  = normalize( mat3( NormalMatrix ) * accumBoneNormalMatrix * normal );
     vec3 worldTangent = normalize( mat3( NormalMatrix ) * accumBoneNormalMatrix * tangent.xyz );
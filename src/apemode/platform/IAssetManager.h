@@ -5,14 +5,27 @@
 namespace apemode {
 namespace platform {
 
+/* Read-only view of the asset contents (file mapping), the pages are loaded on access.
+ */
+struct IMappedContent {
+    virtual ~IMappedContent( )              = default;
+    virtual const uint8_t* GetData( ) const = 0;
+    virtual size_t         GetSize( ) const = 0;
+
+    /* Hints that the range is not going to be accessed soon, its pages can be released (and reloaded on access).
+     */
+    virtual void Discard( const uint8_t* pRangeData, size_t rangeSize ) const = 0;
+};
+
 struct IAsset {
-    virtual ~IAsset( )                                                   = default;
-    virtual const char*                GetName( ) const                  = 0;
-    virtual const char*                GetId( ) const                    = 0;
-    virtual apemode::vector< uint8_t > GetContentAsTextBuffer( ) const   = 0;
-    virtual apemode::vector< uint8_t > GetContentAsBinaryBuffer( ) const = 0;
-    virtual uint64_t                   GetCurrentVersion( ) const        = 0;
-    virtual void                       SetCurrentVersion( uint64_t )     = 0;
+    virtual ~IAsset( )                                                              = default;
+    virtual const char*                           GetName( ) const                  = 0;
+    virtual const char*                           GetId( ) const                    = 0;
+    virtual apemode::vector< uint8_t >            GetContentAsTextBuffer( ) const   = 0;
+    virtual apemode::vector< uint8_t >            GetContentAsBinaryBuffer( ) const = 0;
+    virtual apemode::unique_ptr< IMappedContent > MapContent( ) const               = 0; /* Null if failed. */
+    virtual uint64_t                              GetCurrentVersion( ) const        = 0;
+    virtual void                                  SetCurrentVersion( uint64_t )     = 0;
 };
 
 struct IAssetManager {
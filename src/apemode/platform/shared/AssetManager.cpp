@@ -9,6 +9,12 @@
 #include <regex>
 #include <set>
 
+#if !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 bool apemode::platform::shared::DirectoryExists( const char * pszPath ) {
 #if _WIN32
     DWORD dwAttrib = GetFileAttributesA( pszPath );
@@ -88,6 +94,11 @@ apemode::vector< uint8_t > apemode::platform::shared::AssetFile::GetContentAsBin
     return FileReader( ).ReadBinFile( Path.c_str( ) );
 }
 
+apemode::unique_ptr< apemode::platform::IMappedContent > apemode::platform::shared::AssetFile::MapContent( ) const {
+    apemode_memory_allocation_scope;
+    return FileMapper( ).MapFile( Path.c_str( ) );
+}
+
 uint64_t apemode::platform::shared::AssetFile::GetCurrentVersion( ) const {
     return LastTimeModified.load(  );
 }
@@ -333,3 +344,108 @@ apemode::vector< uint8_t > apemode::platform::shared::FileReader::ReadBinFile( c
 apemode::vector< uint8_t > apemode::platform::shared::FileReader::ReadTxtFile( const char* pszFilePath ) {
     return TReadFile< true >( pszFilePath );
 }
+
+namespace {
+
+/* Read-only mapping of the file, it is unmapped on destruction.
+ * The pages are private and never written, so the released ones are reloaded from the file on access.
+ */
+struct MappedFile : apemode::platform::IMappedContent {
+    const uint8_t* pData    = nullptr;
+    size_t         DataSize = 0;
+#if _WIN32
+    HANDLE hFile    = INVALID_HANDLE_VALUE;
+    HANDLE hMapping = NULL;
+#endif
+
+    ~MappedFile( ) override {
+#if _WIN32
+        if ( pData )
+            UnmapViewOfFile( pData );
+        if ( hMapping )
+            CloseHandle( hMapping );
+        if ( INVALID_HANDLE_VALUE != hFile )
+            CloseHandle( hFile );
+#else
+        if ( pData )
+            munmap( const_cast< uint8_t* >( pData ), DataSize );
+#endif
+    }
+
+    const uint8_t* GetData( ) const override {
+        return pData;
+    }
+
+    size_t GetSize( ) const override {
+        return DataSize;
+    }
+
+    void Discard( const uint8_t* pRangeData, size_t rangeSize ) const override {
+        if ( pRangeData < pData || pRangeData + rangeSize > pData + DataSize ) {
+            return;
+        }
+
+#if _WIN32
+        // The mapped pages are clean, they are released when the system needs the memory.
+        (void) rangeSize;
+#else
+        // Only the pages that are fully covered by the range are released.
+        const uintptr_t pageSize   = uintptr_t( sysconf( _SC_PAGESIZE ) );
+        const uintptr_t rangeBegin = ( uintptr_t( pRangeData ) + pageSize - 1 ) & ~( pageSize - 1 );
+        const uintptr_t rangeEnd   = ( uintptr_t( pRangeData ) + rangeSize ) & ~( pageSize - 1 );
+
+        if ( rangeBegin < rangeEnd ) {
+            madvise( reinterpret_cast< void* >( rangeBegin ), size_t( rangeEnd - rangeBegin ), MADV_DONTNEED );
+        }
+#endif
+    }
+};
+
+} // namespace
+
+apemode::unique_ptr< apemode::platform::IMappedContent > apemode::platform::shared::FileMapper::MapFile( const char* pszFilePath ) {
+    MappedFile*                                              pMappedFile = apemode_new MappedFile( );
+    apemode::unique_ptr< apemode::platform::IMappedContent > pMappedContent( pMappedFile );
+
+#if _WIN32
+    pMappedFile->hFile = CreateFileA( pszFilePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( INVALID_HANDLE_VALUE == pMappedFile->hFile )
+        return nullptr;
+
+    LARGE_INTEGER fileSize;
+    if ( !GetFileSizeEx( pMappedFile->hFile, &fileSize ) || !fileSize.QuadPart )
+        return nullptr;
+
+    pMappedFile->hMapping = CreateFileMappingA( pMappedFile->hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+    if ( !pMappedFile->hMapping )
+        return nullptr;
+
+    pMappedFile->pData = static_cast< const uint8_t* >( MapViewOfFile( pMappedFile->hMapping, FILE_MAP_READ, 0, 0, 0 ) );
+    if ( !pMappedFile->pData )
+        return nullptr;
+
+    pMappedFile->DataSize = static_cast< size_t >( fileSize.QuadPart );
+#else
+    const int fileDescriptor = open( pszFilePath, O_RDONLY );
+    if ( fileDescriptor < 0 )
+        return nullptr;
+
+    struct stat statBuffer;
+    if ( fstat( fileDescriptor, &statBuffer ) != 0 || statBuffer.st_size <= 0 ) {
+        close( fileDescriptor );
+        return nullptr;
+    }
+
+    // The mapping keeps the file referenced, the descriptor is not needed.
+    void* pData = mmap( nullptr, static_cast< size_t >( statBuffer.st_size ), PROT_READ, MAP_PRIVATE, fileDescriptor, 0 );
+    close( fileDescriptor );
+
+    if ( MAP_FAILED == pData )
+        return nullptr;
+
+    pMappedFile->pData    = static_cast< const uint8_t* >( pData );
+    pMappedFile->DataSize = static_cast< size_t >( statBuffer.st_size );
+#endif
+
+    return pMappedContent;
+}
@@ -18,12 +18,13 @@ struct AssetFile : IAsset {
 
     virtual ~AssetFile( ) = default;
 
-    const char*                GetName( ) const override;
-    const char*                GetId( ) const override;
-    apemode::vector< uint8_t > GetContentAsTextBuffer( ) const override;
-    apemode::vector< uint8_t > GetContentAsBinaryBuffer( ) const override;
-    uint64_t                   GetCurrentVersion( ) const override;
-    void                       SetCurrentVersion( uint64_t lastTimeModified ) override;
+    const char*                           GetName( ) const override;
+    const char*                           GetId( ) const override;
+    apemode::vector< uint8_t >            GetContentAsTextBuffer( ) const override;
+    apemode::vector< uint8_t >            GetContentAsBinaryBuffer( ) const override;
+    apemode::unique_ptr< IMappedContent > MapContent( ) const override;
+    uint64_t                              GetCurrentVersion( ) const override;
+    void                                  SetCurrentVersion( uint64_t lastTimeModified ) override;
 
     void SetName( const char* pszAssetName );
     void SetId( const char* pszAssetPath );
@@ -72,6 +73,13 @@ public:
     apemode::vector< uint8_t > ReadTxtFile( const char* pszFilePath ); /* Returns the content of the file. */
 };
 
+/* Maps files for reading, the contents are not copied (mmap, MapViewOfFile).
+ */
+class FileMapper {
+public:
+    apemode::unique_ptr< IMappedContent > MapFile( const char* pszFilePath ); /* Returns the mapping of the file, null if failed. */
+};
+
 } // namespace shared
 } // namespace platform
 } // namespace apemode
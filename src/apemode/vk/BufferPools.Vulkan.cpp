@@ -202,6 +202,15 @@ void apemodevk::HostBufferPool::Destroy( ) {
 }
 
 uint32_t apemodevk::HostBufferPool::Page::Push( const void *pDataStructure, uint32_t ByteSize ) {
+    void *pMappedData = nullptr;
+    const uint32_t currentMappedOffset = Reserve( ByteSize, &pMappedData );
+
+    /* Copy to the reserved memory. */
+    memcpy( pMappedData, pDataStructure, ByteSize );
+    return currentMappedOffset;
+}
+
+uint32_t apemodevk::HostBufferPool::Page::Reserve( uint32_t ByteSize, void **ppMappedData ) {
     apemodevk_memory_allocation_scope;
 
     const uint32_t coveredOffsetCount   = ByteSize / Alignment + ( uint32_t )( 0 != ByteSize % Alignment );
@@ -225,9 +234,8 @@ uint32_t apemodevk::HostBufferPool::Page::Push( const void *pDataStructure, uint
 #endif
     }
 
-    /* Get current memory pointer and copy there. */
-    auto mappedData = pMapped + currentMappedOffset;
-    memcpy( mappedData, pDataStructure, ByteSize );
+    /* Get current memory pointer. */
+    *ppMappedData = pMapped + currentMappedOffset;
     CurrentOffsetIndex += coveredOffsetCount;
 
     return currentMappedOffset;
@@ -248,3 +256,19 @@ apemodevk::HostBufferPool::SuballocResult apemodevk::HostBufferPool::Suballocate
 
     return suballocResult;
 }
+
+apemodevk::HostBufferPool::SuballocResult apemodevk::HostBufferPool::Suballocate( uint32_t ByteSize, void **ppMappedData ) {
+    apemodevk_memory_allocation_scope;
+
+    SuballocResult suballocResult;
+    InitializeStruct( suballocResult.DescriptorBufferInfo );
+    *ppMappedData = nullptr;
+
+    if ( auto pPage = FindPage( ByteSize ) ) {
+        suballocResult.DescriptorBufferInfo.buffer = pPage->hBuffer;
+        suballocResult.DescriptorBufferInfo.range  = pPage->TotalSize;
+        suballocResult.DynamicOffset         = pPage->Reserve( ByteSize, ppMappedData );
+    }
+
+    return suballocResult;
+}
@@ -43,6 +43,11 @@ namespace apemodevk {
             /* NOTE: Does not handle space requirements (aborts in debug mode only). */
             uint32_t Push( const void *pDataStructure, uint32_t ByteSize );
 
+            /* NOTE: Does not handle space requirements (aborts in debug mode only).
+             * Returns the offset and the mapped memory, so that the data can be written in place.
+             */
+            uint32_t Reserve( uint32_t ByteSize, void **ppMappedData );
+
             /* NOTE: Does not handle space requirements (aborts in debug mode only). */
             template < typename TDataStructure >
             uint32_t TPush( const TDataStructure &dataStructure ) {
@@ -84,6 +89,9 @@ namespace apemodevk {
 
         SuballocResult Suballocate(const void *pDataStructure, uint32_t ByteSize);
 
+        /* Returns the mapped memory of the suballocation (null if failed), the data is expected to be written there. */
+        SuballocResult Suballocate( uint32_t ByteSize, void **ppMappedData );
+
         template < typename TDataStructure >
         SuballocResult TSuballocate( const TDataStructure &dataStructure ) {
             return Suballocate( &dataStructure, sizeof( TDataStructure ) );
@@ -4,6 +4,11 @@
 namespace apemode {
 
     struct CameraProjectionController {
+        /* Projection parameters of the camera, shared by the rendering and the animation LOD selection. */
+        float FieldOfViewYDegs = 55;
+        float NearZ            = 0.1f;
+        float FarZ             = 1000.0f;
+
         inline XMMATRIX ProjBiasMatrix( ) {
             /* https://matthewwellings.com/blog/the-new-vulkan-coordinate-system/ */
 
@@ -21,5 +26,9 @@ namespace apemode {
 
             return ProjBiasMatrix( ) * apemodexm::XMMatrixPerspectiveFovLH( fovRads, aspectWOverH, _nearZ, _farZ );
         }
+
+        inline XMMATRIX ProjMatrix( float _width, float _height ) {
+            return ProjMatrix( FieldOfViewYDegs, _width, _height, NearZ, FarZ );
+        }
     };
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 
 #include "Scene.h"
 #include <apemode/platform/AppState.h>
+#include <apemode/platform/Stopwatch.h>
 #include <apemode/platform/memory/MemoryManager.h>
 
 //#define APEMODEVK_NO_GOOGLE_DRACO
@@ -102,34 +103,50 @@ bool apemode::SceneNodeTransform::Validate( ) const {
            !IsNearlyZero( GeometricScaling.x ) && !IsNearlyZero( GeometricScaling.y ) && !IsNearlyZero( GeometricScaling.z );
 }
 
-XMMATRIX XMMatrixRotationOrdered( const XMFLOAT3 v, detail::ERotationOrder eRotOrder ) {
-    // return XMMatrixRotationZ( v.z ) * XMMatrixRotationY( v.y ) * XMMatrixRotationX( v.x );
-    switch ( eRotOrder ) {
-        case detail::eRotationOrder_EulerXYZ:
-            return XMMatrixRotationX( v.x ) * XMMatrixRotationY( v.y ) * XMMatrixRotationZ( v.z ); //
-        case detail::eRotationOrder_EulerXZY:
-            return XMMatrixRotationX( v.x ) * XMMatrixRotationZ( v.z ) * XMMatrixRotationY( v.y ); //
-        case detail::eRotationOrder_EulerYZX:
-            return XMMatrixRotationY( v.y ) * XMMatrixRotationZ( v.z ) * XMMatrixRotationX( v.x ); //
-        case detail::eRotationOrder_EulerYXZ:
-            return XMMatrixRotationY( v.y ) * XMMatrixRotationX( v.x ) * XMMatrixRotationZ( v.z ); //
-        case detail::eRotationOrder_EulerZXY:
-            return XMMatrixRotationZ( v.z ) * XMMatrixRotationX( v.x ) * XMMatrixRotationY( v.y ); //
-        case detail::eRotationOrder_EulerZYX:
-            return XMMatrixRotationZ( v.z ) * XMMatrixRotationY( v.y ) * XMMatrixRotationX( v.x );
-        case detail::eRotationOrder_EulerSphericXYZ:
-            return XMMatrixRotationX( v.x ) * XMMatrixRotationY( v.y ) * XMMatrixRotationZ( v.z );
-    }
-
-    assert( false && "Unhandled rotation orders." );
+template < detail::ERotationOrder TOrder >
+inline XMMATRIX XMMatrixRotationOrdered( const XMFLOAT3 v );
+
+template <>
+inline XMMATRIX XMMatrixRotationOrdered< detail::eRotationOrder_EulerXYZ >( const XMFLOAT3 v ) {
+    return XMMatrixRotationX( v.x ) * XMMatrixRotationY( v.y ) * XMMatrixRotationZ( v.z );
+}
+
+template <>
+inline XMMATRIX XMMatrixRotationOrdered< detail::eRotationOrder_EulerXZY >( const XMFLOAT3 v ) {
+    return XMMatrixRotationX( v.x ) * XMMatrixRotationZ( v.z ) * XMMatrixRotationY( v.y );
+}
+
+template <>
+inline XMMATRIX XMMatrixRotationOrdered< detail::eRotationOrder_EulerYZX >( const XMFLOAT3 v ) {
+    return XMMatrixRotationY( v.y ) * XMMatrixRotationZ( v.z ) * XMMatrixRotationX( v.x );
+}
+
+template <>
+inline XMMATRIX XMMatrixRotationOrdered< detail::eRotationOrder_EulerYXZ >( const XMFLOAT3 v ) {
+    return XMMatrixRotationY( v.y ) * XMMatrixRotationX( v.x ) * XMMatrixRotationZ( v.z );
+}
+
+template <>
+inline XMMATRIX XMMatrixRotationOrdered< detail::eRotationOrder_EulerZXY >( const XMFLOAT3 v ) {
+    return XMMatrixRotationZ( v.z ) * XMMatrixRotationX( v.x ) * XMMatrixRotationY( v.y );
+}
+
+template <>
+inline XMMATRIX XMMatrixRotationOrdered< detail::eRotationOrder_EulerZYX >( const XMFLOAT3 v ) {
+    return XMMatrixRotationZ( v.z ) * XMMatrixRotationY( v.y ) * XMMatrixRotationX( v.x );
+}
+
+template <>
+inline XMMATRIX XMMatrixRotationOrdered< detail::eRotationOrder_EulerSphericXYZ >( const XMFLOAT3 v ) {
     return XMMatrixRotationX( v.x ) * XMMatrixRotationY( v.y ) * XMMatrixRotationZ( v.z );
 }
 
-XMMATRIX XMMatrixRotationOrderedInversed( XMFLOAT3 v, const detail::ERotationOrder eRotOrder ) {
+template < detail::ERotationOrder TOrder >
+inline XMMATRIX XMMatrixRotationOrderedInversed( XMFLOAT3 v ) {
     v.x = -v.x;
     v.y = -v.y;
     v.z = -v.z;
-    return XMMatrixRotationOrdered( v, eRotOrder );
+    return XMMatrixRotationOrdered< TOrder >( v );
 }
 
 XMMATRIX XMMatrixRotationZYX( const XMFLOAT3 *v ) {
@@ -138,6 +155,109 @@ XMMATRIX XMMatrixRotationZYX( const XMFLOAT3 *v ) {
            XMMatrixRotationZ( v->z );
 }
 
+namespace {
+
+//
+// Local and geometric matrix kernels, specialized for the transform shapes and rotation orders.
+// The kernels with the reduced shapes produce the same matrices as the full one for the properties they skip being zero.
+//
+
+template < detail::ETransformShape TShape, detail::ERotationOrder TOrder >
+struct TLocalMatrixKernel;
+
+template < detail::ERotationOrder TOrder >
+struct TLocalMatrixKernel< detail::eTransformShape_TRS, TOrder > {
+    static XMMATRIX Calculate( const SceneNodeTransform &p ) {
+        return XMMatrixScalingFromVector( XMLoadFloat3( &p.Scaling ) ) *
+               XMMatrixRotationOrdered< TOrder >( p.Rotation ) *
+               XMMatrixTranslationFromVector( XMLoadFloat3( &p.Translation ) );
+    }
+};
+
+template < detail::ERotationOrder TOrder >
+struct TLocalMatrixKernel< detail::eTransformShape_TRSPreRotated, TOrder > {
+    static XMMATRIX Calculate( const SceneNodeTransform &p ) {
+        return XMMatrixScalingFromVector( XMLoadFloat3( &p.Scaling ) ) *
+               XMMatrixRotationOrdered< TOrder >( p.Rotation ) *
+               XMMatrixRotationOrdered< TOrder >( p.PreRotation ) *
+               XMMatrixTranslationFromVector( XMLoadFloat3( &p.Translation ) );
+    }
+};
+
+template < detail::ERotationOrder TOrder >
+struct TLocalMatrixKernel< detail::eTransformShape_Full, TOrder > {
+    static XMMATRIX Calculate( const SceneNodeTransform &p ) {
+        return XMMatrixTranslationFromVector( XMVectorNegate( XMLoadFloat3( &p.ScalingPivot ) ) ) *
+               XMMatrixScalingFromVector( XMLoadFloat3( &p.Scaling ) ) *
+               XMMatrixTranslationFromVector( XMLoadFloat3( &p.ScalingPivot ) ) *
+               XMMatrixTranslationFromVector( XMLoadFloat3( &p.ScalingOffset ) ) *
+               XMMatrixTranslationFromVector( XMVectorNegate( XMLoadFloat3( &p.RotationPivot ) ) ) *
+               XMMatrixRotationOrderedInversed< TOrder >( p.PostRotation ) *
+               XMMatrixRotationOrdered< TOrder >( p.Rotation ) *
+               XMMatrixRotationOrdered< TOrder >( p.PreRotation ) *
+               XMMatrixTranslationFromVector( XMLoadFloat3( &p.RotationPivot ) ) *
+               XMMatrixTranslationFromVector( XMLoadFloat3( &p.RotationOffset ) ) *
+               XMMatrixTranslationFromVector( XMLoadFloat3( &p.Translation ) );
+    }
+};
+
+template < detail::ERotationOrder TOrder >
+XMMATRIX CalculateGeometricMatrix( const SceneNodeTransform &p ) {
+    return XMMatrixScalingFromVector( XMLoadFloat3( &p.GeometricScaling ) ) *
+           XMMatrixRotationOrdered< TOrder >( p.GeometricRotation ) *
+           XMMatrixTranslationFromVector( XMLoadFloat3( &p.GeometricTranslation ) );
+}
+
+using MatrixKernel = XMMATRIX ( * )( const SceneNodeTransform & );
+
+#define SCENE_ROTATION_ORDER_KERNELS( K )                     \
+    {                                                         \
+        K< detail::eRotationOrder_EulerXYZ >,                 \
+        K< detail::eRotationOrder_EulerXZY >,                 \
+        K< detail::eRotationOrder_EulerYZX >,                 \
+        K< detail::eRotationOrder_EulerYXZ >,                 \
+        K< detail::eRotationOrder_EulerZXY >,                 \
+        K< detail::eRotationOrder_EulerZYX >,                 \
+        K< detail::eRotationOrder_EulerSphericXYZ >,          \
+    }
+
+template < detail::ERotationOrder TOrder >
+XMMATRIX CalculateLocalMatrixTRS( const SceneNodeTransform &p ) {
+    return TLocalMatrixKernel< detail::eTransformShape_TRS, TOrder >::Calculate( p );
+}
+
+template < detail::ERotationOrder TOrder >
+XMMATRIX CalculateLocalMatrixTRSPreRotated( const SceneNodeTransform &p ) {
+    return TLocalMatrixKernel< detail::eTransformShape_TRSPreRotated, TOrder >::Calculate( p );
+}
+
+template < detail::ERotationOrder TOrder >
+XMMATRIX CalculateLocalMatrixFull( const SceneNodeTransform &p ) {
+    return TLocalMatrixKernel< detail::eTransformShape_Full, TOrder >::Calculate( p );
+}
+
+const MatrixKernel kLocalMatrixKernels[ detail::eTransformShapeCount ][ detail::eRotationOrderCount ] = {
+    SCENE_ROTATION_ORDER_KERNELS( CalculateLocalMatrixTRS ),
+    SCENE_ROTATION_ORDER_KERNELS( CalculateLocalMatrixTRSPreRotated ),
+    SCENE_ROTATION_ORDER_KERNELS( CalculateLocalMatrixFull ),
+};
+
+const MatrixKernel kGeometricMatrixKernels[ detail::eRotationOrderCount ] = SCENE_ROTATION_ORDER_KERNELS( CalculateGeometricMatrix );
+
+#undef SCENE_ROTATION_ORDER_KERNELS
+
+inline MatrixKernel GetLocalMatrixKernel( const detail::ETransformShape eShape, const detail::ERotationOrder eOrder ) {
+    assert( eShape < detail::eTransformShapeCount && eOrder < detail::eRotationOrderCount );
+    return kLocalMatrixKernels[ eShape ][ eOrder ];
+}
+
+inline MatrixKernel GetGeometricMatrixKernel( const detail::ERotationOrder eOrder ) {
+    assert( eOrder < detail::eRotationOrderCount );
+    return kGeometricMatrixKernels[ eOrder ];
+}
+
+} // namespace
+
 void apemode::SceneNodeTransform::ApplyLimits( const SceneNodeTransformLimits &limits ) {
 #define CLAMP_PROPERTY_COMPONENT( P )           \
     if ( limits.Is##P##MaxActive.x ) {          \
@@ -167,298 +287,2368 @@ void apemode::SceneNodeTransform::ApplyLimits( const SceneNodeTransformLimits &l
 }
 
 XMMATRIX apemode::SceneNodeTransform::CalculateLocalMatrix( const detail::ERotationOrder eOrder ) const {
-//    return XMMatrixTranslationFromVector( XMLoadFloat3( &Translation ) ) *
-//           XMMatrixRotationOrdered( Rotation, eOrder ) *
-//           XMMatrixScalingFromVector( XMLoadFloat3( &Scaling ) );
+    return GetLocalMatrixKernel( detail::eTransformShape_Full, eOrder )( *this );
+}
 
-//    return XMMatrixScalingFromVector( XMLoadFloat3( &Scaling ) ) *
-//           XMMatrixRotationOrdered( Rotation, eOrder ) *
-//           XMMatrixTranslationFromVector( XMLoadFloat3( &Translation ) );
-//
-//    return XMMatrixTranslationFromVector( XMLoadFloat3( &Translation ) ) *
-//           XMMatrixTranslationFromVector( XMLoadFloat3( &RotationOffset ) ) *
-//           XMMatrixTranslationFromVector( XMLoadFloat3( &RotationPivot ) ) *
-//           XMMatrixRotationOrdered( PreRotation, eOrder ) *
-//           XMMatrixRotationOrdered( Rotation, eOrder ) *
-//           XMMatrixRotationOrderedInversed( PostRotation, eOrder ) *
-//           XMMatrixTranslationFromVector( XMVectorNegate( XMLoadFloat3( &RotationPivot ) ) ) *
-//           XMMatrixTranslationFromVector( XMLoadFloat3( &ScalingOffset ) ) *
-//           XMMatrixTranslationFromVector( XMLoadFloat3( &ScalingPivot ) ) *
-//           XMMatrixScalingFromVector( XMLoadFloat3( &Scaling ) ) *
-//           XMMatrixTranslationFromVector( XMVectorNegate( XMLoadFloat3( &ScalingPivot ) ) );
-
-    return XMMatrixTranslationFromVector( XMVectorNegate( XMLoadFloat3( &ScalingPivot ) ) ) *
-           XMMatrixScalingFromVector( XMLoadFloat3( &Scaling ) ) *
-           XMMatrixTranslationFromVector( XMLoadFloat3( &ScalingPivot ) ) *
-           XMMatrixTranslationFromVector( XMLoadFloat3( &ScalingOffset ) ) *
-           XMMatrixTranslationFromVector( XMVectorNegate( XMLoadFloat3( &RotationPivot ) ) ) *
-           XMMatrixRotationOrderedInversed( PostRotation, eOrder ) *
-           XMMatrixRotationOrdered( Rotation, eOrder ) *
-           XMMatrixRotationOrdered( PreRotation, eOrder ) *
-           XMMatrixTranslationFromVector( XMLoadFloat3( &RotationPivot ) ) *
-           XMMatrixTranslationFromVector( XMLoadFloat3( &RotationOffset ) ) *
-           XMMatrixTranslationFromVector( XMLoadFloat3( &Translation ) );
+XMMATRIX apemode::SceneNodeTransform::CalculateLocalMatrix( const detail::ETransformShape eShape, const detail::ERotationOrder eOrder ) const {
+    return GetLocalMatrixKernel( eShape, eOrder )( *this );
+}
+
+XMMATRIX apemode::SceneNodeTransform::CalculateGeometricMatrix( const detail::ERotationOrder eOrder ) const {
+    return GetGeometricMatrixKernel( eOrder )( *this );
+}
+
+void apemode::Scene::InitializeTransformFrame( SceneNodeTransformFrame &t ) const {
+    // The pruned nodes are not updated, they need the bind pose matrices.
+    if ( &t != &BindPoseFrame && BindPoseFrame.GetNodeCount( ) == Nodes.size( ) ) {
+        t                      = BindPoseFrame;
+        t.AnimLayerCompositeId = detail::kInvalidId;
+        t.SetAllDirty( );
+        return;
+    }
+
+    t.Resize( Nodes.size( ) );
+}
+
+void apemode::Scene::InitializeAnimCursor( SceneAnimCursor &animCursor ) const {
+    animCursor.SegmentKeyIndices.assign( AnimCurves.size( ), 0 );
+}
+
+const apemode::SceneAnimLayer *apemode::Scene::GetAnimLayer( const uint16_t animStackId, const uint16_t animLayerId ) const {
+    SceneAnimLayerId animLayerCompositeId;
+    animLayerCompositeId.AnimStackIndex = animStackId;
+    animLayerCompositeId.AnimLayerIndex = animLayerId;
+
+    const auto animLayerIt = AnimLayers.find( animLayerCompositeId.AnimLayerCompositeId );
+    return animLayerIt != AnimLayers.end( ) ? &animLayerIt->second : nullptr;
+}
+
+const apemode::SceneNodeAnimCurveIds *apemode::Scene::GetAnimCurveIds( const uint32_t nodeId,
+                                                                       const uint16_t animStackId,
+                                                                       const uint16_t animLayerId ) const {
+
+    if ( ! AnimNodeIdToAnimCurveIds.empty( ) ) {
+
+        SceneAnimNodeId animNodeCompositeId;
+        animNodeCompositeId.NodeId                  = nodeId;
+        animNodeCompositeId.AnimLayerId.AnimStackIndex = animStackId;
+        animNodeCompositeId.AnimLayerId.AnimLayerIndex = animLayerId;
+
+        const auto animCurveIdsIt = AnimNodeIdToAnimCurveIds.find( animNodeCompositeId.AnimNodeCompositeId );
+        if ( animCurveIdsIt != AnimNodeIdToAnimCurveIds.end( ) ) {
+            assert( AnimNodeIdToAnimCurveIds.end( ) != animCurveIdsIt );
+            return &animCurveIdsIt->second;
+        }
+    }
+
+    return nullptr;
+}
+
+inline XMMATRIX CalculateOffsetMatrix( const XMMATRIX invBindPoseMatrix, const XMMATRIX currentAnimatedMatrix ) {
+    return invBindPoseMatrix * currentAnimatedMatrix;
+}
+
+namespace {
+
+/* SkinMatrixBatch class contains the affine matrices of the bones in SoA layout (element-major, 4x3 row-major elements).
+ */
+template < uint32_t TBatchSize >
+struct SkinMatrixBatch {
+    alignas( 16 ) float InvBindPose[ 12 ][ TBatchSize ];
+    alignas( 16 ) float World[ 12 ][ TBatchSize ];
+    alignas( 16 ) float Offset[ 12 ][ TBatchSize ];
+    alignas( 16 ) float Normal[ 12 ][ TBatchSize ]; /* 3x3 inverse-transpose rows, and the translation column. */
+
+    void Gather( const apemode::SceneSkin &skin, const apemode::SceneNodeTransformFrame &frame, const size_t boneIndex ) {
+        for ( uint32_t i = 0; i < TBatchSize; ++i ) {
+            XMFLOAT4X3 invBindPoseMatrix;
+            XMStoreFloat4x3( &invBindPoseMatrix, skin.InvBindPoseMatrices[ boneIndex + i ] );
+
+            const XMFLOAT4X3 &worldMatrix = frame.WorldMatrices[ skin.LinkIds[ boneIndex + i ] ];
+            for ( uint32_t e = 0; e < 12; ++e ) {
+                InvBindPose[ e ][ i ] = invBindPoseMatrix.m[ e / 3 ][ e % 3 ];
+                World[ e ][ i ]       = worldMatrix.m[ e / 3 ][ e % 3 ];
+            }
+        }
+    }
+
+    /* The matrices are written row by row (the output can be the write-combined mapped memory). */
+    void Scatter( XMFLOAT4X4 *pOffsetMatrices, XMFLOAT4X4 *pNormalMatrices ) const {
+        for ( uint32_t i = 0; i < TBatchSize; ++i ) {
+            XMFLOAT4X4 &offsetMatrix = pOffsetMatrices[ i ];
+            for ( uint32_t row = 0; row < 4; ++row ) {
+                offsetMatrix.m[ row ][ 0 ] = Offset[ row * 3 + 0 ][ i ];
+                offsetMatrix.m[ row ][ 1 ] = Offset[ row * 3 + 1 ][ i ];
+                offsetMatrix.m[ row ][ 2 ] = Offset[ row * 3 + 2 ][ i ];
+                offsetMatrix.m[ row ][ 3 ] = row == 3 ? 1.0f : 0.0f;
+            }
+        }
+
+        if ( pNormalMatrices ) {
+            for ( uint32_t i = 0; i < TBatchSize; ++i ) {
+                XMFLOAT4X4 &normalMatrix = pNormalMatrices[ i ];
+                for ( uint32_t row = 0; row < 3; ++row ) {
+                    normalMatrix.m[ row ][ 0 ] = Normal[ row * 3 + 0 ][ i ];
+                    normalMatrix.m[ row ][ 1 ] = Normal[ row * 3 + 1 ][ i ];
+                    normalMatrix.m[ row ][ 2 ] = Normal[ row * 3 + 2 ][ i ];
+                    normalMatrix.m[ row ][ 3 ] = Normal[ 9 + row ][ i ];
+                }
+
+                normalMatrix.m[ 3 ][ 0 ] = 0.0f;
+                normalMatrix.m[ 3 ][ 1 ] = 0.0f;
+                normalMatrix.m[ 3 ][ 2 ] = 0.0f;
+                normalMatrix.m[ 3 ][ 3 ] = 1.0f;
+            }
+        }
+    }
+
+    /* The offset matrices are written as the transposed 3x4 matrices (3 rows, the translation is in the last column). */
+    void ScatterAffine( XMFLOAT4 *pAffineRows ) const {
+        for ( uint32_t i = 0; i < TBatchSize; ++i ) {
+            for ( uint32_t row = 0; row < 3; ++row ) {
+                XMFLOAT4 &affineRow = pAffineRows[ i * 3 + row ];
+                affineRow.x = Offset[ 0 + row ][ i ];
+                affineRow.y = Offset[ 3 + row ][ i ];
+                affineRow.z = Offset[ 6 + row ][ i ];
+                affineRow.w = Offset[ 9 + row ][ i ];
+            }
+        }
+    }
+};
+
+/* SIMD lanes for 4 bones (DirectXMath).
+ */
+struct SkinMatrixLanes4 {
+    using Vector = XMVECTOR;
+    static Vector One( ) { return XMVectorSplatOne( ); }
+    static Vector Load( const float *p ) { return XMLoadFloat4( reinterpret_cast< const XMFLOAT4 * >( p ) ); }
+    static void   Store( float *p, const Vector v ) { XMStoreFloat4( reinterpret_cast< XMFLOAT4 * >( p ), v ); }
+    static Vector Add( const Vector a, const Vector b ) { return XMVectorAdd( a, b ); }
+    static Vector Sub( const Vector a, const Vector b ) { return XMVectorSubtract( a, b ); }
+    static Vector Mul( const Vector a, const Vector b ) { return XMVectorMultiply( a, b ); }
+    static Vector Div( const Vector a, const Vector b ) { return XMVectorDivide( a, b ); }
+    static Vector Negate( const Vector a ) { return XMVectorNegate( a ); }
+};
+
+/* Calculates the offset matrices (InvBindPose * World) and their inverse-transposed 3x3 parts with the cofactors.
+ * For the rows r0, r1, r2 of the 3x3 part, the inverse-transpose rows are (r1 x r2, r2 x r0, r0 x r1) / det,
+ * and the translation column is -(t . row) for each of them.
+ * The normal matrices can be skipped when they are derived later (e.g. in the vertex shader).
+ */
+template < typename TLanes, bool TNormalMatrices = true, uint32_t TBatchSize >
+void CalculateSkinMatrices( SkinMatrixBatch< TBatchSize > &batch ) {
+    using V = typename TLanes::Vector;
+
+    V w[ 12 ];
+    for ( uint32_t e = 0; e < 12; ++e ) {
+        w[ e ] = TLanes::Load( batch.World[ e ] );
+    }
+
+    V o[ 12 ];
+    for ( uint32_t row = 0; row < 4; ++row ) {
+        const V b0 = TLanes::Load( batch.InvBindPose[ row * 3 + 0 ] );
+        const V b1 = TLanes::Load( batch.InvBindPose[ row * 3 + 1 ] );
+        const V b2 = TLanes::Load( batch.InvBindPose[ row * 3 + 2 ] );
+
+        for ( uint32_t col = 0; col < 3; ++col ) {
+            V value = TLanes::Add( TLanes::Add( TLanes::Mul( b0, w[ col ] ), TLanes::Mul( b1, w[ 3 + col ] ) ), TLanes::Mul( b2, w[ 6 + col ] ) );
+            if ( row == 3 ) {
+                value = TLanes::Add( value, w[ 9 + col ] );
+            }
+
+            o[ row * 3 + col ] = value;
+            TLanes::Store( batch.Offset[ row * 3 + col ], value );
+        }
+    }
+
+    if ( !TNormalMatrices ) {
+        return;
+    }
+
+    // Cross products of the rows (cofactors).
+    V c[ 9 ];
+    for ( uint32_t row = 0; row < 3; ++row ) {
+        const V *a = o + ( ( row + 1 ) % 3 ) * 3;
+        const V *b = o + ( ( row + 2 ) % 3 ) * 3;
+        c[ row * 3 + 0 ] = TLanes::Sub( TLanes::Mul( a[ 1 ], b[ 2 ] ), TLanes::Mul( a[ 2 ], b[ 1 ] ) );
+        c[ row * 3 + 1 ] = TLanes::Sub( TLanes::Mul( a[ 2 ], b[ 0 ] ), TLanes::Mul( a[ 0 ], b[ 2 ] ) );
+        c[ row * 3 + 2 ] = TLanes::Sub( TLanes::Mul( a[ 0 ], b[ 1 ] ), TLanes::Mul( a[ 1 ], b[ 0 ] ) );
+    }
+
+    const V det = TLanes::Add( TLanes::Add( TLanes::Mul( o[ 0 ], c[ 0 ] ), TLanes::Mul( o[ 1 ], c[ 1 ] ) ), TLanes::Mul( o[ 2 ], c[ 2 ] ) );
+    const V invDet = TLanes::Div( TLanes::One( ), det );
+
+    for ( uint32_t row = 0; row < 3; ++row ) {
+        const V n0 = TLanes::Mul( c[ row * 3 + 0 ], invDet );
+        const V n1 = TLanes::Mul( c[ row * 3 + 1 ], invDet );
+        const V n2 = TLanes::Mul( c[ row * 3 + 2 ], invDet );
+        const V nt = TLanes::Negate( TLanes::Add( TLanes::Add( TLanes::Mul( o[ 9 ], n0 ), TLanes::Mul( o[ 10 ], n1 ) ), TLanes::Mul( o[ 11 ], n2 ) ) );
+
+        TLanes::Store( batch.Normal[ row * 3 + 0 ], n0 );
+        TLanes::Store( batch.Normal[ row * 3 + 1 ], n1 );
+        TLanes::Store( batch.Normal[ row * 3 + 2 ], n2 );
+        TLanes::Store( batch.Normal[ 9 + row ], nt );
+    }
+}
+
+} // namespace
+
+void apemode::Scene::UpdateSkinMatrices( const SceneSkin &              skin,
+                                         const SceneNodeTransformFrame *pSceneAnimatedFrame,
+                                         XMFLOAT4X4 *                   pOffsetMatrices,
+                                         XMFLOAT4X4 *                   pNormalMatrices,
+                                         size_t                         matrixCount ) const {
+    assert( pSceneAnimatedFrame && pOffsetMatrices );
+    assert( matrixCount >= skin.LinkIds.size( ) );
+    assert( skin.LinkIds.size( ) == skin.InvBindPoseMatrices.size( ) );
+
+    const size_t boneCount = skin.LinkIds.size( );
+    size_t       i         = 0;
+
+    for ( SkinMatrixBatch< 4 > batch; ( i + 4 ) <= boneCount; i += 4 ) {
+        batch.Gather( skin, *pSceneAnimatedFrame, i );
+        CalculateSkinMatrices< SkinMatrixLanes4 >( batch );
+        batch.Scatter( pOffsetMatrices + i, pNormalMatrices ? pNormalMatrices + i : nullptr );
+    }
+
+    for ( ; i < boneCount; ++i ) {
+        const XMMATRIX currentWorldMatrix = pSceneAnimatedFrame->GetWorldMatrix( skin.LinkIds[ i ] );
+        const XMMATRIX invBindPoseMatrix  = skin.InvBindPoseMatrices[ i ];
+        const XMMATRIX offsetMatrix       = CalculateOffsetMatrix( invBindPoseMatrix, currentWorldMatrix );
+
+        assert( IsValid( currentWorldMatrix ) );
+        assert( IsValid( invBindPoseMatrix ) );
+        assert( IsValid( offsetMatrix ) );
+
+        XMStoreFloat4x4( &pOffsetMatrices[ i ], offsetMatrix );
+        if ( pNormalMatrices ) {
+            XMStoreFloat4x4( &pNormalMatrices[ i ], XMMatrixTranspose( XMMatrixInverse( 0, offsetMatrix ) ) );
+        }
+    }
+}
+
+void apemode::Scene::UpdateSkinAffineMatrices( const SceneSkin &              skin,
+                                               const SceneNodeTransformFrame *pSceneAnimatedFrame,
+                                               XMFLOAT4 *                     pAffineRows,
+                                               size_t                         matrixCount ) const {
+    assert( pSceneAnimatedFrame && pAffineRows );
+    assert( matrixCount >= skin.LinkIds.size( ) );
+    assert( skin.LinkIds.size( ) == skin.InvBindPoseMatrices.size( ) );
+
+    const size_t boneCount = skin.LinkIds.size( );
+    size_t       i         = 0;
+
+    for ( SkinMatrixBatch< 4 > batch; ( i + 4 ) <= boneCount; i += 4 ) {
+        batch.Gather( skin, *pSceneAnimatedFrame, i );
+        CalculateSkinMatrices< SkinMatrixLanes4, false >( batch );
+        batch.ScatterAffine( pAffineRows + i * 3 );
+    }
+
+    for ( ; i < boneCount; ++i ) {
+        const XMMATRIX currentWorldMatrix = pSceneAnimatedFrame->GetWorldMatrix( skin.LinkIds[ i ] );
+        const XMMATRIX offsetMatrix       = CalculateOffsetMatrix( skin.InvBindPoseMatrices[ i ], currentWorldMatrix );
+        assert( IsValid( offsetMatrix ) );
+
+        const XMMATRIX affineMatrix = XMMatrixTranspose( offsetMatrix );
+        for ( uint32_t row = 0; row < 3; ++row ) {
+            XMStoreFloat4( &pAffineRows[ i * 3 + row ], affineMatrix.r[ row ] );
+        }
+    }
+}
+
+void apemode::Scene::UpdateSkinDualQuaternions( const SceneSkin &              skin,
+                                                const SceneNodeTransformFrame *pSceneAnimatedFrame,
+                                                XMFLOAT4 *                     pDualQuaternions,
+                                                size_t                         dualQuaternionCount ) const {
+    assert( pSceneAnimatedFrame && pDualQuaternions );
+    assert( dualQuaternionCount >= skin.LinkIds.size( ) );
+    assert( skin.LinkIds.size( ) == skin.InvBindPoseMatrices.size( ) );
+
+    const size_t boneCount = skin.LinkIds.size( );
+    for ( size_t i = 0; i < boneCount; ++i ) {
+        const XMMATRIX currentWorldMatrix = pSceneAnimatedFrame->GetWorldMatrix( skin.LinkIds[ i ] );
+        const XMMATRIX offsetMatrix       = CalculateOffsetMatrix( skin.InvBindPoseMatrices[ i ], currentWorldMatrix );
+        assert( IsValid( offsetMatrix ) );
+
+        XMVECTOR scaling;
+        XMVECTOR rotation;
+        XMVECTOR translation;
+        if ( !XMMatrixDecompose( &scaling, &rotation, &translation, offsetMatrix ) ) {
+            rotation    = XMQuaternionIdentity( );
+            translation = offsetMatrix.r[ 3 ];
+        }
+
+        // Keep the real parts in the same hemisphere, this reduces the sign flips when the bones are blended.
+        if ( XMVectorGetW( rotation ) < 0.0f ) {
+            rotation = XMVectorNegate( rotation );
+        }
+
+        // The dual part is 0.5 * t * r (Hamilton product, XMQuaternionMultiply( Q1, Q2 ) returns Q2 * Q1).
+        const XMVECTOR dual = XMVectorScale( XMQuaternionMultiply( rotation, XMVectorSetW( translation, 0.0f ) ), 0.5f );
+
+        XMStoreFloat4( &pDualQuaternions[ i * 2 + 0 ], rotation );
+        XMStoreFloat4( &pDualQuaternions[ i * 2 + 1 ], dual );
+    }
+}
+
+void apemode::Scene::UpdateSkinBoneBounds( const uint32_t meshId, const void *pVertices, const size_t verticesSize ) {
+    assert( meshId < Meshes.size( ) );
+
+    const SceneMesh &mesh = Meshes[ meshId ];
+    if ( mesh.SkinId == detail::kInvalidId || nullptr == pVertices ) {
+        return;
+    }
+
+    size_t vertexStride = 0;
+    switch ( mesh.eVertexType ) {
+        case detail::eVertexType_Skinned:
+            vertexStride = sizeof( detail::SkinnedVertex );
+            break;
+        case detail::eVertexType_FatSkinned:
+            vertexStride = sizeof( detail::FatSkinnedVertex );
+            break;
+        default:
+            return;
+    }
+
+    SceneSkin &  skin      = Skins[ mesh.SkinId ];
+    const size_t boneCount = skin.LinkIds.size( );
+    assert( skin.LinkIds.size( ) == skin.InvBindPoseMatrices.size( ) );
+
+    // The bounds are accumulated as min-max pairs, the bounds of the other meshes of the skin are extended.
+    const float                 maxFloat = std::numeric_limits< float >::max( );
+    apemode::vector< XMFLOAT3 > boundsMin( boneCount, XMFLOAT3{maxFloat, maxFloat, maxFloat} );
+    apemode::vector< XMFLOAT3 > boundsMax( boneCount, XMFLOAT3{-maxFloat, -maxFloat, -maxFloat} );
+
+    skin.BoneBounds.resize( boneCount );
+    for ( const uint32_t linkIndex : skin.BoundedLinkIndices ) {
+        const XMVECTOR center  = XMLoadFloat3( &skin.BoneBounds[ linkIndex ].Center );
+        const XMVECTOR extents = XMLoadFloat3( &skin.BoneBounds[ linkIndex ].Extents );
+        XMStoreFloat3( &boundsMin[ linkIndex ], XMVectorSubtract( center, extents ) );
+        XMStoreFloat3( &boundsMax[ linkIndex ], XMVectorAdd( center, extents ) );
+    }
+
+    const size_t   vertexCount = verticesSize / vertexStride;
+    const uint8_t *pVertexIt   = static_cast< const uint8_t * >( pVertices );
+
+    for ( size_t i = 0; i < vertexCount; ++i, pVertexIt += vertexStride ) {
+        const auto &   skinnedVertex = *reinterpret_cast< const detail::SkinnedVertex * >( pVertexIt );
+        const XMVECTOR position      = XMLoadFloat3( &skinnedVertex.defaultVertex.position );
+
+        // The bone indices and weights are packed as the integer and fractional parts (see the skinning vertex shaders).
+        float packedIndicesWeights[ 8 ] = {0};
+        memcpy( &packedIndicesWeights[ 0 ], &skinnedVertex.boneIndicesWeights, sizeof( XMFLOAT4 ) );
+        if ( mesh.eVertexType == detail::eVertexType_FatSkinned ) {
+            const auto &fatSkinnedVertex = *reinterpret_cast< const detail::FatSkinnedVertex * >( pVertexIt );
+            memcpy( &packedIndicesWeights[ 4 ], &fatSkinnedVertex.extraBoneIndicesWeights, sizeof( XMFLOAT4 ) );
+        }
+
+        for ( const float packedIndexWeight : packedIndicesWeights ) {
+            const float boneIndex  = floorf( packedIndexWeight );
+            const float boneWeight = packedIndexWeight - boneIndex;
+            if ( boneWeight <= 0.0f || boneIndex < 0.0f || boneIndex >= float( boneCount ) ) {
+                continue;
+            }
+
+            const size_t   linkIndex    = size_t( boneIndex );
+            const XMVECTOR bonePosition = XMVector3Transform( position, skin.InvBindPoseMatrices[ linkIndex ] );
+            XMStoreFloat3( &boundsMin[ linkIndex ], XMVectorMin( XMLoadFloat3( &boundsMin[ linkIndex ] ), bonePosition ) );
+            XMStoreFloat3( &boundsMax[ linkIndex ], XMVectorMax( XMLoadFloat3( &boundsMax[ linkIndex ] ), bonePosition ) );
+        }
+    }
+
+    skin.BoundedLinkIndices.clear( );
+    for ( uint32_t linkIndex = 0; linkIndex < uint32_t( boneCount ); ++linkIndex ) {
+        if ( boundsMin[ linkIndex ].x <= boundsMax[ linkIndex ].x ) {
+            apemode::BoundingBox::CreateFromPoints( skin.BoneBounds[ linkIndex ],
+                                                    XMLoadFloat3( &boundsMin[ linkIndex ] ),
+                                                    XMLoadFloat3( &boundsMax[ linkIndex ] ) );
+            skin.BoundedLinkIndices.push_back( linkIndex );
+        }
+    }
+}
+
+bool apemode::Scene::CalculateSkinBounds( const SceneSkin &              skin,
+                                          const SceneNodeTransformFrame &transformFrame,
+                                          apemode::BoundingBox &         outBounds ) const {
+    assert( transformFrame.GetNodeCount( ) == Nodes.size( ) );
+    if ( skin.BoundedLinkIndices.empty( ) ) {
+        return false;
+    }
+
+    XMVECTOR boundsMin = XMVectorReplicate( std::numeric_limits< float >::max( ) );
+    XMVECTOR boundsMax = XMVectorReplicate( -std::numeric_limits< float >::max( ) );
+
+    for ( const uint32_t linkIndex : skin.BoundedLinkIndices ) {
+        const apemode::BoundingBox &boneBounds  = skin.BoneBounds[ linkIndex ];
+        const XMMATRIX              worldMatrix = transformFrame.GetWorldMatrix( skin.LinkIds[ linkIndex ] );
+        const XMVECTOR              extents     = XMLoadFloat3( &boneBounds.Extents );
+
+        // The center is transformed, the extents are projected on the absolute axes of the matrix (tight for the affine matrices).
+        const XMVECTOR center = XMVector3Transform( XMLoadFloat3( &boneBounds.Center ), worldMatrix );
+        XMVECTOR worldExtents = XMVectorMultiply( XMVectorAbs( worldMatrix.r[ 0 ] ), XMVectorSplatX( extents ) );
+        worldExtents          = XMVectorMultiplyAdd( XMVectorAbs( worldMatrix.r[ 1 ] ), XMVectorSplatY( extents ), worldExtents );
+        worldExtents          = XMVectorMultiplyAdd( XMVectorAbs( worldMatrix.r[ 2 ] ), XMVectorSplatZ( extents ), worldExtents );
+
+        boundsMin = XMVectorMin( boundsMin, XMVectorSubtract( center, worldExtents ) );
+        boundsMax = XMVectorMax( boundsMax, XMVectorAdd( center, worldExtents ) );
+    }
+
+    apemode::BoundingBox::CreateFromPoints( outBounds, boundsMin, boundsMax );
+    return true;
+}
+
+void apemode::Scene::UpdateSkinBounds( const SceneNodeTransformFrame &transformFrame, SceneSkinBounds &skinBounds ) const {
+    // The frame can be empty before the first update.
+    const SceneNodeTransformFrame &frame = transformFrame.GetNodeCount( ) == Nodes.size( ) ? transformFrame : BindPoseFrame;
+
+    skinBounds.Bounds.resize( Skins.size( ) );
+    skinBounds.IsValid.resize( Skins.size( ) );
+
+    for ( size_t skinIndex = 0; skinIndex < Skins.size( ); ++skinIndex ) {
+        skinBounds.IsValid[ skinIndex ] = frame.GetNodeCount( ) == Nodes.size( ) &&
+                                          CalculateSkinBounds( Skins[ skinIndex ], frame, skinBounds.Bounds[ skinIndex ] );
+    }
+}
+
+bool IsRotationProperty( const apemode::SceneAnimCurve::EProperty eProperty ) {
+    switch ( eProperty ) {
+        case apemode::SceneAnimCurve::eProperty_LclRotation:
+        case apemode::SceneAnimCurve::eProperty_PreRotation:
+        case apemode::SceneAnimCurve::eProperty_PostRotation:
+        case apemode::SceneAnimCurve::eProperty_GeometricRotation:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+float *MapPropertyChannel( const uint32_t propertyChannelIndex, apemode::SceneNodeTransform *pProperties ) {
+    static_assert( sizeof( SceneNodeTransform ) == ( sizeof( float ) * SceneAnimCurve::ePropertyCount ), "Re-implement mapping with switch cases." );
+    assert( propertyChannelIndex < SceneAnimCurve::ePropertyCount );
+    return reinterpret_cast< float * >( pProperties ) + propertyChannelIndex;
+}
+
+namespace {
+
+/* Returns the time value looped within the animation time span.
+ */
+float LoopAnimTime( float time ) {
+    const float debugTimeSpan = 20;
+
+    XMFLOAT3 TimeMinMaxTotal;
+    TimeMinMaxTotal.x = 0;
+    TimeMinMaxTotal.y = debugTimeSpan;
+    TimeMinMaxTotal.z = debugTimeSpan;
+
+// Loop the given time value.
+#define SCENEANIMCURVE_USE_MODF
+#ifdef SCENEANIMCURVE_USE_MODF
+    float relativeTime, fractionalPart, integerPart;
+    relativeTime = ( time - TimeMinMaxTotal.x ) / TimeMinMaxTotal.z;
+    fractionalPart = modf( relativeTime, &integerPart );
+    time = TimeMinMaxTotal.x + TimeMinMaxTotal.z * fractionalPart;
+    (void) integerPart;
+#else
+    float relativeTime, fractionalPart;
+    relativeTime = ( time - TimeMinMaxTotal.x ) / TimeMinMaxTotal.z;
+    fractionalPart = relativeTime - (float) (long) relativeTime;
+    time = TimeMinMaxTotal.x + TimeMinMaxTotal.z * fractionalPart;
+#endif
+
+    return time;
+}
+
+/* Resets the frame to the bind pose (with the constant curves of the layer) if it was not animated with the layer before.
+ * Otherwise, only the animated nodes are reset (the rest of the frame remains in the rest pose).
+ */
+void ResetAnimTransformFrame( const apemode::Scene &   scene,
+                              const uint32_t           animLayerCompositeId,
+                              const SceneAnimLayer *   pAnimLayer,
+                              SceneNodeTransformFrame &frame ) {
+    if ( frame.GetNodeCount( ) != scene.BindPoseFrame.GetNodeCount( ) || frame.AnimLayerCompositeId != animLayerCompositeId ) {
+        frame                      = scene.BindPoseFrame;
+        frame.AnimLayerCompositeId = animLayerCompositeId;
+        frame.SetAllDirty( );
+
+        if ( pAnimLayer ) {
+            for ( size_t i = 0; i < pAnimLayer->ConstNodeIds.size( ); ++i ) {
+                frame.Properties[ pAnimLayer->ConstNodeIds[ i ] ] = pAnimLayer->ConstNodeProperties[ i ];
+            }
+        }
+    }
+}
+
+/* The adjacent rows of the quantized samples and the interpolation factor between them.
+ */
+struct QuantizedTrackSample {
+    const uint16_t *pSamples0 = nullptr;
+    const uint16_t *pSamples1 = nullptr;
+    float           Factor    = 0;
+
+    /* Returns the interpolated value of the track (the ranges include the track value factors once the layer is quantized).
+     */
+    float GetTrackValue( const SceneAnimQuantizedTracks &quantizedTracks, const uint32_t trackIndex ) const {
+        const float quantizedValue = float( pSamples0[ trackIndex ] ) + Factor * ( float( pSamples1[ trackIndex ] ) - float( pSamples0[ trackIndex ] ) );
+        return quantizedTracks.RangeMins[ trackIndex ] + quantizedTracks.RangeScales[ trackIndex ] * quantizedValue;
+    }
+};
+
+/* Returns the quantized samples at the given time, the time is clamped to the sampled range.
+ */
+QuantizedTrackSample GetQuantizedTrackSample( const SceneAnimQuantizedTracks &quantizedTracks, const size_t trackCount, const float time ) {
+    assert( quantizedTracks.SampleCount );
+
+    const float    lastSample  = float( quantizedTracks.SampleCount - 1 );
+    const float    sample      = eastl::min( eastl::max( ( time - quantizedTracks.TimeMin ) * quantizedTracks.SampleRate, 0.0f ), lastSample );
+    const uint32_t sampleIndex = eastl::min( static_cast< uint32_t >( sample ), quantizedTracks.SampleCount - 1 );
+
+    QuantizedTrackSample quantizedSample;
+    quantizedSample.pSamples0 = quantizedTracks.Samples.data( ) + size_t( sampleIndex ) * trackCount;
+    quantizedSample.pSamples1 = quantizedTracks.Samples.data( ) + size_t( eastl::min( sampleIndex + 1, quantizedTracks.SampleCount - 1 ) ) * trackCount;
+    quantizedSample.Factor    = sample - float( sampleIndex );
+    return quantizedSample;
+}
+
+} // namespace
+
+void apemode::Scene::UpdateTransformProperties( float                    time,
+                                                const bool               bLoop,
+                                                const uint16_t           animStackId,
+                                                const uint16_t           animLayerId,
+                                                SceneNodeTransformFrame *pAnimTransformFrame,
+                                                SceneAnimCursor *        pAnimCursor ) {
+    if ( bLoop ) {
+        time = LoopAnimTime( time );
+    }
+
+    if ( pAnimTransformFrame ) { //SceneNodeTransformFrame *pAnimTransformFrame = GetAnimatedTransformFrame( animStackId, animLayerId ) ) {
+        SceneAnimLayerId animLayerCompositeId;
+        animLayerCompositeId.AnimStackIndex = animStackId;
+        animLayerCompositeId.AnimLayerIndex = animLayerId;
+
+        const SceneAnimLayer *pAnimLayer = GetAnimLayer( animStackId, animLayerId );
+        ResetAnimTransformFrame( *this, animLayerCompositeId.AnimLayerCompositeId, pAnimLayer, *pAnimTransformFrame );
+        if ( !pAnimLayer ) {
+            return;
+        }
+
+        for ( size_t i = 0; i < pAnimLayer->NodeIds.size( ); ++i ) {
+            const uint32_t nodeId = pAnimLayer->NodeIds[ i ];
+            pAnimTransformFrame->Properties[ nodeId ] = pAnimLayer->NodeRestProperties[ i ];
+            pAnimTransformFrame->SetDirty( nodeId );
+        }
+
+        const uint32_t trackCount = static_cast< uint32_t >( pAnimLayer->TrackAnimCurveIds.size( ) );
+
+        // Interpolate the adjacent quantized samples of the tracks, and write the values to the property channels.
+        const SceneAnimQuantizedTracks &quantizedTracks = pAnimLayer->QuantizedTracks;
+        if ( quantizedTracks.SampleCount ) {
+            const QuantizedTrackSample quantizedSample = GetQuantizedTrackSample( quantizedTracks, trackCount, time );
+            for ( uint32_t i = 0; i < trackCount; ++i ) {
+                SceneNodeTransform &properties = pAnimTransformFrame->Properties[ pAnimLayer->TrackNodeIds[ i ] ];
+                *MapPropertyChannel( pAnimLayer->TrackPropertyChannels[ i ], &properties ) = quantizedSample.GetTrackValue( quantizedTracks, i );
+            }
+
+            return;
+        }
+
+        // Evaluate the tracks of the layer in batches, and write the values to the property channels.
+        constexpr uint32_t kTrackBatchSize = 64;
+        float              trackValues[ kTrackBatchSize ];
+
+        for ( uint32_t trackIndexBegin = 0; trackIndexBegin < trackCount; trackIndexBegin += kTrackBatchSize ) {
+            const uint32_t batchTrackCount = eastl::min( kTrackBatchSize, trackCount - trackIndexBegin );
+
+            CalculateAnimCurves( pAnimLayer->TrackAnimCurveIds.data( ) + trackIndexBegin, batchTrackCount, time, trackValues, pAnimCursor );
+
+            const uint32_t *pTrackNodeIds          = pAnimLayer->TrackNodeIds.data( ) + trackIndexBegin;
+            const uint8_t * pTrackPropertyChannels = pAnimLayer->TrackPropertyChannels.data( ) + trackIndexBegin;
+            const float *   pTrackValueFactors     = pAnimLayer->TrackValueFactors.data( ) + trackIndexBegin;
+
+            for ( uint32_t i = 0; i < batchTrackCount; ++i ) {
+                SceneNodeTransform &properties = pAnimTransformFrame->Properties[ pTrackNodeIds[ i ] ];
+                *MapPropertyChannel( pTrackPropertyChannels[ i ], &properties ) = trackValues[ i ] * pTrackValueFactors[ i ];
+            }
+        }
+
+#ifndef NDEBUG
+        for ( const uint32_t nodeId : pAnimLayer->NodeIds ) {
+            assert( pAnimTransformFrame->Properties[ nodeId ].Validate( ) );
+        }
+#endif
+
+        // return pAnimTransformFrame;
+    }
+
+    // return false;
+    // return nullptr;
+}
+
+namespace {
+
+constexpr int64_t kInvalidSampleIndex = std::numeric_limits< int64_t >::min( );
+
+/* Evaluates the pose for the sample index, and stores it to the ring of the cache (if not stored yet).
+ * @return Slot of the sample.
+ */
+uint32_t SamplePose( apemode::Scene &       scene,
+                     const SceneAnimLayer & animLayer,
+                     const int64_t          sampleIndex,
+                     const bool             bLoop,
+                     ScenePoseCache &       poseCache ) {
+    const int64_t  sampleCount = poseCache.SampleCount;
+    const uint32_t slot        = static_cast< uint32_t >( ( sampleIndex % sampleCount + sampleCount ) % sampleCount );
+    if ( poseCache.SampleIndices[ slot ] == sampleIndex ) {
+        return slot;
+    }
+
+    const float sampleTime = static_cast< float >( static_cast< double >( sampleIndex ) / poseCache.SampleRate );
+    scene.UpdateTransformProperties( sampleTime,
+                                     bLoop,
+                                     animLayer.AnimStackIndex,
+                                     animLayer.AnimLayerIndex,
+                                     &poseCache.SampleFrame,
+                                     &poseCache.AnimCursor );
+
+    const uint32_t baseIndex = slot * poseCache.NodeCount;
+    for ( uint32_t i = 0; i < poseCache.NodeCount; ++i ) {
+        const uint32_t   nodeId     = animLayer.NodeIds[ i ];
+        const SceneNode &node       = scene.Nodes[ nodeId ];
+        SceneNodeTransform properties = poseCache.SampleFrame.Properties[ nodeId ];
+
+        if ( node.ParentId != detail::kInvalidId && node.LimitsId != detail::kInvalidId ) {
+            properties.ApplyLimits( scene.Limits[ node.LimitsId ] );
+        }
+
+        // The scaling is applied before all the rotations, the local matrix can be decomposed without the shear.
+        XMVECTOR scaling, rotation, translation;
+        XMMatrixDecompose( &scaling, &rotation, &translation, GetLocalMatrixKernel( node.eTransformShape, node.eOrder )( properties ) );
+
+        poseCache.Properties[ baseIndex + i ] = properties;
+        XMStoreFloat3( &poseCache.Scalings[ baseIndex + i ], scaling );
+        XMStoreFloat4( &poseCache.Rotations[ baseIndex + i ], rotation );
+        XMStoreFloat3( &poseCache.Translations[ baseIndex + i ], translation );
+    }
+
+    poseCache.SampleIndices[ slot ] = sampleIndex;
+    return slot;
+}
+
+} // namespace
+
+void apemode::Scene::InitializePoseCache( ScenePoseCache &poseCache, const float sampleRate, const uint32_t sampleCount ) const {
+    assert( sampleRate > 0 && sampleCount >= 2 );
+
+    poseCache             = ScenePoseCache( );
+    poseCache.SampleRate  = sampleRate;
+    poseCache.SampleCount = eastl::max( sampleCount, 2u );
+    InitializeAnimCursor( poseCache.AnimCursor );
+}
+
+void apemode::Scene::UpdateTransformPropertiesCached( const float              time,
+                                                      const bool               bLoop,
+                                                      const uint16_t           animStackId,
+                                                      const uint16_t           animLayerId,
+                                                      SceneNodeTransformFrame *pAnimTransformFrame,
+                                                      ScenePoseCache *         pPoseCache ) {
+    assert( pPoseCache && pPoseCache->SampleRate > 0 );
+    if ( !pAnimTransformFrame || !pPoseCache ) {
+        return;
+    }
+
+    SceneAnimLayerId animLayerCompositeId;
+    animLayerCompositeId.AnimStackIndex = animStackId;
+    animLayerCompositeId.AnimLayerIndex = animLayerId;
+
+    const SceneAnimLayer *pAnimLayer = GetAnimLayer( animStackId, animLayerId );
+    ResetAnimTransformFrame( *this, animLayerCompositeId.AnimLayerCompositeId, pAnimLayer, *pAnimTransformFrame );
+    if ( !pAnimLayer ) {
+        return;
+    }
+
+    // The samples are dropped when the layer changes.
+    const uint32_t nodeCount = static_cast< uint32_t >( pAnimLayer->NodeIds.size( ) );
+    if ( pPoseCache->AnimLayerCompositeId != animLayerCompositeId.AnimLayerCompositeId || pPoseCache->NodeCount != nodeCount ) {
+        const size_t sampleNodeCount = size_t( pPoseCache->SampleCount ) * nodeCount;
+
+        pPoseCache->AnimLayerCompositeId = animLayerCompositeId.AnimLayerCompositeId;
+        pPoseCache->NodeCount            = nodeCount;
+        pPoseCache->SampleIndices.assign( pPoseCache->SampleCount, kInvalidSampleIndex );
+        pPoseCache->Properties.resize( sampleNodeCount );
+        pPoseCache->Scalings.resize( sampleNodeCount );
+        pPoseCache->Rotations.resize( sampleNodeCount );
+        pPoseCache->Translations.resize( sampleNodeCount );
+    }
+
+    const double  sampleTime  = static_cast< double >( time ) * pPoseCache->SampleRate;
+    const double  sampleFloor = floor( sampleTime );
+    const int64_t sampleIndex = static_cast< int64_t >( sampleFloor );
+    const float   t           = static_cast< float >( sampleTime - sampleFloor );
+
+    const uint32_t baseIndex0 = SamplePose( *this, *pAnimLayer, sampleIndex, bLoop, *pPoseCache ) * nodeCount;
+    const uint32_t baseIndex1 = SamplePose( *this, *pAnimLayer, sampleIndex + 1, bLoop, *pPoseCache ) * nodeCount;
+
+    for ( uint32_t i = 0; i < nodeCount; ++i ) {
+        const uint32_t nodeId = pAnimLayer->NodeIds[ i ];
+
+        const XMVECTOR scaling = XMVectorLerp( XMLoadFloat3( &pPoseCache->Scalings[ baseIndex0 + i ] ),
+                                               XMLoadFloat3( &pPoseCache->Scalings[ baseIndex1 + i ] ),
+                                               t );
+        const XMVECTOR rotation = XMQuaternionSlerp( XMLoadFloat4( &pPoseCache->Rotations[ baseIndex0 + i ] ),
+                                                     XMLoadFloat4( &pPoseCache->Rotations[ baseIndex1 + i ] ),
+                                                     t );
+        const XMVECTOR translation = XMVectorLerp( XMLoadFloat3( &pPoseCache->Translations[ baseIndex0 + i ] ),
+                                                   XMLoadFloat3( &pPoseCache->Translations[ baseIndex1 + i ] ),
+                                                   t );
+
+        // The local matrix is reused by the hierarchy update.
+        pAnimTransformFrame->Properties[ nodeId ] = pPoseCache->Properties[ baseIndex0 + i ];
+        pAnimTransformFrame->SetLocalMatrix( nodeId, XMMatrixAffineTransformation( scaling, XMVectorZero( ), rotation, translation ) );
+    }
+}
+
+void apemode::Scene::InitializeAnimLod( SceneAnimLod &animLod, const SceneAnimLod::Level *pLevels, const size_t levelCount ) const {
+    assert( ( pLevels || !levelCount ) && levelCount < SceneAnimLod::kFullRateLevel );
+
+    const size_t nodeCount = Nodes.size( );
+
+    animLod = SceneAnimLod( );
+    animLod.Levels.assign( pLevels, pLevels + levelCount );
+    eastl::stable_sort( animLod.Levels.begin( ), animLod.Levels.end( ), []( const SceneAnimLod::Level &a, const SceneAnimLod::Level &b ) {
+        return a.MinScreenSize > b.MinScreenSize;
+    } );
+
+    animLod.SkinRadii.assign( Skins.size( ), 0.0f );
+    animLod.SkinLevels.assign( Skins.size( ), SceneAnimLod::kFullRateLevel );
+    animLod.NodeInfluences.assign( nodeCount, 1.0f );
+    animLod.NodeLevels.assign( nodeCount, SceneAnimLod::kFullRateLevel );
+    animLod.NodePruned.assign( nodeCount, 0 );
+
+    if ( BindPoseFrame.GetNodeCount( ) != nodeCount ) {
+        return;
+    }
+
+    // The tags are the skin index + 1, so that the arrays are not cleared for each skin.
+    std::vector< uint32_t > linkTags( nodeCount, 0 );
+    std::vector< uint32_t > parentTags( nodeCount, 0 );
+    std::vector< uint8_t >  influenceAssigned( nodeCount, 0 );
+
+    for ( size_t skinIndex = 0; skinIndex < Skins.size( ); ++skinIndex ) {
+        const SceneSkin &skin = Skins[ skinIndex ];
+        if ( skin.LinkIds.empty( ) ) {
+            continue;
+        }
+
+        const uint32_t tag = static_cast< uint32_t >( skinIndex + 1 );
+
+        XMVECTOR centroid = XMVectorZero( );
+        for ( const uint32_t linkId : skin.LinkIds ) {
+            centroid = XMVectorAdd( centroid, BindPoseFrame.GetWorldMatrix( linkId ).r[ 3 ] );
+            linkTags[ linkId ] = tag;
+        }
+        centroid = XMVectorScale( centroid, 1.0f / float( skin.LinkIds.size( ) ) );
+
+        float radius = 0.0f;
+        for ( const uint32_t linkId : skin.LinkIds ) {
+            const XMVECTOR position = BindPoseFrame.GetWorldMatrix( linkId ).r[ 3 ];
+            radius = eastl::max( radius, XMVectorGetX( XMVector3Length( XMVectorSubtract( position, centroid ) ) ) );
+
+            const uint32_t parentId = Nodes[ linkId ].ParentId;
+            if ( parentId != detail::kInvalidId && linkTags[ parentId ] == tag ) {
+                parentTags[ parentId ] = tag;
+            }
+        }
+
+        radius = eastl::max( radius, std::numeric_limits< float >::epsilon( ) );
+        animLod.SkinRadii[ skinIndex ] = radius;
+
+        // The leaf bones are weighted by their lengths relative to the skin size, the root and inner bones are never pruned.
+        for ( const uint32_t linkId : skin.LinkIds ) {
+            const uint32_t parentId  = Nodes[ linkId ].ParentId;
+            float          influence = 1.0f;
+
+            if ( parentTags[ linkId ] != tag && parentId != detail::kInvalidId && linkTags[ parentId ] == tag ) {
+                const XMVECTOR bone = XMVectorSubtract( BindPoseFrame.GetWorldMatrix( linkId ).r[ 3 ], BindPoseFrame.GetWorldMatrix( parentId ).r[ 3 ] );
+                influence = eastl::min( XMVectorGetX( XMVector3Length( bone ) ) / ( 2.0f * radius ), 1.0f );
+            }
+
+            // The node is kept if it is significant for any of the skins.
+            animLod.NodeInfluences[ linkId ] = influenceAssigned[ linkId ] ? eastl::max( animLod.NodeInfluences[ linkId ], influence ) : influence;
+            influenceAssigned[ linkId ] = 1;
+        }
+    }
+}
+
+void apemode::Scene::UpdateAnimLod( SceneAnimLod &                 animLod,
+                                    const SceneNodeTransformFrame &transformFrame,
+                                    FXMMATRIX                      viewMatrix,
+                                    const float                    projectionScale ) const {
+    const size_t nodeCount = Nodes.size( );
+    if ( animLod.NodeLevels.size( ) != nodeCount || animLod.SkinRadii.size( ) != Skins.size( ) ) {
+        return;
+    }
+
+    // The frame can be empty before the first update.
+    const SceneNodeTransformFrame &frame = transformFrame.GetNodeCount( ) == nodeCount ? transformFrame : BindPoseFrame;
+
+    animLod.NodeLevels.assign( nodeCount, SceneAnimLod::kFullRateLevel );
+    animLod.NodePruned.assign( nodeCount, 0 );
+    if ( animLod.Levels.empty( ) || frame.GetNodeCount( ) != nodeCount ) {
+        return;
+    }
+
+    const uint8_t lastLevel = static_cast< uint8_t >( animLod.Levels.size( ) - 1 );
+
+    for ( size_t skinIndex = 0; skinIndex < Skins.size( ); ++skinIndex ) {
+        const SceneSkin &skin = Skins[ skinIndex ];
+        if ( skin.LinkIds.empty( ) ) {
+            continue;
+        }
+
+        XMVECTOR centroid = XMVectorZero( );
+        for ( const uint32_t linkId : skin.LinkIds ) {
+            centroid = XMVectorAdd( centroid, frame.GetWorldMatrix( linkId ).r[ 3 ] );
+        }
+        centroid = XMVectorScale( centroid, 1.0f / float( skin.LinkIds.size( ) ) );
+
+        // The distance (rather than the view depth) keeps the levels stable when the camera rotates.
+        const float radius     = animLod.SkinRadii[ skinIndex ];
+        const float distance   = XMVectorGetX( XMVector3Length( XMVector3TransformCoord( centroid, viewMatrix ) ) );
+        const float screenSize = distance > radius ? 2.0f * radius * projectionScale / distance : std::numeric_limits< float >::max( );
+
+        uint8_t level = lastLevel;
+        for ( uint8_t i = 0; i < lastLevel; ++i ) {
+            if ( screenSize >= animLod.Levels[ i ].MinScreenSize ) {
+                level = i;
+                break;
+            }
+        }
+
+        animLod.SkinLevels[ skinIndex ] = level;
+
+        // The shared bones are evaluated at the finest level of their skins (kFullRateLevel is the largest value).
+        for ( const uint32_t linkId : skin.LinkIds ) {
+            animLod.NodeLevels[ linkId ] = eastl::min( animLod.NodeLevels[ linkId ], level );
+        }
+    }
+
+    for ( size_t nodeId = 0; nodeId < nodeCount; ++nodeId ) {
+        const uint8_t level = animLod.NodeLevels[ nodeId ];
+        if ( level != SceneAnimLod::kFullRateLevel ) {
+            animLod.NodePruned[ nodeId ] = animLod.NodeInfluences[ nodeId ] < animLod.Levels[ level ].MinBoneInfluence;
+        }
+    }
+}
+
+namespace {
+
+/* Evaluates the tracks of the layer at the given time (the quantized samples are interpolated if present).
+ * The values are written to the output array in the order of the track indices.
+ */
+void CalculateAnimLayerTracks( const apemode::Scene & scene,
+                               const SceneAnimLayer & animLayer,
+                               const uint32_t *       pTrackIndices,
+                               const size_t           trackIndexCount,
+                               const float            time,
+                               float *                pOutValues,
+                               SceneAnimCursor *      pAnimCursor ) {
+    const SceneAnimQuantizedTracks &quantizedTracks = animLayer.QuantizedTracks;
+    if ( quantizedTracks.SampleCount ) {
+        const QuantizedTrackSample quantizedSample = GetQuantizedTrackSample( quantizedTracks, animLayer.TrackAnimCurveIds.size( ), time );
+        for ( size_t i = 0; i < trackIndexCount; ++i ) {
+            pOutValues[ i ] = quantizedSample.GetTrackValue( quantizedTracks, pTrackIndices[ i ] );
+        }
+
+        return;
+    }
+
+    constexpr size_t kTrackBatchSize = 64;
+    uint32_t         animCurveIds[ kTrackBatchSize ];
+
+    for ( size_t trackIndexBegin = 0; trackIndexBegin < trackIndexCount; trackIndexBegin += kTrackBatchSize ) {
+        const size_t batchTrackCount = eastl::min( kTrackBatchSize, trackIndexCount - trackIndexBegin );
+        for ( size_t i = 0; i < batchTrackCount; ++i ) {
+            animCurveIds[ i ] = animLayer.TrackAnimCurveIds[ pTrackIndices[ trackIndexBegin + i ] ];
+        }
+
+        scene.CalculateAnimCurves( animCurveIds, batchTrackCount, time, pOutValues + trackIndexBegin, pAnimCursor );
+
+        for ( size_t i = 0; i < batchTrackCount; ++i ) {
+            pOutValues[ trackIndexBegin + i ] *= animLayer.TrackValueFactors[ pTrackIndices[ trackIndexBegin + i ] ];
+        }
+    }
+}
+
+} // namespace
+
+void apemode::Scene::UpdateTransformPropertiesLod( float                    time,
+                                                   const bool               bLoop,
+                                                   const uint16_t           animStackId,
+                                                   const uint16_t           animLayerId,
+                                                   SceneNodeTransformFrame *pAnimTransformFrame,
+                                                   SceneAnimLod *           pAnimLod,
+                                                   SceneAnimCursor *        pAnimCursor ) {
+    assert( pAnimLod );
+    if ( !pAnimTransformFrame || !pAnimLod ) {
+        return;
+    }
+
+    if ( bLoop ) {
+        time = LoopAnimTime( time );
+    }
+
+    // Not initialized, all the nodes are evaluated at the full rate.
+    if ( pAnimLod->NodeLevels.size( ) != Nodes.size( ) ) {
+        UpdateTransformProperties( time, false, animStackId, animLayerId, pAnimTransformFrame, pAnimCursor );
+        return;
+    }
+
+    SceneAnimLayerId animLayerCompositeId;
+    animLayerCompositeId.AnimStackIndex = animStackId;
+    animLayerCompositeId.AnimLayerIndex = animLayerId;
+
+    const SceneAnimLayer *pAnimLayer = GetAnimLayer( animStackId, animLayerId );
+    ResetAnimTransformFrame( *this, animLayerCompositeId.AnimLayerCompositeId, pAnimLayer, *pAnimTransformFrame );
+    if ( !pAnimLayer ) {
+        return;
+    }
+
+    // The samples are dropped when the layer changes.
+    const uint32_t trackCount = static_cast< uint32_t >( pAnimLayer->TrackAnimCurveIds.size( ) );
+    if ( pAnimLod->AnimLayerCompositeId != animLayerCompositeId.AnimLayerCompositeId || pAnimLod->TrackSampleIndices.size( ) != trackCount ) {
+        pAnimLod->AnimLayerCompositeId = animLayerCompositeId.AnimLayerCompositeId;
+        pAnimLod->TrackSampleIndices.assign( trackCount, kInvalidSampleIndex );
+        pAnimLod->TrackSampleLevels.assign( trackCount, SceneAnimLod::kFullRateLevel );
+        pAnimLod->TrackSamples0.resize( trackCount );
+        pAnimLod->TrackSamples1.resize( trackCount );
+    }
+
+    // The pruned nodes keep their properties and local matrices.
+    for ( size_t i = 0; i < pAnimLayer->NodeIds.size( ); ++i ) {
+        const uint32_t nodeId = pAnimLayer->NodeIds[ i ];
+        if ( !pAnimLod->NodePruned[ nodeId ] ) {
+            pAnimTransformFrame->Properties[ nodeId ] = pAnimLayer->NodeRestProperties[ i ];
+            pAnimTransformFrame->SetDirty( nodeId );
+        }
+    }
+
+    std::vector< uint32_t > &trackIndices  = pAnimLod->TempTrackIndices[ 0 ];
+    std::vector< uint32_t > &trackIndices0 = pAnimLod->TempTrackIndices[ 1 ];
+    std::vector< uint32_t > &trackIndices1 = pAnimLod->TempTrackIndices[ 2 ];
+    std::vector< float > &   trackValues   = pAnimLod->TempTrackValues;
+    trackValues.resize( trackCount );
+
+    auto isFullRateLevel = [pAnimLod]( const uint8_t level ) {
+        return level == SceneAnimLod::kFullRateLevel || pAnimLod->Levels[ level ].SampleRate <= 0.0f;
+    };
+
+    // The nodes of no skin and the nodes of the full rate levels are evaluated at the time.
+    trackIndices.clear( );
+    for ( uint32_t i = 0; i < trackCount; ++i ) {
+        const uint32_t nodeId = pAnimLayer->TrackNodeIds[ i ];
+        if ( !pAnimLod->NodePruned[ nodeId ] && isFullRateLevel( pAnimLod->NodeLevels[ nodeId ] ) ) {
+            trackIndices.push_back( i );
+        }
+    }
+
+    CalculateAnimLayerTracks( *this, *pAnimLayer, trackIndices.data( ), trackIndices.size( ), time, trackValues.data( ), pAnimCursor );
+    for ( size_t i = 0; i < trackIndices.size( ); ++i ) {
+        const uint32_t trackIndex = trackIndices[ i ];
+        SceneNodeTransform &properties = pAnimTransformFrame->Properties[ pAnimLayer->TrackNodeIds[ trackIndex ] ];
+        *MapPropertyChannel( pAnimLayer->TrackPropertyChannels[ trackIndex ], &properties ) = trackValues[ i ];
+    }
+
+    // The nodes of the reduced rate levels interpolate the adjacent samples of the level rate.
+    // The samples are kept between the updates, usually only the next sample is evaluated when the sample index advances.
+    for ( size_t levelIndex = 0; levelIndex < pAnimLod->Levels.size( ); ++levelIndex ) {
+        const uint8_t level = static_cast< uint8_t >( levelIndex );
+        if ( isFullRateLevel( level ) ) {
+            continue;
+        }
+
+        const float   sampleRate  = pAnimLod->Levels[ level ].SampleRate;
+        const double  sampleTime  = static_cast< double >( time ) * sampleRate;
+        const double  sampleFloor = floor( sampleTime );
+        const int64_t sampleIndex = static_cast< int64_t >( sampleFloor );
+        const float   t           = static_cast< float >( sampleTime - sampleFloor );
+
+        trackIndices.clear( );
+        trackIndices0.clear( );
+        trackIndices1.clear( );
+
+        for ( uint32_t i = 0; i < trackCount; ++i ) {
+            const uint32_t nodeId = pAnimLayer->TrackNodeIds[ i ];
+            if ( pAnimLod->NodePruned[ nodeId ] || pAnimLod->NodeLevels[ nodeId ] != level ) {
+                continue;
+            }
+
+            trackIndices.push_back( i );
+
+            // The sample indices of the other levels are in the other rate units.
+            int64_t &trackSampleIndex = pAnimLod->TrackSampleIndices[ i ];
+            if ( pAnimLod->TrackSampleLevels[ i ] != level ) {
+                pAnimLod->TrackSampleLevels[ i ] = level;
+                trackSampleIndex                 = kInvalidSampleIndex;
+            }
+
+            if ( trackSampleIndex == sampleIndex ) {
+                continue;
+            }
+
+            if ( trackSampleIndex != kInvalidSampleIndex && trackSampleIndex + 1 == sampleIndex ) {
+                pAnimLod->TrackSamples0[ i ] = pAnimLod->TrackSamples1[ i ];
+            } else {
+                trackIndices0.push_back( i );
+            }
+
+            trackIndices1.push_back( i );
+            trackSampleIndex = sampleIndex;
+        }
+
+        float sampleTime0 = static_cast< float >( static_cast< double >( sampleIndex ) / sampleRate );
+        float sampleTime1 = static_cast< float >( static_cast< double >( sampleIndex + 1 ) / sampleRate );
+        if ( bLoop ) {
+            sampleTime0 = LoopAnimTime( sampleTime0 );
+            sampleTime1 = LoopAnimTime( sampleTime1 );
+        }
+
+        CalculateAnimLayerTracks( *this, *pAnimLayer, trackIndices0.data( ), trackIndices0.size( ), sampleTime0, trackValues.data( ), pAnimCursor );
+        for ( size_t i = 0; i < trackIndices0.size( ); ++i ) {
+            pAnimLod->TrackSamples0[ trackIndices0[ i ] ] = trackValues[ i ];
+        }
+
+        CalculateAnimLayerTracks( *this, *pAnimLayer, trackIndices1.data( ), trackIndices1.size( ), sampleTime1, trackValues.data( ), pAnimCursor );
+        for ( size_t i = 0; i < trackIndices1.size( ); ++i ) {
+            pAnimLod->TrackSamples1[ trackIndices1[ i ] ] = trackValues[ i ];
+        }
+
+        for ( const uint32_t trackIndex : trackIndices ) {
+            const float value0 = pAnimLod->TrackSamples0[ trackIndex ];
+            const float value1 = pAnimLod->TrackSamples1[ trackIndex ];
+
+            SceneNodeTransform &properties = pAnimTransformFrame->Properties[ pAnimLayer->TrackNodeIds[ trackIndex ] ];
+            *MapPropertyChannel( pAnimLayer->TrackPropertyChannels[ trackIndex ], &properties ) = value0 + t * ( value1 - value0 );
+        }
+    }
+
+#ifndef NDEBUG
+    for ( const uint32_t nodeId : pAnimLayer->NodeIds ) {
+        assert( pAnimTransformFrame->Properties[ nodeId ].Validate( ) );
+    }
+#endif
+}
+
+namespace {
+
+/* Rebuilds the evaluation state of the blend if the layers of the inputs changed.
+ * @return True if the state was rebuilt.
+ */
+bool PrepareAnimBlend( const apemode::Scene &scene, SceneAnimBlend &animBlend ) {
+    const size_t inputCount = animBlend.Inputs.size( );
+
+    auto getAnimLayerCompositeId = [&]( const size_t i ) {
+        SceneAnimLayerId animLayerCompositeId;
+        animLayerCompositeId.AnimStackIndex = animBlend.Inputs[ i ].AnimStackId;
+        animLayerCompositeId.AnimLayerIndex = animBlend.Inputs[ i ].AnimLayerId;
+        return animLayerCompositeId.AnimLayerCompositeId;
+    };
+
+    // Called every frame, the layers are compared in place.
+    bool bPrepared = animBlend.PreparedLayerIds.size( ) == inputCount && animBlend.NodeSlots.size( ) == scene.Nodes.size( );
+    for ( size_t i = 0; bPrepared && i < inputCount; ++i ) {
+        bPrepared = animBlend.PreparedLayerIds[ i ] == getAnimLayerCompositeId( i );
+    }
+
+    if ( bPrepared ) {
+        return false;
+    }
+
+    animBlend.PreparedLayerIds.resize( inputCount );
+    for ( size_t i = 0; i < inputCount; ++i ) {
+        animBlend.PreparedLayerIds[ i ] = getAnimLayerCompositeId( i );
+    }
+
+    animBlend.NodeIds.clear( );
+    animBlend.NodeSlots.assign( scene.Nodes.size( ), detail::kInvalidId );
+
+    for ( const SceneAnimBlendInput &input : animBlend.Inputs ) {
+        if ( const SceneAnimLayer *pAnimLayer = scene.GetAnimLayer( input.AnimStackId, input.AnimLayerId ) ) {
+            animBlend.NodeIds.insert( animBlend.NodeIds.end( ), pAnimLayer->NodeIds.begin( ), pAnimLayer->NodeIds.end( ) );
+            animBlend.NodeIds.insert( animBlend.NodeIds.end( ), pAnimLayer->ConstNodeIds.begin( ), pAnimLayer->ConstNodeIds.end( ) );
+        }
+    }
+
+    eastl::sort( animBlend.NodeIds.begin( ), animBlend.NodeIds.end( ) );
+    animBlend.NodeIds.erase( eastl::unique( animBlend.NodeIds.begin( ), animBlend.NodeIds.end( ) ), animBlend.NodeIds.end( ) );
+
+    const size_t slotCount = animBlend.NodeIds.size( );
+    for ( size_t slot = 0; slot < slotCount; ++slot ) {
+        animBlend.NodeSlots[ animBlend.NodeIds[ slot ] ] = static_cast< uint32_t >( slot );
+    }
+
+    // The nodes that are not animated by the layer of the input stay in the bind pose (with the constant curves of the layer).
+    animBlend.InputRestProperties.resize( inputCount * slotCount );
+    animBlend.InputProperties.resize( inputCount * slotCount );
+    animBlend.AnimCursors.resize( inputCount );
+
+    for ( size_t i = 0; i < inputCount; ++i ) {
+        SceneNodeTransform *pRestProperties = animBlend.InputRestProperties.data( ) + i * slotCount;
+        for ( size_t slot = 0; slot < slotCount; ++slot ) {
+            pRestProperties[ slot ] = scene.BindPoseFrame.Properties[ animBlend.NodeIds[ slot ] ];
+        }
+
+        if ( const SceneAnimLayer *pAnimLayer = scene.GetAnimLayer( animBlend.Inputs[ i ].AnimStackId, animBlend.Inputs[ i ].AnimLayerId ) ) {
+            for ( size_t j = 0; j < pAnimLayer->ConstNodeIds.size( ); ++j ) {
+                pRestProperties[ animBlend.NodeSlots[ pAnimLayer->ConstNodeIds[ j ] ] ] = pAnimLayer->ConstNodeProperties[ j ];
+            }
+
+            for ( size_t j = 0; j < pAnimLayer->NodeIds.size( ); ++j ) {
+                pRestProperties[ animBlend.NodeSlots[ pAnimLayer->NodeIds[ j ] ] ] = pAnimLayer->NodeRestProperties[ j ];
+            }
+        }
+
+        scene.InitializeAnimCursor( animBlend.AnimCursors[ i ] );
+    }
+
+    return true;
+}
+
+/* Decomposes the local matrix of the node with the given properties (the limits are applied).
+ */
+void DecomposeLocalTransform( const apemode::Scene &scene,
+                              const SceneNode &     node,
+                              SceneNodeTransform    properties,
+                              XMVECTOR &            scaling,
+                              XMVECTOR &            rotation,
+                              XMVECTOR &            translation ) {
+    if ( node.ParentId != detail::kInvalidId && node.LimitsId != detail::kInvalidId ) {
+        properties.ApplyLimits( scene.Limits[ node.LimitsId ] );
+    }
+
+    // The scaling is applied before all the rotations, the local matrix can be decomposed without the shear.
+    XMMatrixDecompose( &scaling, &rotation, &translation, GetLocalMatrixKernel( node.eTransformShape, node.eOrder )( properties ) );
+}
+
+} // namespace
+
+void apemode::Scene::UpdateTransformPropertiesBlended( const float              time,
+                                                       const bool               bLoop,
+                                                       SceneAnimBlend *         pAnimBlend,
+                                                       SceneNodeTransformFrame *pAnimTransformFrame ) {
+    assert( pAnimBlend );
+    if ( !pAnimTransformFrame || !pAnimBlend ) {
+        return;
+    }
+
+    const bool bPrepared = PrepareAnimBlend( *this, *pAnimBlend );
+
+    // The nodes outside of the union of the layers stay in the bind pose.
+    if ( bPrepared || pAnimTransformFrame->GetNodeCount( ) != BindPoseFrame.GetNodeCount( ) ||
+         pAnimTransformFrame->AnimLayerCompositeId != SceneAnimBlend::kAnimLayerCompositeId ) {
+        *pAnimTransformFrame                      = BindPoseFrame;
+        pAnimTransformFrame->AnimLayerCompositeId = SceneAnimBlend::kAnimLayerCompositeId;
+        pAnimTransformFrame->SetAllDirty( );
+    }
+
+    const size_t inputCount = pAnimBlend->Inputs.size( );
+    const size_t slotCount  = pAnimBlend->NodeIds.size( );
+    if ( !slotCount ) {
+        return;
+    }
+
+    // The cross-fades scale the weights of their inputs.
+    pAnimBlend->InputWeights.resize( inputCount );
+    for ( size_t i = 0; i < inputCount; ++i ) {
+        pAnimBlend->InputWeights[ i ] = eastl::max( pAnimBlend->Inputs[ i ].Weight, 0.0f );
+    }
+
+    for ( const SceneAnimCrossFade &crossFade : pAnimBlend->CrossFades ) {
+        assert( crossFade.FromInputIndex < inputCount && crossFade.ToInputIndex < inputCount );
+
+        const float t = crossFade.Duration > 0.0f ? eastl::min( eastl::max( ( time - crossFade.StartTime ) / crossFade.Duration, 0.0f ), 1.0f )
+                                                  : ( time >= crossFade.StartTime ? 1.0f : 0.0f );
+        pAnimBlend->InputWeights[ crossFade.FromInputIndex ] *= 1.0f - t;
+        pAnimBlend->InputWeights[ crossFade.ToInputIndex ] *= t;
+    }
+
+    // Evaluate the tracks of each weighted input to its own properties.
+    for ( size_t i = 0; i < inputCount; ++i ) {
+        const SceneAnimBlendInput &input      = pAnimBlend->Inputs[ i ];
+        const SceneAnimLayer *     pAnimLayer = GetAnimLayer( input.AnimStackId, input.AnimLayerId );
+        if ( !pAnimLayer || pAnimBlend->InputWeights[ i ] <= 0.0f ) {
+            continue;
+        }
+
+        SceneNodeTransform *pInputProperties = pAnimBlend->InputProperties.data( ) + i * slotCount;
+        memcpy( pInputProperties, pAnimBlend->InputRestProperties.data( ) + i * slotCount, sizeof( SceneNodeTransform ) * slotCount );
+
+        float inputTime = time * input.TimeScale + input.TimeOffset;
+        if ( bLoop ) {
+            inputTime = LoopAnimTime( inputTime );
+        }
+
+        const size_t trackCount = pAnimLayer->TrackAnimCurveIds.size( );
+        pAnimBlend->TempTrackIndices.resize( trackCount );
+        pAnimBlend->TempTrackValues.resize( trackCount );
+        for ( size_t j = 0; j < trackCount; ++j ) {
+            pAnimBlend->TempTrackIndices[ j ] = static_cast< uint32_t >( j );
+        }
+
+        CalculateAnimLayerTracks( *this,
+                                  *pAnimLayer,
+                                  pAnimBlend->TempTrackIndices.data( ),
+                                  trackCount,
+                                  inputTime,
+                                  pAnimBlend->TempTrackValues.data( ),
+                                  &pAnimBlend->AnimCursors[ i ] );
+
+        for ( size_t j = 0; j < trackCount; ++j ) {
+            SceneNodeTransform &properties = pInputProperties[ pAnimBlend->NodeSlots[ pAnimLayer->TrackNodeIds[ j ] ] ];
+            *MapPropertyChannel( pAnimLayer->TrackPropertyChannels[ j ], &properties ) = pAnimBlend->TempTrackValues[ j ];
+        }
+    }
+
+    // Blend the local transforms of the inputs in a single pass over the nodes.
+    for ( size_t slot = 0; slot < slotCount; ++slot ) {
+        const uint32_t   nodeId = pAnimBlend->NodeIds[ slot ];
+        const SceneNode &node   = Nodes[ nodeId ];
+
+        XMVECTOR scaling     = XMVectorZero( );
+        XMVECTOR rotation    = XMVectorZero( );
+        XMVECTOR translation = XMVectorZero( );
+        float    weightSum   = 0.0f;
+
+        // The properties of the input with the largest weight are kept for the geometric transform.
+        const SceneNodeTransform *pDominantProperties = &BindPoseFrame.Properties[ nodeId ];
+        float                     dominantWeight      = 0.0f;
+        bool                      bHasAdditiveInputs  = false;
+
+        for ( size_t i = 0; i < inputCount; ++i ) {
+            const float weight = pAnimBlend->InputWeights[ i ];
+            if ( weight <= 0.0f ) {
+                continue;
+            }
+
+            if ( pAnimBlend->Inputs[ i ].bAdditive ) {
+                bHasAdditiveInputs = true;
+                continue;
+            }
+
+            const SceneNodeTransform &properties = pAnimBlend->InputProperties[ i * slotCount + slot ];
+
+            XMVECTOR inputScaling, inputRotation, inputTranslation;
+            DecomposeLocalTransform( *this, node, properties, inputScaling, inputRotation, inputTranslation );
+
+            // The rotations are accumulated in the same hemisphere.
+            if ( XMVectorGetX( XMVector4Dot( rotation, inputRotation ) ) < 0.0f ) {
+                inputRotation = XMVectorNegate( inputRotation );
+            }
+
+            scaling     = XMVectorMultiplyAdd( inputScaling, XMVectorReplicate( weight ), scaling );
+            rotation    = XMVectorMultiplyAdd( inputRotation, XMVectorReplicate( weight ), rotation );
+            translation = XMVectorMultiplyAdd( inputTranslation, XMVectorReplicate( weight ), translation );
+            weightSum += weight;
+
+            if ( weight > dominantWeight ) {
+                dominantWeight      = weight;
+                pDominantProperties = &properties;
+            }
+        }
+
+        XMVECTOR bindScaling, bindRotation, bindTranslation;
+        if ( weightSum <= 0.0f || bHasAdditiveInputs ) {
+            DecomposeLocalTransform( *this, node, BindPoseFrame.Properties[ nodeId ], bindScaling, bindRotation, bindTranslation );
+        }
+
+        if ( weightSum > 0.0f ) {
+            const XMVECTOR invWeightSum = XMVectorReplicate( 1.0f / weightSum );
+            scaling     = XMVectorMultiply( scaling, invWeightSum );
+            rotation    = XMQuaternionNormalize( rotation );
+            translation = XMVectorMultiply( translation, invWeightSum );
+        } else {
+            scaling     = bindScaling;
+            rotation    = bindRotation;
+            translation = bindTranslation;
+        }
+
+        // The additive inputs apply their weighted difference from the bind pose.
+        if ( bHasAdditiveInputs ) {
+            for ( size_t i = 0; i < inputCount; ++i ) {
+                const float weight = pAnimBlend->InputWeights[ i ];
+                if ( weight <= 0.0f || !pAnimBlend->Inputs[ i ].bAdditive ) {
+                    continue;
+                }
+
+                XMVECTOR inputScaling, inputRotation, inputTranslation;
+                DecomposeLocalTransform( *this, node, pAnimBlend->InputProperties[ i * slotCount + slot ], inputScaling, inputRotation, inputTranslation );
+
+                const XMVECTOR deltaRotation = XMQuaternionMultiply( XMQuaternionInverse( bindRotation ), inputRotation );
+                const XMVECTOR deltaScaling  = XMVectorDivide( inputScaling, bindScaling );
+
+                scaling     = XMVectorMultiply( scaling, XMVectorLerp( XMVectorSplatOne( ), deltaScaling, weight ) );
+                rotation    = XMQuaternionMultiply( rotation, XMQuaternionSlerp( XMQuaternionIdentity( ), deltaRotation, weight ) );
+                translation = XMVectorMultiplyAdd( XMVectorSubtract( inputTranslation, bindTranslation ), XMVectorReplicate( weight ), translation );
+            }
+        }
+
+        // The blended local matrix is reused by the hierarchy update (the dominant properties do not match it).
+        pAnimTransformFrame->Properties[ nodeId ] = *pDominantProperties;
+        pAnimTransformFrame->SetLocalMatrix( nodeId, XMMatrixAffineTransformation( scaling, XMVectorZero( ), rotation, translation ) );
+    }
+}
+
+void apemode::Scene::UpdateTransformPropertiesInstanced( const float *                   pTimes,
+                                                         const size_t                    instanceCount,
+                                                         const bool                      bLoop,
+                                                         const uint16_t                  animStackId,
+                                                         const uint16_t                  animLayerId,
+                                                         SceneNodeTransformFrame *const *ppAnimTransformFrames,
+                                                         SceneAnimInstanceScratch *      pScratch,
+                                                         SceneAnimCursor *const *        ppAnimCursors ) {
+    assert( !instanceCount || ( pTimes && ppAnimTransformFrames && pScratch ) );
+
+    SceneAnimLayerId animLayerCompositeId;
+    animLayerCompositeId.AnimStackIndex = animStackId;
+    animLayerCompositeId.AnimLayerIndex = animLayerId;
+
+    const SceneAnimLayer *pAnimLayer = GetAnimLayer( animStackId, animLayerId );
+
+    // The scratch vectors keep their capacity, the resize does not allocate for the same instance count.
+    apemode::vector< float > &times = pScratch->TempTimes;
+    times.assign( pTimes, pTimes + instanceCount );
+    for ( size_t k = 0; k < instanceCount; ++k ) {
+        assert( ppAnimTransformFrames[ k ] );
+        ResetAnimTransformFrame( *this, animLayerCompositeId.AnimLayerCompositeId, pAnimLayer, *ppAnimTransformFrames[ k ] );
+
+        if ( bLoop ) {
+            times[ k ] = LoopAnimTime( times[ k ] );
+        }
+    }
+
+    if ( !pAnimLayer || !instanceCount ) {
+        return;
+    }
+
+    for ( size_t i = 0; i < pAnimLayer->NodeIds.size( ); ++i ) {
+        const uint32_t nodeId = pAnimLayer->NodeIds[ i ];
+        for ( size_t k = 0; k < instanceCount; ++k ) {
+            ppAnimTransformFrames[ k ]->Properties[ nodeId ] = pAnimLayer->NodeRestProperties[ i ];
+            ppAnimTransformFrames[ k ]->SetDirty( nodeId );
+        }
+    }
+
+    const uint32_t trackCount = static_cast< uint32_t >( pAnimLayer->TrackAnimCurveIds.size( ) );
+
+    // The sample rows and the interpolation factor are calculated once for all the tracks of the instance,
+    // the instances are iterated in the outer loop, so that the sample rows are read sequentially.
+    const SceneAnimQuantizedTracks &quantizedTracks = pAnimLayer->QuantizedTracks;
+    if ( quantizedTracks.SampleCount ) {
+        for ( size_t k = 0; k < instanceCount; ++k ) {
+            const QuantizedTrackSample quantizedSample = GetQuantizedTrackSample( quantizedTracks, trackCount, times[ k ] );
+            for ( uint32_t i = 0; i < trackCount; ++i ) {
+                SceneNodeTransform &properties = ppAnimTransformFrames[ k ]->Properties[ pAnimLayer->TrackNodeIds[ i ] ];
+                *MapPropertyChannel( pAnimLayer->TrackPropertyChannels[ i ], &properties ) = quantizedSample.GetTrackValue( quantizedTracks, i );
+            }
+        }
+
+        return;
+    }
+
+    apemode::vector< float > &instanceValues = pScratch->TempValues;
+    instanceValues.resize( instanceCount );
+    for ( uint32_t i = 0; i < trackCount; ++i ) {
+        CalculateAnimCurveInstances( pAnimLayer->TrackAnimCurveIds[ i ], times.data( ), instanceCount, instanceValues.data( ), ppAnimCursors );
+
+        const uint32_t nodeId          = pAnimLayer->TrackNodeIds[ i ];
+        const uint8_t  propertyChannel = pAnimLayer->TrackPropertyChannels[ i ];
+        const float    valueFactor     = pAnimLayer->TrackValueFactors[ i ];
+
+        for ( size_t k = 0; k < instanceCount; ++k ) {
+            *MapPropertyChannel( propertyChannel, &ppAnimTransformFrames[ k ]->Properties[ nodeId ] ) = instanceValues[ k ] * valueFactor;
+        }
+    }
+}
+
+SceneNodeTransformFrame &apemode::Scene::GetBindPoseTransformFrame( ) {
+    return BindPoseFrame;
+}
+
+const SceneNodeTransformFrame &apemode::Scene::GetBindPoseTransformFrame( ) const {
+    return BindPoseFrame;
+}
+
+
+bool apemode::Scene::HasAnimStackLayer( uint16_t animStackId, uint16_t animLayerId ) const {
+    if ( animStackId < AnimStacks.size() ) {
+        return animLayerId < AnimStacks[animStackId].LayerCount;
+    }
+
+    return false;
+}
+
+namespace {
+
+/* Updates transform matrices for the range of the ordered nodes.
+ * The parents of the nodes in the range are expected to be updated.
+ * The dirty flags are propagated to the children, the clean nodes are skipped unless all the nodes are updated.
+ */
+void UpdateOrderedTransformMatrices( const apemode::Scene &   scene,
+                                     const uint32_t           orderIndexBegin,
+                                     const uint32_t           orderIndexEnd,
+                                     SceneNodeTransformFrame &t,
+                                     const bool               bUpdateAll ) {
+    assert( orderIndexEnd <= scene.OrderedNodeIds.size( ) );
+    assert( t.DirtyFlags.size( ) == t.GetNodeCount( ) );
+
+    assert( t.HierarchicalMatrices.size( ) == scene.HierarchicalMatrixCount );
+
+    const uint32_t *    pNodeIds               = scene.OrderedNodeIds.data( );
+    const uint32_t *    pParentIndices         = scene.OrderedParentIndices.data( );
+    uint8_t *           pDirtyFlags            = t.DirtyFlags.data( );
+    SceneNodeTransform *pProperties            = t.Properties.data( );
+    XMFLOAT4X3 *        pHierarchicalMatrices  = t.HierarchicalMatrices.data( );
+    XMFLOAT4X3 *        pWorldMatrices         = t.WorldMatrices.data( );
+
+    for ( uint32_t orderIndex = orderIndexBegin; orderIndex < orderIndexEnd; ++orderIndex ) {
+        const uint32_t nodeId           = pNodeIds[ orderIndex ];
+        const uint32_t parentOrderIndex = pParentIndices[ orderIndex ];
+        const uint32_t parentId         = parentOrderIndex != detail::kInvalidId ? pNodeIds[ parentOrderIndex ] : detail::kInvalidId;
+
+        if ( parentId != detail::kInvalidId && ( pDirtyFlags[ parentId ] & SceneNodeTransformFrame::eDirtyFlagMask_Update ) ) {
+            pDirtyFlags[ nodeId ] |= SceneNodeTransformFrame::eDirtyFlag_Hierarchy;
+        }
+
+        if ( !bUpdateAll && !( pDirtyFlags[ nodeId ] & SceneNodeTransformFrame::eDirtyFlagMask_Update ) ) {
+            continue;
+        }
+
+        const SceneNode &   node       = scene.Nodes[ nodeId ];
+        SceneNodeTransform &properties = pProperties[ nodeId ];
+        assert( parentId == node.ParentId );
+
+        // The static nodes use the baked matrices while their properties stay in the bind pose.
+        const bool bStatic = node.StaticMatrixId != detail::kInvalidId;
+        if ( bStatic && ( bUpdateAll || ( pDirtyFlags[ nodeId ] & SceneNodeTransformFrame::eDirtyFlag_Properties ) ) ) {
+            if ( memcmp( &properties, &scene.BindPoseFrame.Properties[ nodeId ], sizeof( SceneNodeTransform ) ) ) {
+                pDirtyFlags[ nodeId ] |= SceneNodeTransformFrame::eDirtyFlag_Unbaked;
+            } else {
+                pDirtyFlags[ nodeId ] &= ~SceneNodeTransformFrame::eDirtyFlag_Unbaked;
+            }
+        }
+
+        const bool bBaked = bStatic && !( pDirtyFlags[ nodeId ] & SceneNodeTransformFrame::eDirtyFlag_Unbaked );
+
+        // The local matrix is not stored, unless it was written directly.
+        // The limits are applied once, when the properties are modified.
+        XMMATRIX localMatrix;
+        if ( pDirtyFlags[ nodeId ] & SceneNodeTransformFrame::eDirtyFlag_Local ) {
+            const auto localMatrixIt = t.LocalMatrices.find( nodeId );
+            assert( localMatrixIt != t.LocalMatrices.end( ) );
+            localMatrix = XMLoadFloat4x3( &localMatrixIt->second );
+        } else if ( bBaked ) {
+            localMatrix = XMLoadFloat4x3( &scene.StaticLocalMatrices[ node.StaticMatrixId ] );
+        } else {
+            if ( parentId != detail::kInvalidId && node.LimitsId != uint32_t( -1 ) &&
+                 ( bUpdateAll || ( pDirtyFlags[ nodeId ] & SceneNodeTransformFrame::eDirtyFlag_Properties ) ) ) {
+                properties.ApplyLimits( scene.Limits[ node.LimitsId ] );
+            }
+
+            localMatrix = GetLocalMatrixKernel( node.eTransformShape, node.eOrder )( properties );
+        }
+
+        // Implicit world calculations for the root node.
+        // The parent hierarchical matrix matches its world matrix, unless it has the geometric transform.
+        XMMATRIX hierarchicalMatrix = localMatrix;
+        if ( parentId != detail::kInvalidId ) {
+            const uint32_t parentHierarchicalMatrixId = scene.Nodes[ parentId ].HierarchicalMatrixId;
+            hierarchicalMatrix = localMatrix * XMLoadFloat4x3( parentHierarchicalMatrixId != detail::kInvalidId
+                                                               ? &pHierarchicalMatrices[ parentHierarchicalMatrixId ]
+                                                               : &pWorldMatrices[ parentId ] );
+        }
+
+        if ( node.bHasGeometricTransform ) {
+            const XMMATRIX geometricMatrix = bBaked
+                                           ? XMLoadFloat4x3( &scene.StaticGeometricMatrices[ node.StaticMatrixId ] )
+                                           : GetGeometricMatrixKernel( node.eOrder )( properties );
+            XMStoreFloat4x3( &pWorldMatrices[ nodeId ], geometricMatrix * hierarchicalMatrix );
+            assert( IsValid( geometricMatrix ) );
+
+            if ( node.HierarchicalMatrixId != detail::kInvalidId ) {
+                XMStoreFloat4x3( &pHierarchicalMatrices[ node.HierarchicalMatrixId ], hierarchicalMatrix );
+            }
+        } else {
+            XMStoreFloat4x3( &pWorldMatrices[ nodeId ], hierarchicalMatrix );
+        }
+
+        assert( properties.Validate( ) );
+        assert( IsValid( localMatrix ) );
+        assert( IsValid( hierarchicalMatrix ) );
+    }
+}
+
+/* Assigns the stored hierarchical matrices to the ordered parent nodes with the geometric transform.
+ * The hierarchical matrices of the rest of the nodes match their world matrices.
+ */
+void AssignHierarchicalMatrixIds( apemode::Scene &scene ) {
+    scene.HierarchicalMatrixCount = 0;
+
+    for ( SceneNode &node : scene.Nodes ) {
+        node.HierarchicalMatrixId = detail::kInvalidId;
+        if ( node.OrderIndex != detail::kInvalidId && node.DescendantCount && node.bHasGeometricTransform ) {
+            node.HierarchicalMatrixId = scene.HierarchicalMatrixCount++;
+        }
+    }
+}
+
+/* Fills the ordered node arrays (parent-before-child) starting from the root node.
+ */
+void FlattenNodeHierarchy( apemode::Scene &scene ) {
+    scene.OrderedNodeIds.clear( );
+    scene.OrderedParentIndices.clear( );
+    scene.OrderedNodeIds.reserve( scene.Nodes.size( ) );
+    scene.OrderedParentIndices.reserve( scene.Nodes.size( ) );
+
+    // Depth-first traversal, the children are pushed in reverse to keep their original order.
+    apemode::vector< uint32_t > nodeIdStack;
+    nodeIdStack.push_back( 0 );
+
+    while ( !nodeIdStack.empty( ) ) {
+        const uint32_t nodeId = nodeIdStack.back( );
+        nodeIdStack.pop_back( );
+
+        SceneNode &node = scene.Nodes[ nodeId ];
+        assert( node.OrderIndex == detail::kInvalidId && "Cycles in the hierarchy." );
+
+        // The parent is ordered before its children.
+        node.OrderIndex = static_cast< uint32_t >( scene.OrderedNodeIds.size( ) );
+        scene.OrderedNodeIds.push_back( nodeId );
+        scene.OrderedParentIndices.push_back( node.ParentId != detail::kInvalidId ? scene.Nodes[ node.ParentId ].OrderIndex : detail::kInvalidId );
+
+        const auto childIdRange = scene.NodeToChildIds.equal_range( nodeId );
+        for ( auto childIdIt = childIdRange.second; childIdIt != childIdRange.first; ) {
+            --childIdIt;
+            nodeIdStack.push_back( childIdIt->second );
+        }
+    }
+
+    // The descendants of the node are the nodes that follow it until the first node that is not in its subtree.
+    // Going backwards, each node adds its subtree to its parent.
+    for ( auto &node : scene.Nodes ) {
+        node.DescendantCount = 0;
+    }
+
+    for ( uint32_t orderIndex = static_cast< uint32_t >( scene.OrderedNodeIds.size( ) ); orderIndex > 1; --orderIndex ) {
+        const SceneNode &node = scene.Nodes[ scene.OrderedNodeIds[ orderIndex - 1 ] ];
+        scene.Nodes[ node.ParentId ].DescendantCount += node.DescendantCount + 1;
+    }
+
+    if ( scene.OrderedNodeIds.size( ) != scene.Nodes.size( ) ) {
+        LogWarn( "Nodes unreachable from the root: {}", scene.Nodes.size( ) - scene.OrderedNodeIds.size( ) );
+    }
+
+    AssignHierarchicalMatrixIds( scene );
+}
+
+/* Copies the keys that cannot be interpolated from the neighbouring ones within the tolerance.
+ * The flat runs (all segments stay within the tolerance from the first key value) and the collinear runs of the linear keys are merged.
+ * Only the first key remains, if the whole curve is flat.
+ */
+void SimplifyAnimCurveKeys( const apemode::vector< SceneAnimCurveKey > &keys,
+                            apemode::vector< SceneAnimCurveKey > &      outKeys,
+                            const float                                 tolerance ) {
+    assert( !keys.empty( ) );
+
+    const uint32_t keyCount = static_cast< uint32_t >( keys.size( ) );
+
+    // Returns true if the segment values are within the tolerance from the given value (Bezier curve stays within its control points).
+    const auto isSegmentFlat = [&]( const uint32_t keyIndex, const float value ) {
+        const SceneAnimCurveKey &a = keys[ keyIndex ];
+        const SceneAnimCurveKey &b = keys[ keyIndex + 1 ];
+        if ( !IsNearlyEqual( a.Value, value, tolerance ) ) {
+            return false;
+        }
+
+        switch ( a.eInterpMode ) {
+            case SceneAnimCurveKey::eInterpolationMode_Const:
+                return true;
+            case SceneAnimCurveKey::eInterpolationMode_Linear:
+                return IsNearlyEqual( b.Value, value, tolerance );
+            default:
+                return IsNearlyEqual( a.Bez1, value, tolerance ) && IsNearlyEqual( a.Bez2, value, tolerance ) &&
+                       IsNearlyEqual( b.PrevBez3( ), value, tolerance );
+        }
+    };
+
+    outKeys.clear( );
+    outKeys.push_back( keys.front( ) );
+    if ( keyCount == 1 ) {
+        return;
+    }
+
+    // The run starts at the last copied key. The slope bounds keep the line from it within the tolerance from the skipped keys.
+    uint32_t anchorIndex = 0;
+    bool     bRunFlat    = isSegmentFlat( 0, keys[ 0 ].Value );
+    bool     bRunLinear  = keys[ 0 ].eInterpMode == SceneAnimCurveKey::eInterpolationMode_Linear;
+    float    slopeMin    = -std::numeric_limits< float >::max( );
+    float    slopeMax    = std::numeric_limits< float >::max( );
+
+    for ( uint32_t i = 1; ( i + 1 ) < keyCount; ++i ) {
+        const SceneAnimCurveKey &anchor = keys[ anchorIndex ];
+        const SceneAnimCurveKey &key    = keys[ i ];
+        const SceneAnimCurveKey &next   = keys[ i + 1 ];
+
+        // The kept segment from the anchor reaches the next key value, unless the anchor is constant.
+        // The constant segment does not reach its end key value, so the step to it is checked separately.
+        const bool bFlat = bRunFlat && isSegmentFlat( i, anchor.Value ) &&
+                           ( anchor.eInterpMode == SceneAnimCurveKey::eInterpolationMode_Const ||
+                             IsNearlyEqual( next.Value, anchor.Value, tolerance ) );
+
+        bool bLinear = bRunLinear && key.eInterpMode == SceneAnimCurveKey::eInterpolationMode_Linear;
+        if ( bLinear ) {
+            const float keyDeltaTime = key.Time - anchor.Time;
+            slopeMin = eastl::max( slopeMin, ( key.Value - tolerance - anchor.Value ) / keyDeltaTime );
+            slopeMax = eastl::min( slopeMax, ( key.Value + tolerance - anchor.Value ) / keyDeltaTime );
+
+            const float slope = ( next.Value - anchor.Value ) / ( next.Time - anchor.Time );
+            bLinear = slope >= slopeMin && slope <= slopeMax;
+        }
+
+        if ( bFlat || bLinear ) {
+            bRunFlat   = bFlat;
+            bRunLinear = bLinear;
+            continue;
+        }
+
+        outKeys.push_back( key );
+        anchorIndex = i;
+        bRunFlat    = isSegmentFlat( i, key.Value );
+        bRunLinear  = key.eInterpMode == SceneAnimCurveKey::eInterpolationMode_Linear;
+        slopeMin    = -std::numeric_limits< float >::max( );
+        slopeMax    = std::numeric_limits< float >::max( );
+    }
+
+    // The last key value is checked, because the constant segment does not reach it.
+    const bool bCurveFlat = outKeys.size( ) == 1 && bRunFlat && IsNearlyEqual( keys.back( ).Value, keys.front( ).Value, tolerance );
+    if ( !bCurveFlat ) {
+        outKeys.push_back( keys.back( ) );
+    }
+}
+
+/* Resamples the tracks of the layer at the fixed rate, and quantizes the samples to 16 bits within the track value ranges.
+ * The error is checked between the samples, the sample rate is doubled until it fits the budget.
+ */
+void QuantizeAnimLayerTracks( const apemode::Scene &scene, SceneAnimLayer &animLayer, float sampleRate, const float errorBudget ) {
+    constexpr float    kMaxSampleRate   = 240;
+    constexpr uint32_t kErrorCheckSteps = 4;
+    constexpr float    kQuantizedMax    = 65535.0f;
+
+    const uint32_t trackCount = static_cast< uint32_t >( animLayer.TrackAnimCurveIds.size( ) );
+    if ( !trackCount ) {
+        return;
+    }
+
+    float timeMin = std::numeric_limits< float >::max( );
+    float timeMax = -std::numeric_limits< float >::max( );
+    for ( const uint32_t animCurveId : animLayer.TrackAnimCurveIds ) {
+        timeMin = eastl::min( timeMin, scene.AnimCurves[ animCurveId ].TimeMinMaxTotal.x );
+        timeMax = eastl::max( timeMax, scene.AnimCurves[ animCurveId ].TimeMinMaxTotal.y );
+    }
+
+    SceneAnimQuantizedTracks &quantizedTracks = animLayer.QuantizedTracks;
+    quantizedTracks.RangeMins.resize( trackCount );
+    quantizedTracks.RangeScales.resize( trackCount );
+
+    apemode::vector< float > values;
+    apemode::vector< float > exactValues( trackCount );
+    float                    maxError = 0;
+
+    for ( ;; ) {
+        const uint32_t sampleCount = static_cast< uint32_t >( ceilf( ( timeMax - timeMin ) * sampleRate ) ) + 1;
+        values.resize( size_t( sampleCount ) * trackCount );
+
+        for ( uint32_t sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex ) {
+            const float time = eastl::min( timeMin + float( sampleIndex ) / sampleRate, timeMax );
+            scene.CalculateAnimCurves( animLayer.TrackAnimCurveIds.data( ), trackCount, time, values.data( ) + size_t( sampleIndex ) * trackCount );
+        }
+
+        for ( uint32_t i = 0; i < trackCount; ++i ) {
+            float valueMin = std::numeric_limits< float >::max( );
+            float valueMax = -std::numeric_limits< float >::max( );
+            for ( uint32_t sampleIndex = 0; sampleIndex < sampleCount; ++sampleIndex ) {
+                valueMin = eastl::min( valueMin, values[ size_t( sampleIndex ) * trackCount + i ] );
+                valueMax = eastl::max( valueMax, values[ size_t( sampleIndex ) * trackCount + i ] );
+            }
+
+            quantizedTracks.RangeMins[ i ]   = valueMin;
+            quantizedTracks.RangeScales[ i ] = ( valueMax - valueMin ) / kQuantizedMax;
+        }
+
+        quantizedTracks.Samples.resize( values.size( ) );
+        for ( size_t j = 0; j < values.size( ); ++j ) {
+            const uint32_t i     = static_cast< uint32_t >( j % trackCount );
+            const float    scale = quantizedTracks.RangeScales[ i ];
+            const float    q     = scale > 0 ? ( values[ j ] - quantizedTracks.RangeMins[ i ] ) / scale : 0.0f;
+            quantizedTracks.Samples[ j ] = static_cast< uint16_t >( eastl::min( q + 0.5f, kQuantizedMax ) );
+        }
+
+        // Compare the interpolated samples to the curves between the samples.
+        maxError = 0;
+        for ( uint32_t sampleIndex = 0; ( sampleIndex + 1 ) < sampleCount; ++sampleIndex ) {
+            QuantizedTrackSample quantizedSample;
+            quantizedSample.pSamples0 = quantizedTracks.Samples.data( ) + size_t( sampleIndex ) * trackCount;
+            quantizedSample.pSamples1 = quantizedSample.pSamples0 + trackCount;
+
+            for ( uint32_t step = 1; step < kErrorCheckSteps; ++step ) {
+                quantizedSample.Factor = float( step ) / float( kErrorCheckSteps );
+
+                const float time = eastl::min( timeMin + ( float( sampleIndex ) + quantizedSample.Factor ) / sampleRate, timeMax );
+                scene.CalculateAnimCurves( animLayer.TrackAnimCurveIds.data( ), trackCount, time, exactValues.data( ) );
+
+                for ( uint32_t i = 0; i < trackCount; ++i ) {
+                    maxError = eastl::max( maxError, fabsf( quantizedSample.GetTrackValue( quantizedTracks, i ) - exactValues[ i ] ) );
+                }
+            }
+        }
+
+        quantizedTracks.SampleRate  = sampleRate;
+        quantizedTracks.TimeMin     = timeMin;
+        quantizedTracks.SampleCount = sampleCount;
+
+        if ( maxError <= errorBudget || sampleRate * 2 > kMaxSampleRate ) {
+            break;
+        }
+
+        sampleRate *= 2;
+    }
+
+    // The track value factors are applied to the ranges, the evaluation writes the values as is.
+    for ( uint32_t i = 0; i < trackCount; ++i ) {
+        quantizedTracks.RangeMins[ i ] *= animLayer.TrackValueFactors[ i ];
+        quantizedTracks.RangeScales[ i ] *= animLayer.TrackValueFactors[ i ];
+    }
+
+    LogInfo( "Quantized layer: stack={}, layer={}, tracks: {}, rate: {}, samples: {}, bytes: {}, max error: {}",
+             animLayer.AnimStackIndex,
+             animLayer.AnimLayerIndex,
+             trackCount,
+             quantizedTracks.SampleRate,
+             quantizedTracks.SampleCount,
+             quantizedTracks.Samples.size( ) * sizeof( uint16_t ),
+             maxError );
+}
+
+/* Releases the keys of the curves, which are evaluated from the quantized tracks only.
+ * The curves keep the indices of their quantized tracks (see SceneAnimCurve::IsQuantized), the key counts are zero.
+ */
+void ReleaseQuantizedAnimCurveKeys( apemode::Scene &scene ) {
+    for ( const auto &animLayerPair : scene.AnimLayers ) {
+        const SceneAnimLayer &animLayer = animLayerPair.second;
+        if ( animLayer.QuantizedTracks.SampleCount ) {
+            for ( uint32_t trackIndex = 0; trackIndex < animLayer.TrackAnimCurveIds.size( ); ++trackIndex ) {
+                SceneAnimCurve &animCurve = scene.AnimCurves[ animLayer.TrackAnimCurveIds[ trackIndex ] ];
+                assert( animCurve.AnimStackIndex == animLayer.AnimStackIndex && animCurve.AnimLayerIndex == animLayer.AnimLayerIndex );
+                animCurve.QuantizedTrackIndex = trackIndex;
+            }
+        }
+    }
+
+    const size_t       keyCount = scene.AnimCurveKeys.Times.size( );
+    SceneAnimCurveKeys keptKeys;
+
+    for ( uint32_t animCurveId = 0; animCurveId < scene.AnimCurves.size( ); ++animCurveId ) {
+        SceneAnimCurve &animCurve = scene.AnimCurves[ animCurveId ];
+        if ( animCurve.IsQuantized( ) ) {
+            animCurve.BaseKey  = 0;
+            animCurve.KeyCount = 0;
+            continue;
+        }
+
+        const uint32_t baseKey = static_cast< uint32_t >( keptKeys.Times.size( ) );
+        for ( uint32_t keyIndex = animCurve.BaseKey; keyIndex < ( animCurve.BaseKey + animCurve.KeyCount ); ++keyIndex ) {
+            keptKeys.Times.push_back( scene.AnimCurveKeys.Times[ keyIndex ] );
+            keptKeys.Values.push_back( scene.AnimCurveKeys.Values[ keyIndex ] );
+            keptKeys.Bez1.push_back( scene.AnimCurveKeys.Bez1[ keyIndex ] );
+            keptKeys.Bez2.push_back( scene.AnimCurveKeys.Bez2[ keyIndex ] );
+            keptKeys.Bez3.push_back( scene.AnimCurveKeys.Bez3[ keyIndex ] );
+        }
+
+        animCurve.BaseKey = baseKey;
+    }
+
+    scene.AnimCurveKeys = eastl::move( keptKeys );
+    LogInfo( "Released curve keys: {} -> {}", keyCount, scene.AnimCurveKeys.Times.size( ) );
+}
+
+/* Assigns the transform shapes to the nodes.
+ * The property is considered used if it is not zero in the bind pose, or it is animated in any of the layers.
+ */
+void ClassifyNodeTransforms( apemode::Scene &scene ) {
+    uint32_t shapeNodeCounts[ detail::eTransformShapeCount ] = {};
+    uint32_t geometricNodeCount                              = 0;
+
+    for ( SceneNode &node : scene.Nodes ) {
+        const SceneNodeTransform &properties = scene.BindPoseFrame.Properties[ node.Id ];
+
+        bool bUsesPivotsOrOffsets = !IsNearlyZero( properties.RotationOffset ) || !IsNearlyZero( properties.RotationPivot ) ||
+                                    !IsNearlyZero( properties.ScalingOffset ) || !IsNearlyZero( properties.ScalingPivot ) ||
+                                    !IsNearlyZero( properties.PostRotation );
+        bool bUsesPreRotation     = !IsNearlyZero( properties.PreRotation );
+        bool bUsesGeometric       = !IsNearlyZero( properties.GeometricTranslation ) ||
+                                    !IsNearlyZero( properties.GeometricRotation ) ||
+                                    !IsNearlyEqual( properties.GeometricScaling, XMFLOAT3{1, 1, 1} );
+
+        const auto animCurveIdRange = scene.NodeIdToAnimCurveIds.equal_range( node.Id );
+        for ( auto animCurveIdIt = animCurveIdRange.first; animCurveIdIt != animCurveIdRange.second; ++animCurveIdIt ) {
+            switch ( scene.AnimCurves[ animCurveIdIt->second ].eProperty ) {
+                case SceneAnimCurve::eProperty_Translation:
+                case SceneAnimCurve::eProperty_LclRotation:
+                case SceneAnimCurve::eProperty_Scaling:
+                    break;
+                case SceneAnimCurve::eProperty_PreRotation:
+                    bUsesPreRotation = true;
+                    break;
+                case SceneAnimCurve::eProperty_GeometricTranslation:
+                case SceneAnimCurve::eProperty_GeometricRotation:
+                case SceneAnimCurve::eProperty_GeometricScaling:
+                    bUsesGeometric = true;
+                    break;
+                default:
+                    bUsesPivotsOrOffsets = true;
+                    break;
+            }
+        }
+
+        node.eTransformShape = bUsesPivotsOrOffsets ? detail::eTransformShape_Full
+                             : bUsesPreRotation     ? detail::eTransformShape_TRSPreRotated
+                                                    : detail::eTransformShape_TRS;
+        node.bHasGeometricTransform = bUsesGeometric;
+
+        ++shapeNodeCounts[ node.eTransformShape ];
+        geometricNodeCount += bUsesGeometric ? 1 : 0;
+    }
+
+    LogInfo( "Transform shapes: TRS={}, TRS+PreRotation={}, Full={}, Geometric={}",
+             shapeNodeCounts[ detail::eTransformShape_TRS ],
+             shapeNodeCounts[ detail::eTransformShape_TRSPreRotated ],
+             shapeNodeCounts[ detail::eTransformShape_Full ],
+             geometricNodeCount );
+}
+
+/* Bakes the local and geometric matrices of the nodes without animation curves and limits.
+ * The transform shapes are expected to be classified.
+ */
+void BakeStaticNodeTransforms( apemode::Scene &scene ) {
+    scene.StaticLocalMatrices.clear( );
+    scene.StaticGeometricMatrices.clear( );
+
+    for ( SceneNode &node : scene.Nodes ) {
+        node.StaticMatrixId = detail::kInvalidId;
+        const auto animCurveIdRange = scene.NodeIdToAnimCurveIds.equal_range( node.Id );
+        if ( node.LimitsId != detail::kInvalidId || animCurveIdRange.first != animCurveIdRange.second ) {
+            continue;
+        }
+
+        const SceneNodeTransform &properties = scene.BindPoseFrame.Properties[ node.Id ];
+
+        XMFLOAT4X3 geometricMatrix;
+        XMStoreFloat4x3( &geometricMatrix, GetGeometricMatrixKernel( node.eOrder )( properties ) );
+
+        XMFLOAT4X3 localMatrix;
+        XMStoreFloat4x3( &localMatrix, GetLocalMatrixKernel( node.eTransformShape, node.eOrder )( properties ) );
+
+        node.StaticMatrixId = static_cast< uint32_t >( scene.StaticLocalMatrices.size( ) );
+        scene.StaticLocalMatrices.push_back( localMatrix );
+        scene.StaticGeometricMatrices.push_back( geometricMatrix );
+    }
+
+    LogInfo( "Static nodes: {} / {}", scene.StaticLocalMatrices.size( ), scene.Nodes.size( ) );
+}
+
+/* Excludes the nodes that affect no mesh or skin from the ordered nodes and from the animation layers.
+ * The node contributes if it has a mesh, is a skin link, or has a contributing descendant, so the pruned nodes form whole subtrees,
+ * and the remaining ordered nodes keep the depth-first order with the contiguous descendants.
+ * The bind pose frame is expected to be updated, the pruned nodes keep their bind pose matrices in the animated frames.
+ */
+void PruneNonContributingNodes( apemode::Scene &scene ) {
+    const size_t nodeCount = scene.Nodes.size( );
+    if ( scene.OrderedNodeIds.empty( ) ) {
+        return;
+    }
+
+    std::vector< uint8_t > contributing( nodeCount, 0 );
+    for ( const SceneNode &node : scene.Nodes ) {
+        contributing[ node.Id ] = node.MeshId != detail::kInvalidId;
+    }
+
+    for ( const SceneSkin &skin : scene.Skins ) {
+        for ( const uint32_t linkId : skin.LinkIds ) {
+            contributing[ linkId ] = 1;
+        }
+    }
+
+    // Going backwards, each contributing node marks its parent.
+    for ( uint32_t orderIndex = static_cast< uint32_t >( scene.OrderedNodeIds.size( ) ); orderIndex > 1; --orderIndex ) {
+        const uint32_t nodeId = scene.OrderedNodeIds[ orderIndex - 1 ];
+        if ( contributing[ nodeId ] ) {
+            contributing[ scene.Nodes[ nodeId ].ParentId ] = 1;
+        }
+    }
+
+    // The root node is always kept.
+    contributing[ scene.OrderedNodeIds.front( ) ] = 1;
+
+    uint32_t orderedNodeCount = 0;
+    for ( uint32_t orderIndex = 0; orderIndex < scene.OrderedNodeIds.size( ); ++orderIndex ) {
+        const uint32_t nodeId = scene.OrderedNodeIds[ orderIndex ];
+        SceneNode &    node   = scene.Nodes[ nodeId ];
+
+        if ( !contributing[ nodeId ] ) {
+            node.OrderIndex      = detail::kInvalidId;
+            node.DescendantCount = 0;
+            continue;
+        }
+
+        // The parents of the kept nodes are kept, and are already moved.
+        node.OrderIndex                                = orderedNodeCount;
+        node.DescendantCount                           = 0;
+        scene.OrderedNodeIds[ orderedNodeCount ]       = nodeId;
+        scene.OrderedParentIndices[ orderedNodeCount ] = node.ParentId != detail::kInvalidId ? scene.Nodes[ node.ParentId ].OrderIndex : detail::kInvalidId;
+        ++orderedNodeCount;
+    }
+
+    const size_t prunedNodeCount = scene.OrderedNodeIds.size( ) - orderedNodeCount;
+    scene.OrderedNodeIds.resize( orderedNodeCount );
+    scene.OrderedParentIndices.resize( orderedNodeCount );
+
+    for ( uint32_t orderIndex = orderedNodeCount; orderIndex > 1; --orderIndex ) {
+        const SceneNode &node = scene.Nodes[ scene.OrderedNodeIds[ orderIndex - 1 ] ];
+        scene.Nodes[ node.ParentId ].DescendantCount += node.DescendantCount + 1;
+    }
+
+    // The nodes and the tracks of the layers are sorted by node ID, the filtering keeps the order.
+    size_t prunedTrackCount = 0;
+    for ( auto &animLayerPair : scene.AnimLayers ) {
+        SceneAnimLayer &animLayer = animLayerPair.second;
+
+        size_t animNodeCount = 0;
+        for ( size_t i = 0; i < animLayer.NodeIds.size( ); ++i ) {
+            if ( contributing[ animLayer.NodeIds[ i ] ] ) {
+                animLayer.NodeIds[ animNodeCount ]            = animLayer.NodeIds[ i ];
+                animLayer.NodeRestProperties[ animNodeCount ] = animLayer.NodeRestProperties[ i ];
+                ++animNodeCount;
+            }
+        }
+
+        animLayer.NodeIds.resize( animNodeCount );
+        animLayer.NodeRestProperties.resize( animNodeCount );
+
+        // The pruned nodes keep the bind pose, their constant curves are not applied.
+        size_t constNodeCount = 0;
+        for ( size_t i = 0; i < animLayer.ConstNodeIds.size( ); ++i ) {
+            if ( contributing[ animLayer.ConstNodeIds[ i ] ] ) {
+                animLayer.ConstNodeIds[ constNodeCount ]        = animLayer.ConstNodeIds[ i ];
+                animLayer.ConstNodeProperties[ constNodeCount ] = animLayer.ConstNodeProperties[ i ];
+                ++constNodeCount;
+            }
+        }
+
+        animLayer.ConstNodeIds.resize( constNodeCount );
+        animLayer.ConstNodeProperties.resize( constNodeCount );
+
+        size_t trackCount = 0;
+        for ( size_t i = 0; i < animLayer.TrackNodeIds.size( ); ++i ) {
+            if ( contributing[ animLayer.TrackNodeIds[ i ] ] ) {
+                animLayer.TrackNodeIds[ trackCount ]          = animLayer.TrackNodeIds[ i ];
+                animLayer.TrackAnimCurveIds[ trackCount ]     = animLayer.TrackAnimCurveIds[ i ];
+                animLayer.TrackPropertyChannels[ trackCount ] = animLayer.TrackPropertyChannels[ i ];
+                animLayer.TrackValueFactors[ trackCount ]     = animLayer.TrackValueFactors[ i ];
+                ++trackCount;
+            }
+        }
+
+        prunedTrackCount += animLayer.TrackNodeIds.size( ) - trackCount;
+        animLayer.TrackNodeIds.resize( trackCount );
+        animLayer.TrackAnimCurveIds.resize( trackCount );
+        animLayer.TrackPropertyChannels.resize( trackCount );
+        animLayer.TrackValueFactors.resize( trackCount );
+    }
+
+    LogInfo( "Non-contributing nodes pruned: {} / {}, tracks: {}", prunedNodeCount, nodeCount, prunedTrackCount );
+}
+
+/* Splits the ordered nodes into the subtree jobs of the similar size.
+ * The subtrees that are too large are split into their children, and their roots become shared nodes.
+ * The adjacent small sibling subtrees are merged into a single job.
+ */
+void PartitionNodeHierarchy( apemode::Scene &scene ) {
+    constexpr uint32_t kMaxJobCount     = 32;
+    constexpr uint32_t kMinJobNodeCount = 256;
+
+    SceneTransformJobs &transformJobs = scene.TransformJobs;
+    transformJobs.SharedOrderIndices.clear( );
+    transformJobs.Jobs.clear( );
+
+    const uint32_t orderedNodeCount = static_cast< uint32_t >( scene.OrderedNodeIds.size( ) );
+    if ( !orderedNodeCount ) {
+        return;
+    }
+
+    const uint32_t maxJobNodeCount = eastl::max( kMinJobNodeCount, ( orderedNodeCount + kMaxJobCount - 1 ) / kMaxJobCount );
 
-}
+    // The order indices of the subtree roots, the stack keeps the depth-first order of the shared nodes.
+    apemode::vector< uint32_t > orderIndexStack;
+    orderIndexStack.push_back( 0 );
 
-XMMATRIX apemode::SceneNodeTransform::CalculateGeometricMatrix( const detail::ERotationOrder eOrder ) const {
-    return XMMatrixScalingFromVector( XMLoadFloat3( &GeometricScaling ) ) *
-           XMMatrixRotationOrdered( GeometricRotation, eOrder ) *
-           XMMatrixTranslationFromVector( XMLoadFloat3( &GeometricTranslation ) );
-}
+    while ( !orderIndexStack.empty( ) ) {
+        const uint32_t orderIndex = orderIndexStack.back( );
+        orderIndexStack.pop_back( );
 
-void apemode::Scene::InitializeTransformFrame( SceneNodeTransformFrame &t ) const {
-    t.Transforms.resize( Nodes.size( ) );
-}
+        const uint32_t subtreeNodeCount = scene.Nodes[ scene.OrderedNodeIds[ orderIndex ] ].DescendantCount + 1;
 
-const apemode::SceneNodeAnimCurveIds *apemode::Scene::GetAnimCurveIds( const uint32_t nodeId,
-                                                                       const uint16_t animStackId,
-                                                                       const uint16_t animLayerId ) const {
+        if ( subtreeNodeCount <= maxJobNodeCount ) {
+            if ( !transformJobs.Jobs.empty( ) ) {
+                SceneTransformJob &lastJob = transformJobs.Jobs.back( );
+                if ( lastJob.OrderIndexEnd == orderIndex && ( lastJob.OrderIndexEnd - lastJob.OrderIndexBegin + subtreeNodeCount ) <= maxJobNodeCount ) {
+                    lastJob.OrderIndexEnd += subtreeNodeCount;
+                    continue;
+                }
+            }
 
-    if ( ! AnimNodeIdToAnimCurveIds.empty( ) ) {
+            SceneTransformJob &job = transformJobs.Jobs.emplace_back( );
+            job.OrderIndexBegin = orderIndex;
+            job.OrderIndexEnd   = orderIndex + subtreeNodeCount;
+            continue;
+        }
 
-        SceneAnimNodeId animNodeCompositeId;
-        animNodeCompositeId.NodeId                  = nodeId;
-        animNodeCompositeId.AnimLayerId.AnimStackIndex = animStackId;
-        animNodeCompositeId.AnimLayerId.AnimLayerIndex = animLayerId;
+        transformJobs.SharedOrderIndices.push_back( orderIndex );
 
-        const auto animCurveIdsIt = AnimNodeIdToAnimCurveIds.find( animNodeCompositeId.AnimNodeCompositeId );
-        if ( animCurveIdsIt != AnimNodeIdToAnimCurveIds.end( ) ) {
-            assert( AnimNodeIdToAnimCurveIds.end( ) != animCurveIdsIt );
-            return &animCurveIdsIt->second;
+        // Children are pushed in reverse to keep the jobs in depth-first order.
+        const size_t childStackOffset = orderIndexStack.size( );
+        for ( uint32_t childOrderIndex = orderIndex + 1; childOrderIndex < ( orderIndex + subtreeNodeCount ); ) {
+            orderIndexStack.push_back( childOrderIndex );
+            childOrderIndex += scene.Nodes[ scene.OrderedNodeIds[ childOrderIndex ] ].DescendantCount + 1;
         }
+
+        eastl::reverse( orderIndexStack.begin( ) + childStackOffset, orderIndexStack.end( ) );
     }
 
-    return nullptr;
+    LogInfo( "Transform jobs: {}, shared nodes: {}, max job nodes: {}",
+             transformJobs.Jobs.size( ),
+             transformJobs.SharedOrderIndices.size( ),
+             maxJobNodeCount );
 }
 
-inline XMMATRIX CalculateOffsetMatrix( const XMMATRIX invBindPoseMatrix, const XMMATRIX currentAnimatedMatrix ) {
-    return invBindPoseMatrix * currentAnimatedMatrix;
-}
+} // namespace
 
-void apemode::Scene::UpdateSkinMatrices( const SceneSkin &              skin,
-                                         const SceneNodeTransformFrame *pSceneAnimatedFrame,
-                                         const XMMATRIX                 nodeWorldTransform,
-                                         XMFLOAT4X4 *                   pOffsetMatrices,
-                                         XMFLOAT4X4 *                   pNormalMatrices,
-                                         size_t                         matrixCount ) const {
+void apemode::Scene::UpdateTransformMatrices( const uint32_t parentNodeId, SceneNodeTransformFrame &t ) const {
+    assert( parentNodeId == Nodes[ parentNodeId ].Id );
 
-    assert( matrixCount >= skin.LinkIds.size( ) );
-    for ( size_t i = 0; i < skin.LinkIds.size( ); ++i ) {
-        uint32_t nodeId = skin.LinkIds[ i ];
-        XMMATRIX currentWorldMatrix = pSceneAnimatedFrame->Transforms[ nodeId ].WorldMatrix;
-        // currentWorldMatrix = XMMatrixInverse(0, nodeWorldTransform) * currentWorldMatrix;
+    const SceneNode &parentNode = Nodes[ parentNodeId ];
+    if ( parentNode.OrderIndex != detail::kInvalidId ) {
+        const uint32_t orderIndexBegin = parentNode.OrderIndex + 1;
 
-        // const SceneSkeleton &skeleton  = Skeletons[ skin.SkeletonId ];
-        // const uint32_t nodeIndex = skin.SkeletonNodeIndices[ i ];
-        // assert( nodeIndex < skeleton.NodeIds.size( ) );
-        // const XMMATRIX currentWorldMatrix = pSkeletonAnimatedFrame->Transforms[ nodeIndex ].WorldMatrix;
-        // const XMMATRIX currentWorldMatrix = pSkeletonAnimatedFrame->Transforms[ nodeIndex ].HierarchicalMatrix;
+        // The ancestors are not updated, the frame with the stale layout is updated as a whole.
+        if ( t.DirtyFlags.size( ) != t.GetNodeCount( ) || t.HierarchicalMatrices.size( ) != HierarchicalMatrixCount ) {
+            UpdateTransformMatrices( t );
+            return;
+        }
 
-        const XMMATRIX invBindPoseMatrix  = skin.InvBindPoseMatrices[ i ];
-        const XMMATRIX offsetMatrix       = CalculateOffsetMatrix( invBindPoseMatrix , currentWorldMatrix );
+        UpdateOrderedTransformMatrices( *this, orderIndexBegin, orderIndexBegin + parentNode.DescendantCount, t, true );
+    }
+}
 
-        assert( IsValid( currentWorldMatrix ) );
-        assert( IsValid( invBindPoseMatrix ) );
-        assert( IsValid( offsetMatrix ) );
+void apemode::Scene::UpdateTransformMatrices( SceneNodeTransformFrame &t ) const {
+    if ( !t.GetNodeCount( ) || Nodes.empty( ) )
+        return;
 
-        XMStoreFloat4x4( &pOffsetMatrices[ i ], offsetMatrix );
-        // assert( IsIdentity( pOffsetMatrices[ i ] ) );
+    //
+    // Single pass over the ordered nodes, the root node goes first.
+    //
 
-        if ( pNormalMatrices ) {
-            XMStoreFloat4x4( &pNormalMatrices[ i ], XMMatrixTranspose( XMMatrixInverse( 0, offsetMatrix ) ) );
-        }
+    assert( t.GetNodeCount( ) == Nodes.size( ) );
+
+    if ( t.DirtyFlags.size( ) != t.GetNodeCount( ) || t.HierarchicalMatrices.size( ) != HierarchicalMatrixCount ) {
+        t.HierarchicalMatrices.resize( HierarchicalMatrixCount );
+        t.SetAllDirty( );
     }
+
+    UpdateOrderedTransformMatrices( *this, 0, static_cast< uint32_t >( OrderedNodeIds.size( ) ), t, false );
+    t.ClearDirtyFlags( );
 }
 
-bool IsRotationProperty( const apemode::SceneAnimCurve::EProperty eProperty ) {
-    switch ( eProperty ) {
-        case apemode::SceneAnimCurve::eProperty_LclRotation:
-        case apemode::SceneAnimCurve::eProperty_PreRotation:
-        case apemode::SceneAnimCurve::eProperty_PostRotation:
-        case apemode::SceneAnimCurve::eProperty_GeometricRotation:
-            return true;
+void apemode::Scene::UpdateTransformMatricesParallel( SceneNodeTransformFrame &t ) const {
+    tf::Taskflow *pDefaultTaskflow = AppState::Get( ) ? AppState::Get( )->GetDefaultTaskflow( ) : nullptr;
 
-        default:
-            return false;
+    if ( !pDefaultTaskflow || TransformJobs.Jobs.size( ) < 2 ) {
+        UpdateTransformMatrices( t );
+        return;
     }
-}
 
-XMFLOAT3 *MapProperty( apemode::SceneAnimCurve::EProperty eProperty, apemode::SceneNodeTransform *pProperties ) {
-    static_assert( sizeof( SceneNodeTransform ) == ( sizeof( XMFLOAT3 ) * SceneAnimCurve::ePropertyCount / 3 ), "Re-implement mapping with switch cases." );
-    assert( ( ( eProperty % 3 ) == 0 ) && ( eProperty < SceneAnimCurve::ePropertyCount ) );
-    return reinterpret_cast< XMFLOAT3 * >( pProperties ) + ( eProperty / 3 );
-}
+    if ( !t.GetNodeCount( ) || Nodes.empty( ) )
+        return;
 
-void apemode::Scene::UpdateTransformProperties( float                    time,
-                                                const bool               bLoop,
-                                                const uint16_t           animStackId,
-                                                const uint16_t           animLayerId,
-                                                SceneNodeTransformFrame *pAnimTransformFrame ) {
-    const float debugTimeSpan = 20;
+    assert( t.GetNodeCount( ) == Nodes.size( ) );
 
-    XMFLOAT3 TimeMinMaxTotal;
-    TimeMinMaxTotal.x = 0;
-    TimeMinMaxTotal.y = debugTimeSpan;
-    TimeMinMaxTotal.z = debugTimeSpan;
+    if ( t.DirtyFlags.size( ) != t.GetNodeCount( ) || t.HierarchicalMatrices.size( ) != HierarchicalMatrixCount ) {
+        t.HierarchicalMatrices.resize( HierarchicalMatrixCount );
+        t.SetAllDirty( );
+    }
 
-    if ( bLoop ) {
-// Loop the given time value.
-#define SCENEANIMCURVE_USE_MODF
-#ifdef SCENEANIMCURVE_USE_MODF
-        float relativeTime, fractionalPart, integerPart;
-        relativeTime = ( time - TimeMinMaxTotal.x ) / TimeMinMaxTotal.z;
-        fractionalPart = modf( relativeTime, &integerPart );
-        time = TimeMinMaxTotal.x + TimeMinMaxTotal.z * fractionalPart;
-        (void) integerPart;
-#else
-        float relativeTime, fractionalPart;
-        relativeTime = ( time - TimeMinMaxTotal.x ) / TimeMinMaxTotal.z;
-        fractionalPart = relativeTime - (float) (long) relativeTime;
-        time = TimeMinMaxTotal.x + TimeMinMaxTotal.z * fractionalPart;
-#endif
+    //
+    // The shared nodes go first (in parent-before-child order).
+    // The jobs only read the matrices of the shared nodes, and write to the own ranges.
+    //
+
+    for ( const uint32_t orderIndex : TransformJobs.SharedOrderIndices ) {
+        UpdateOrderedTransformMatrices( *this, orderIndex, orderIndex + 1, t, false );
     }
 
-    if ( pAnimTransformFrame ) { //SceneNodeTransformFrame *pAnimTransformFrame = GetAnimatedTransformFrame( animStackId, animLayerId ) ) {
-        *pAnimTransformFrame = BindPoseFrame;
-        // assert( pAnimTransformFrame->Transforms.size( ) == BindPoseFrame.Transforms.size( ) );
-        // const size_t transformFrameByteSize = sizeof( SceneNodeTransformComposite ) * pAnimTransformFrame->Transforms.size( );
-        // memcpy( pAnimTransformFrame->Transforms.data( ), BindPoseFrame.Transforms.data( ), transformFrameByteSize );
-
-        for ( const SceneNode &node : Nodes ) {
-            if ( const SceneNodeAnimCurveIds *animCurveIds = GetAnimCurveIds( node.Id, animStackId, animLayerId ) ) {
-                auto &animTransformComposite = pAnimTransformFrame->Transforms[ node.Id ];
-
-                for ( uint32_t propertyIndex = 0; propertyIndex < SceneAnimCurve::ePropertyCount; propertyIndex += SceneAnimCurve::eChannelCount ) {
-                    const SceneAnimCurve::EProperty eProperty = SceneAnimCurve::EProperty( propertyIndex );
-                    const float convertionFactor = IsRotationProperty( eProperty ) ? toRadsFactor : 1.0f;
-
-                    XMFLOAT3 *pProperty = MapProperty( eProperty, &animTransformComposite.Properties );
-
-                    const uint32_t animCurveIdX = animCurveIds->AnimCurveIds[ propertyIndex + SceneAnimCurve::eChannel_X ];
-                    const uint32_t animCurveIdY = animCurveIds->AnimCurveIds[ propertyIndex + SceneAnimCurve::eChannel_Y ];
-                    const uint32_t animCurveIdZ = animCurveIds->AnimCurveIds[ propertyIndex + SceneAnimCurve::eChannel_Z ];
-
-                    const SceneAnimCurve *pAnimCurveX = ( animCurveIdX != detail::kInvalidId ) ? ( &AnimCurves[ animCurveIdX ] ) : nullptr;
-                    const SceneAnimCurve *pAnimCurveY = ( animCurveIdY != detail::kInvalidId ) ? ( &AnimCurves[ animCurveIdY ] ) : nullptr;
-                    const SceneAnimCurve *pAnimCurveZ = ( animCurveIdZ != detail::kInvalidId ) ? ( &AnimCurves[ animCurveIdZ ] ) : nullptr;
-
-                    if ( pAnimCurveX || pAnimCurveY || pAnimCurveZ ) {
-                        switch ( eProperty ) {
-                            case SceneAnimCurve::eProperty_PreRotation:
-                            case SceneAnimCurve::eProperty_PostRotation:
-                            case SceneAnimCurve::eProperty_ScalingPivot:
-                            case SceneAnimCurve::eProperty_ScalingOffset:
-                            case SceneAnimCurve::eProperty_RotationPivot:
-                            case SceneAnimCurve::eProperty_RotationOffset:
-                            case SceneAnimCurve::eProperty_GeometricScaling:
-                            case SceneAnimCurve::eProperty_GeometricRotation:
-                            case SceneAnimCurve::eProperty_GeometricTranslation: {
-                                LogWarn("Animating an object-offset property: {}",
-                                        apemodefb::EnumNameEAnimCurvePropertyFb(
-                                        apemodefb::EAnimCurvePropertyFb(eProperty)));
-                            } break;
-                            default:
-                                break;
-                        }
-                    }
+    // The jobs run on the workers of the application taskflow, only they are awaited (not the other tasks of the application).
+    tf::Taskflow taskflow( pDefaultTaskflow->share_executor( ) );
+    for ( const SceneTransformJob &job : TransformJobs.Jobs ) {
+        taskflow.silent_emplace( [this, &t, job] { UpdateOrderedTransformMatrices( *this, job.OrderIndexBegin, job.OrderIndexEnd, t, false ); } );
+    }
+
+    taskflow.wait_for_all( );
+    t.ClearDirtyFlags( );
+}
 
-                    assert( !pAnimCurveX || pAnimCurveX->eProperty == eProperty && pAnimCurveX->eChannel == SceneAnimCurve::eChannel_X );
-                    assert( !pAnimCurveY || pAnimCurveY->eProperty == eProperty && pAnimCurveY->eChannel == SceneAnimCurve::eChannel_Y );
-                    assert( !pAnimCurveZ || pAnimCurveZ->eProperty == eProperty && pAnimCurveZ->eChannel == SceneAnimCurve::eChannel_Z );
+namespace {
 
-                    pProperty->x = pAnimCurveX ? ( pAnimCurveX->Calculate( time ) * convertionFactor ) : pProperty->x;
-                    pProperty->y = pAnimCurveY ? ( pAnimCurveY->Calculate( time ) * convertionFactor ) : pProperty->y;
-                    pProperty->z = pAnimCurveZ ? ( pAnimCurveZ->Calculate( time ) * convertionFactor ) : pProperty->z;
+/* The keys of the curve, decoded and simplified independently of the other curves.
+ * The decoded keys are released after the simplification, only their count is kept for the statistics.
+ */
+struct DecodedAnimCurveKeys {
+    apemode::vector< SceneAnimCurveKey > Keys;
+    apemode::vector< SceneAnimCurveKey > SimplifiedKeys;
+    size_t                               KeyCount = 0;
+};
 
-                    assert( animTransformComposite.Properties.Validate( ) );
-                }
+// The values are in the units of the properties (degrees for rotations).
+constexpr float kAnimCurveValueTolerance = 1e-4f;
+
+/* Returns true if the simplified curve stays within the tolerance from the source one.
+ * The curves are compared on the source keys and in the middle of the source segments.
+ */
+bool ValidateSimplifiedAnimCurveKeys( const apemode::vector< SceneAnimCurveKey > &keys,
+                                      const apemode::vector< SceneAnimCurveKey > &simplifiedKeys,
+                                      const float                                 tolerance ) {
+    SceneAnimCurveKeys curveKeys;
+    SceneAnimCurve     animCurve;
+    SceneAnimCurve     simplifiedAnimCurve;
+
+    animCurve.KeyCount                    = static_cast< uint32_t >( keys.size( ) );
+    animCurve.BaseKey                     = curveKeys.Append( keys.data( ), animCurve.KeyCount );
+    animCurve.TimeMinMaxTotal             = XMFLOAT3{keys.front( ).Time, keys.back( ).Time, keys.back( ).Time - keys.front( ).Time};
+    simplifiedAnimCurve.KeyCount          = static_cast< uint32_t >( simplifiedKeys.size( ) );
+    simplifiedAnimCurve.BaseKey           = curveKeys.Append( simplifiedKeys.data( ), simplifiedAnimCurve.KeyCount );
+    simplifiedAnimCurve.TimeMinMaxTotal.x = simplifiedKeys.front( ).Time;
+    simplifiedAnimCurve.TimeMinMaxTotal.y = simplifiedKeys.back( ).Time;
+    simplifiedAnimCurve.TimeMinMaxTotal.z = simplifiedKeys.back( ).Time - simplifiedKeys.front( ).Time;
+
+    for ( size_t i = 0; i < keys.size( ); ++i ) {
+        const float time     = keys[ i ].Time;
+        const float nextTime = ( i + 1 ) < keys.size( ) ? keys[ i + 1 ].Time : time;
+
+        // The slack covers the rounding of the Bezier segments.
+        for ( const float t : {time, ( time + nextTime ) * 0.5f} ) {
+            if ( !IsNearlyEqual( animCurve.Calculate( curveKeys, t ), simplifiedAnimCurve.Calculate( curveKeys, t ), tolerance * 2.0f ) ) {
+                return false;
             }
         }
-
-        // return pAnimTransformFrame;
     }
 
-    // return false;
-    // return nullptr;
+    return true;
 }
 
-SceneNodeTransformFrame &apemode::Scene::GetBindPoseTransformFrame( ) {
-    return BindPoseFrame;
-}
+} // namespace
 
-const SceneNodeTransformFrame &apemode::Scene::GetBindPoseTransformFrame( ) const {
-    return BindPoseFrame;
+/* Checks the simplification of the curve with the step in the middle (linear, constant, linear keys).
+ * The constant key holds the value until the last key, it cannot be merged into the flat run of the linear key.
+ */
+bool apemode::utils::CheckAnimCurveKeySimplification( ) {
+    apemode::vector< SceneAnimCurveKey > keys( 3 );
+    keys[ 0 ].eInterpMode = SceneAnimCurveKey::eInterpolationMode_Linear;
+    keys[ 0 ].Time        = 0.0f;
+    keys[ 0 ].Value       = 0.0f;
+    keys[ 1 ].eInterpMode = SceneAnimCurveKey::eInterpolationMode_Const;
+    keys[ 1 ].Time        = 1.0f;
+    keys[ 1 ].Value       = 0.0f;
+    keys[ 2 ].eInterpMode = SceneAnimCurveKey::eInterpolationMode_Linear;
+    keys[ 2 ].Time        = 2.0f;
+    keys[ 2 ].Value       = 10.0f;
+
+    apemode::vector< SceneAnimCurveKey > simplifiedKeys;
+    SimplifyAnimCurveKeys( keys, simplifiedKeys, kAnimCurveValueTolerance );
+    return simplifiedKeys.size( ) == 3 && ValidateSimplifiedAnimCurveKeys( keys, simplifiedKeys, kAnimCurveValueTolerance );
 }
 
+namespace {
 
-bool apemode::Scene::HasAnimStackLayer( uint16_t animStackId, uint16_t animLayerId ) const {
-    if ( animStackId < AnimStacks.size() ) {
-        return animLayerId < AnimStacks[animStackId].LayerCount;
-    }
+/* Decodes the keys of the curve (Draco point cloud for the compressed curves), sorts them by time, drops the duplicates and simplifies them.
+ * Only the curve buffer is read, the curves can be decoded in parallel.
+ */
+void DecodeAnimCurveKeys( const apemodefb::AnimCurveFb *pAnimCurveFb, DecodedAnimCurveKeys &decodedKeys, const bool bValidate ) {
+    assert( IsNotNullAndNotEmpty( pAnimCurveFb->keys( ) ) );
+    apemode::vector< SceneAnimCurveKey > &animCurveKeys = decodedKeys.Keys;
+
+    if ( pAnimCurveFb->compression_type() == apemodefb::ECompressionTypeFb_None ) {
+        auto keys = (const apemodefb::AnimCurveCubicKeyFb*) pAnimCurveFb->keys( )->data( );
+        auto keysEnd = keys + pAnimCurveFb->keys( )->size( ) / sizeof( apemodefb::AnimCurveCubicKeyFb );
+
+        animCurveKeys.reserve( eastl::distance( keys, keysEnd ) );
+        eastl::transform( keys,
+                          keysEnd,
+                          eastl::back_inserter( animCurveKeys ),
+                          []( const apemodefb::AnimCurveCubicKeyFb &keyFb ) {
+                              auto pKeyFb = &keyFb;
+                              return SceneAnimCurveKey{
+                                  SceneAnimCurveKey::EInterpolationMode(pKeyFb->interpolation_mode()),
+                                  pKeyFb->time( ),
+                                  pKeyFb->value_bez0_bez3( ),
+                                  pKeyFb->bez1( ),
+                                  pKeyFb->bez2( ),
+                              };
+                          } );
 
-    return false;
-}
+    } else {
+        draco::DecoderBuffer decoderBuffer;
+        decoderBuffer.Init( (const char *)pAnimCurveFb->keys( )->data( ), pAnimCurveFb->keys( )->size( ) );
 
-void apemode::Scene::UpdateTransformMatrices( const uint32_t parentNodeId, SceneNodeTransformFrame &t ) const {
-    assert( parentNodeId == Nodes[ parentNodeId ].Id );
-    const SceneNodeTransformComposite &transformComposite = t.Transforms[ parentNodeId ];
+        draco::DecoderOptions options;
+        draco::Decoder decoder;
+        draco::PointCloud animPointCloud;
 
-    const auto childIdRange = NodeToChildIds.equal_range( parentNodeId );
-    for ( auto childIdIt = childIdRange.first; childIdIt != childIdRange.second; ++childIdIt ) {
-        const uint32_t childId = childIdIt->second;
-        const SceneNode & childNode = Nodes[ childId ];
-        SceneNodeTransformComposite &childTransformComposite = t.Transforms[ childId ];
+        draco::Status status = decoder.DecodeBufferToGeometry( &decoderBuffer, &animPointCloud );
+        if (status.code() == draco::Status::OK) {
+            constexpr int keyValuesAttributeIndex = 0;
+            constexpr int keyTimeAttributeIndex = 1;
+            constexpr int keyTypeAttributeIndex = 2;
 
-        assert( parentNodeId == childNode.ParentId );
+            const draco::PointAttribute* keyValuesAttribute = animPointCloud.attribute( keyValuesAttributeIndex );
+            const draco::PointAttribute* keyTimeAttribute = animPointCloud.attribute( keyTimeAttributeIndex );
+            const draco::PointAttribute* keyTypeAttribute = animPointCloud.attribute( keyTypeAttributeIndex );
 
-        if (childNode.LimitsId != uint32_t(-1)) {
-            childTransformComposite.Properties.ApplyLimits(Limits[childNode.LimitsId]);
-        }
+            animCurveKeys.resize( animPointCloud.num_points( ) );
+            for (uint32_t i = 0; i < animPointCloud.num_points( ); ++i) {
+                const draco::PointIndex pointIndex {i};
 
-        childTransformComposite.LocalMatrix        = childTransformComposite.Properties.CalculateLocalMatrix( childNode.eOrder );
-        childTransformComposite.GeometricalMatrix  = childTransformComposite.Properties.CalculateGeometricMatrix( childNode.eOrder );
-        childTransformComposite.HierarchicalMatrix = childTransformComposite.LocalMatrix * transformComposite.HierarchicalMatrix;
-        childTransformComposite.WorldMatrix        = childTransformComposite.GeometricalMatrix * childTransformComposite.HierarchicalMatrix;
+                auto &key = animCurveKeys[i];
+                keyTimeAttribute->GetMappedValue( pointIndex, &key.Time );
 
-        assert( childTransformComposite.Properties.Validate() );
-        assert( IsValid( transformComposite.HierarchicalMatrix ) );
-        assert( IsValid( childTransformComposite.LocalMatrix ) );
-        assert( IsValid( childTransformComposite.HierarchicalMatrix ) );
-        assert( IsValid( childTransformComposite.GeometricalMatrix ) );
-        assert( IsValid( childTransformComposite.WorldMatrix ) );
+                keyValuesAttribute->GetMappedValue( pointIndex, &key.Value );
+                keyTypeAttribute->GetMappedValue( pointIndex, &key.eInterpMode );
+            }
+        }
 
-        UpdateTransformMatrices( childId, t );
+        #if 0
+        draco::KeyframeAnimationDecoder keyframeAnimationDecoder;
+        draco::DecoderOptions options;
+        draco::KeyframeAnimation keyframeAnimation;
+
+        keyframeAnimationDecoder.Decode(options, &decoderBuffer, &keyframeAnimation);
+
+        const size_t numFrames = keyframeAnimation.num_frames();
+        const auto timestamps = keyframeAnimation.timestamps();
+        const auto * values = keyframeAnimation.keyframes(1);
+        const auto * interpolationTypes = keyframeAnimation.keyframes(2);
+
+        animCurve.Keys.reserve(numFrames);
+        for (uint32_t i = 0; i < numFrames; ++i) {
+            float mappedTimestamp {};
+            XMFLOAT3 mappedValues {};
+            uint8_t mappedInterpolationType {};
+
+            timestamps->GetMappedValue(draco::PointIndex(i), &mappedTimestamp);
+            values->GetMappedValue(draco::PointIndex(i), &mappedValues);
+            interpolationTypes->GetMappedValue(draco::PointIndex(i), &mappedInterpolationType);
+
+            auto &key = animCurve.Keys[mappedTimestamp];
+            key.Time = mappedTimestamp;
+            key.Value = mappedValues.x;
+            key.Bez1 = mappedValues.y;
+            key.Bez2 = mappedValues.z;
+            key.eInterpMode = SceneAnimCurveKey::EInterpolationMode(mappedInterpolationType);
+        }
+        #endif
     }
-}
 
-void apemode::Scene::UpdateTransformMatrices( SceneNodeTransformFrame &t ) const {
-    if ( t.Transforms.empty( ) || Nodes.empty( ) )
-        return;
+    // Sort the keys by time (point clouds do not preserve the order), and drop the duplicates.
+    const auto keyTimeLess = []( const SceneAnimCurveKey &a, const SceneAnimCurveKey &b ) { return a.Time < b.Time; };
+    const auto keyTimeEqual = []( const SceneAnimCurveKey &a, const SceneAnimCurveKey &b ) { return a.Time == b.Time; };
+    if ( !eastl::is_sorted( animCurveKeys.begin( ), animCurveKeys.end( ), keyTimeLess ) ) {
+        eastl::stable_sort( animCurveKeys.begin( ), animCurveKeys.end( ), keyTimeLess );
+    }
 
-    //
-    // Implicit world calculations for the root node.
-    // Start recursive updates from the root node.
-    //
+    animCurveKeys.erase( eastl::unique( animCurveKeys.begin( ), animCurveKeys.end( ), keyTimeEqual ), animCurveKeys.end( ) );
+    assert( !animCurveKeys.empty( ) );
+
+    SimplifyAnimCurveKeys( animCurveKeys, decodedKeys.SimplifiedKeys, kAnimCurveValueTolerance );
+
+    if ( bValidate && !ValidateSimplifiedAnimCurveKeys( animCurveKeys, decodedKeys.SimplifiedKeys, kAnimCurveValueTolerance ) ) {
+        LogWarn( "Simplified curve #{} exceeds the tolerance ({}), keys: {} -> {}",
+                 pAnimCurveFb->id( ),
+                 kAnimCurveValueTolerance,
+                 animCurveKeys.size( ),
+                 decodedKeys.SimplifiedKeys.size( ) );
+    }
 
-    SceneNodeTransformComposite &rootTransformComposite = t.Transforms[ 0 ];
-    const detail::ERotationOrder eRootOrder = Nodes.front( ).eOrder;
+    decodedKeys.KeyCount = animCurveKeys.size( );
+    apemode::vector< SceneAnimCurveKey >( ).swap( animCurveKeys );
+}
 
-    rootTransformComposite.LocalMatrix        = rootTransformComposite.Properties.CalculateLocalMatrix( eRootOrder );
-    rootTransformComposite.GeometricalMatrix  = rootTransformComposite.Properties.CalculateGeometricMatrix( eRootOrder );
-    rootTransformComposite.HierarchicalMatrix = rootTransformComposite.LocalMatrix;
-    rootTransformComposite.WorldMatrix        = rootTransformComposite.GeometricalMatrix * rootTransformComposite.LocalMatrix;
+/* Elapsed times of the scene loading phases (in milliseconds).
+ * The nodes, the meshes, the skins and the curve decoding are the tasks, their times are measured on the worker threads,
+ * the curve decoding time is the sum over the curves.
+ */
+struct LoadScenePhaseTimes {
+    double Verification      = 0;
+    double Tasks             = 0;
+    double Nodes             = 0;
+    double Meshes            = 0;
+    double Skins             = 0;
+    double AnimCurveDecoding = 0;
+    double NodeHierarchy     = 0;
+    double AnimCurves        = 0;
+    double NodeTransforms    = 0;
+    double NodePruning       = 0;
+    double TrackQuantization = 0;
+    double Materials         = 0;
+    double Total             = 0;
+};
 
-    UpdateTransformMatrices( 0, t );
+double GetElapsedMilliseconds( const apemode::platform::Stopwatch &stopwatch ) {
+    return stopwatch.GetElapsedSeconds( ) * 1000.0;
 }
 
-apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fileContents ) {
+/* Loads the scene from the contents of the file, the contents are referenced by the loaded scene (not copied).
+ */
+apemode::LoadedScene LoadSceneFromBuffer( const uint8_t *pFileContents, const size_t fileContentsSize, const SceneLoadOptions &options ) {
     using namespace utils;
 
-    const apemodefb::SceneFb *pSrcScene = !fileContents.empty( )
-                                        ? apemodefb::GetSceneFb( fileContents.data( ) )
-                                        : nullptr;
+    if ( nullptr == pFileContents || !fileContentsSize ) {
+        LogError( "Failed to reinterpret the buffer to scene." );
+        return apemode::LoadedScene{};
+    }
+
+    LoadScenePhaseTimes phaseTimes;
+    platform::Stopwatch totalStopwatch;
+    totalStopwatch.Start( );
+
+    // The offsets are validated in place, the table count limit is raised for the large scenes.
+    if ( options.bVerifyBuffer ) {
+        flatbuffers::Verifier verifier( pFileContents, fileContentsSize, 64, 1u << 30 );
+        if ( !apemodefb::VerifySceneFbBuffer( verifier ) ) {
+            LogError( "Failed to verify the scene buffer ({} bytes).", fileContentsSize );
+            return apemode::LoadedScene{};
+        }
+    }
 
+    phaseTimes.Verification = GetElapsedMilliseconds( totalStopwatch );
+
+    const apemodefb::SceneFb *pSrcScene = apemodefb::GetSceneFb( pFileContents );
     if ( nullptr == pSrcScene ) {
         LogError( "Failed to reinterpret the buffer to scene." );
         return apemode::LoadedScene{};
@@ -515,9 +2705,19 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
 
     if ( IsNotNullAndNotEmpty( pNodesFb ) ) {
         pScene->Nodes.resize( pNodesFb->size( ) );
+        pScene->InitializeTransformFrame( pScene->BindPoseFrame );
+    }
+
+    /* The nodes, the meshes, the skins and the curves are loaded as the tasks (each curve is decoded separately).
+     * Each task writes its own arrays of the scene, the skins wait for the nodes (link names) and the meshes (skin IDs).
+     * The order-dependent parts (the hierarchy, the curve key arrays, the layer tracks) are built after the tasks in the file order,
+     * so the loaded scene does not depend on the scheduling.
+     */
+    const auto loadNodes = [&] {
+        platform::Stopwatch stopwatch;
+        stopwatch.Start( );
 
         SceneNodeTransformFrame &bindPoseFrame = pScene->BindPoseFrame;
-        pScene->InitializeTransformFrame( bindPoseFrame );
 
         apemode::vector<uint32_t> rootIds;
         apemode::vector<uint32_t> limbIds;
@@ -563,7 +2763,7 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
                 }
             }
 
-            auto &transformComposite = bindPoseFrame.Transforms[ pNodeFb->id( ) ];
+            auto &transformProperties = bindPoseFrame.Properties[ pNodeFb->id( ) ];
             auto transformFb = pSrcScene->transforms( )->Get( pNodeFb->id( ) );
 
 #define MATCH_VECTOR_TYPE( v, V ) \
@@ -573,53 +2773,53 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
         v.z = V.z( );             \
     }
 
-            MATCH_VECTOR_TYPE( transformComposite.Properties.Translation, transformFb->translation( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.RotationOffset, transformFb->rotation_offset( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.RotationPivot, transformFb->rotation_pivot( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.PreRotation, transformFb->pre_rotation( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.Rotation, transformFb->rotation( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.PostRotation, transformFb->post_rotation( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.ScalingOffset, transformFb->scaling_offset( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.ScalingPivot, transformFb->scaling_pivot( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.Scaling, transformFb->scaling( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.GeometricTranslation, transformFb->geometric_translation( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.GeometricRotation, transformFb->geometric_rotation( ) );
-            MATCH_VECTOR_TYPE( transformComposite.Properties.GeometricScaling, transformFb->geometric_scaling( ) );
-
-            transformComposite.Properties.PreRotation.x *= toRadsFactor;
-            transformComposite.Properties.PreRotation.y *= toRadsFactor;
-            transformComposite.Properties.PreRotation.z *= toRadsFactor;
-            transformComposite.Properties.Rotation.x *= toRadsFactor;
-            transformComposite.Properties.Rotation.y *= toRadsFactor;
-            transformComposite.Properties.Rotation.z *= toRadsFactor;
-            transformComposite.Properties.PostRotation.x *= toRadsFactor;
-            transformComposite.Properties.PostRotation.y *= toRadsFactor;
-            transformComposite.Properties.PostRotation.z *= toRadsFactor;
-            transformComposite.Properties.GeometricRotation.x *= toRadsFactor;
-            transformComposite.Properties.GeometricRotation.y *= toRadsFactor;
-            transformComposite.Properties.GeometricRotation.z *= toRadsFactor;
+            MATCH_VECTOR_TYPE( transformProperties.Translation, transformFb->translation( ) );
+            MATCH_VECTOR_TYPE( transformProperties.RotationOffset, transformFb->rotation_offset( ) );
+            MATCH_VECTOR_TYPE( transformProperties.RotationPivot, transformFb->rotation_pivot( ) );
+            MATCH_VECTOR_TYPE( transformProperties.PreRotation, transformFb->pre_rotation( ) );
+            MATCH_VECTOR_TYPE( transformProperties.Rotation, transformFb->rotation( ) );
+            MATCH_VECTOR_TYPE( transformProperties.PostRotation, transformFb->post_rotation( ) );
+            MATCH_VECTOR_TYPE( transformProperties.ScalingOffset, transformFb->scaling_offset( ) );
+            MATCH_VECTOR_TYPE( transformProperties.ScalingPivot, transformFb->scaling_pivot( ) );
+            MATCH_VECTOR_TYPE( transformProperties.Scaling, transformFb->scaling( ) );
+            MATCH_VECTOR_TYPE( transformProperties.GeometricTranslation, transformFb->geometric_translation( ) );
+            MATCH_VECTOR_TYPE( transformProperties.GeometricRotation, transformFb->geometric_rotation( ) );
+            MATCH_VECTOR_TYPE( transformProperties.GeometricScaling, transformFb->geometric_scaling( ) );
+
+            transformProperties.PreRotation.x *= toRadsFactor;
+            transformProperties.PreRotation.y *= toRadsFactor;
+            transformProperties.PreRotation.z *= toRadsFactor;
+            transformProperties.Rotation.x *= toRadsFactor;
+            transformProperties.Rotation.y *= toRadsFactor;
+            transformProperties.Rotation.z *= toRadsFactor;
+            transformProperties.PostRotation.x *= toRadsFactor;
+            transformProperties.PostRotation.y *= toRadsFactor;
+            transformProperties.PostRotation.z *= toRadsFactor;
+            transformProperties.GeometricRotation.x *= toRadsFactor;
+            transformProperties.GeometricRotation.y *= toRadsFactor;
+            transformProperties.GeometricRotation.z *= toRadsFactor;
 
 #define REPORT_USED_PROPERTY( P, d )                                                    \
     if ( !IsNearlyEqual( P.x, d ) || !IsNearlyEqual( P.y, d ) || !IsNearlyEqual( P.z, d ) ) { \
         LogWarn( "Node \"{}\" uses property \"{}\".", GetCStringProperty( pSrcScene, pNodeFb->name_id( ) ), #P );                                          \
     }
 
-            REPORT_USED_PROPERTY( transformComposite.Properties.Translation, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.Rotation, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.Scaling, 1 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.ScalingOffset, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.ScalingPivot, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.RotationOffset, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.RotationPivot, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.PreRotation, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.PostRotation, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.GeometricRotation, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.GeometricTranslation, 0 );
-            REPORT_USED_PROPERTY( transformComposite.Properties.GeometricScaling, 1 );
+            REPORT_USED_PROPERTY( transformProperties.Translation, 0 );
+            REPORT_USED_PROPERTY( transformProperties.Rotation, 0 );
+            REPORT_USED_PROPERTY( transformProperties.Scaling, 1 );
+            REPORT_USED_PROPERTY( transformProperties.ScalingOffset, 0 );
+            REPORT_USED_PROPERTY( transformProperties.ScalingPivot, 0 );
+            REPORT_USED_PROPERTY( transformProperties.RotationOffset, 0 );
+            REPORT_USED_PROPERTY( transformProperties.RotationPivot, 0 );
+            REPORT_USED_PROPERTY( transformProperties.PreRotation, 0 );
+            REPORT_USED_PROPERTY( transformProperties.PostRotation, 0 );
+            REPORT_USED_PROPERTY( transformProperties.GeometricRotation, 0 );
+            REPORT_USED_PROPERTY( transformProperties.GeometricTranslation, 0 );
+            REPORT_USED_PROPERTY( transformProperties.GeometricScaling, 1 );
 
 #undef REPORT_USED_PROPERTY
 
-            if ( !transformComposite.Properties.Validate( ) ) {
+            if ( !transformProperties.Validate( ) ) {
                 LogError( "Found invalid transform, node id {}", pNodeFb->id( ) );
                 assert( false );
             }
@@ -650,17 +2850,206 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
                 limits.RotationMin.z *= toRadsFactor;
             }
 
-#undef MATCH_VECTOR_TYPE
+#undef MATCH_VECTOR_TYPE
+
+            auto pAnimCurveIdsFb = pNodeFb->anim_curve_ids( );
+            if ( IsNotNullAndNotEmpty( pAnimCurveIdsFb ) ) {
+                for ( const uint32_t animCurveId : *pAnimCurveIdsFb ) {
+                    assert( animCurveId < pAnimCurvesFb->size( ) );
+                    pScene->NodeIdToAnimCurveIds.insert( eastl::make_pair( node.Id, animCurveId ) );
+                }
+            }
+        }
+
+        phaseTimes.Nodes = GetElapsedMilliseconds( stopwatch );
+    };
+
+    const auto loadMeshes = [&] {
+        platform::Stopwatch stopwatch;
+        stopwatch.Start( );
+
+        { /* All the subsets are stored in Scene instance, and can be referenced
+           * by the BaseSubset and SubsetCount values in SceneMeshSubset struct.
+           */
+
+            size_t totalSubsetCount = 0;
+            for ( uint32_t meshId = 0; meshId < pMeshesFb->size( ); ++meshId ) {
+                auto pMeshFb = pMeshesFb->Get( meshId );
+                totalSubsetCount += pMeshFb->subsets( ) ? pMeshFb->subsets( )->size( ) : 0;
+            }
+
+            pScene->Subsets.reserve( totalSubsetCount );
+        }
+
+        pScene->Meshes.reserve( pMeshesFb->size( ) );
+        for ( uint32_t meshId = 0; meshId < pMeshesFb->size( ); ++meshId ) {
+            auto pMeshFb = pMeshesFb->Get( meshId );
+
+            assert( pMeshFb );
+            assert( IsNotNullAndNotEmpty( pMeshFb->vertices( ) ) );
+            // assert( IsNotNullAndNotEmpty( pMeshFb->indices( ) ) );
+            assert( IsNotNullAndNotEmpty( pMeshFb->subsets( ) ) );
+            assert( IsNotNullAndNotEmpty( pMeshFb->submeshes( ) ) );
+
+            // std::array<apemode::detail::SkinnedVertex, 128> sv;
+            // memcpy(sv.data(), pMeshFb->vertices(), std::min<size_t>(sizeof(sv), pMeshFb->vertices()->size()));
+
+            pScene->Meshes.emplace_back( );
+            auto &mesh = pScene->Meshes.back( );
+
+            mesh.SubsetCount = static_cast< uint32_t >( pMeshFb->subsets( )->size( ) );
+            mesh.BaseSubset  = static_cast< uint32_t >( pScene->Subsets.size( ) );
+            mesh.eVertexType = detail::eVertexType_Custom;
+
+//            auto pSubmeshesFb = pMeshFb->submeshes( );
+//            auto pSubmeshFb   = pSubmeshesFb->Get( 0 );
+//            switch ( pSubmeshFb->vertex_format( ) ) {
+//                case apemodefb::EVertexFormatFb_Default:
+//                    mesh.eVertexType = detail::eVertexType_Default;
+//                    break;
+//                case apemodefb::EVertexFormatFb_Skinned:
+//                    mesh.eVertexType = detail::eVertexType_Skinned;
+//                    break;
+//                case apemodefb::EVertexFormatFb_FatSkinned:
+//                    mesh.eVertexType = detail::eVertexType_FatSkinned;
+//                    break;
+//                default:
+//                    break;
+//            }
+
+            std::transform( pMeshFb->subsets( )->begin( ),
+                            pMeshFb->subsets( )->end( ),
+                            std::back_inserter( pScene->Subsets ),
+                            [&]( const apemodefb::SubsetFb *pSubsetFb ) {
+
+                                SceneMeshSubset subset;
+                                subset.MeshId     = mesh.Id;
+                                subset.MaterialId = pSubsetFb->material_id( );
+                                subset.BaseIndex  = pSubsetFb->base_index( );
+                                subset.IndexCount = pSubsetFb->index_count( );
+
+                                return subset;
+                            } );
+
+            mesh.Id     = meshId;
+            mesh.SkinId = pMeshFb->skin_id( );
+        }
+
+        phaseTimes.Meshes = GetElapsedMilliseconds( stopwatch );
+    };
+
+    const auto loadSkins = [&] {
+        platform::Stopwatch stopwatch;
+        stopwatch.Start( );
+
+        pScene->Skins.resize( pSkinsFb->size() );
+
+        for ( auto &mesh : pScene->Meshes ) {
+            if ( mesh.SkinId != detail::kInvalidId ) {
+                auto &skin = pScene->Skins[ mesh.SkinId ];
+                skin.Id = mesh.SkinId;
+
+                auto pSkinFb          = pSkinsFb->Get( mesh.SkinId );
+                auto pInvBindMatrices = pSkinFb->inv_bind_pose_matrices( );
+
+                if ( skin.LinkIds.empty( ) && pSkinFb ) {
+
+                    auto pLinkIdsFb = pSkinFb->links_ids( );
+                    if ( IsNotNullAndNotEmpty( pLinkIdsFb ) ) {
+
+                        LogInfo( "Processing skin: \"{}\", links {}",
+                                 GetCStringProperty( pSrcScene, pSkinFb->name_id( ) ),
+                                 pLinkIdsFb->size( ) );
+
+                        skin.LinkIds.reserve( pLinkIdsFb->size( ) );
+                        skin.InvBindPoseMatrices.reserve( pLinkIdsFb->size( ) );
+
+                        for ( uint32_t linkIndex = 0; linkIndex < pLinkIdsFb->size( ); ++linkIndex ) {
+                            auto linkNodeId = pLinkIdsFb->Get( linkIndex );
+                            LogInfo( "\t+ link {} \"{}\"", linkNodeId, pScene->Nodes[ linkNodeId ].pszName );
+
+                            const XMFLOAT4X4 *invBindPoseMatrixFb = (const XMFLOAT4X4 *) pInvBindMatrices->Get( linkIndex );
+                            XMMATRIX invBindPoseMatrix = XMLoadFloat4x4( invBindPoseMatrixFb );
+                            skin.LinkIds.push_back( linkNodeId );
+                            skin.InvBindPoseMatrices.push_back( invBindPoseMatrix );
+                        }
+                    }
+                }
+            }
+        }
+
+        phaseTimes.Skins = GetElapsedMilliseconds( stopwatch );
+    };
 
-            auto pAnimCurveIdsFb = pNodeFb->anim_curve_ids( );
-            if ( IsNotNullAndNotEmpty( pAnimCurveIdsFb ) ) {
-                for ( const uint32_t animCurveId : *pAnimCurveIdsFb ) {
-                    assert( animCurveId < pAnimCurvesFb->size( ) );
-                    pScene->NodeIdToAnimCurveIds.insert( eastl::make_pair( node.Id, animCurveId ) );
-                }
+    const uint32_t animCurveCount = IsNotNullAndNotEmpty( pAnimCurvesFb ) ? pAnimCurvesFb->size( ) : 0;
+    apemode::vector< DecodedAnimCurveKeys > decodedAnimCurveKeys( animCurveCount );
+    apemode::vector< double >               animCurveDecodingTimes( animCurveCount, 0.0 );
+
+    const auto decodeAnimCurve = [&]( const uint32_t animCurveIndex ) {
+        platform::Stopwatch stopwatch;
+        stopwatch.Start( );
+
+        DecodeAnimCurveKeys( pAnimCurvesFb->Get( animCurveIndex ), decodedAnimCurveKeys[ animCurveIndex ], options.bValidateAnimCurves );
+        animCurveDecodingTimes[ animCurveIndex ] = GetElapsedMilliseconds( stopwatch );
+    };
+
+    platform::Stopwatch phaseStopwatch;
+    phaseStopwatch.Start( );
+
+    tf::Taskflow *pDefaultTaskflow = options.bParallelLoading && AppState::Get( ) ? AppState::Get( )->GetDefaultTaskflow( ) : nullptr;
+    if ( pDefaultTaskflow ) {
+        // The loading graph runs on the workers of the application taskflow, only its tasks are awaited.
+        tf::Taskflow taskflow( pDefaultTaskflow->share_executor( ) );
+
+        tf::Task skinsTask = taskflow.silent_emplace( [&] {
+            if ( IsNotNullAndNotEmpty( pSkinsFb ) ) {
+                loadSkins( );
             }
+        } );
+
+        if ( IsNotNullAndNotEmpty( pNodesFb ) ) {
+            taskflow.silent_emplace( loadNodes ).precede( skinsTask );
         }
 
+        if ( IsNotNullAndNotEmpty( pMeshesFb ) ) {
+            taskflow.silent_emplace( loadMeshes ).precede( skinsTask );
+        }
+
+        for ( uint32_t animCurveIndex = 0; animCurveIndex < animCurveCount; ++animCurveIndex ) {
+            taskflow.silent_emplace( [&decodeAnimCurve, animCurveIndex] { decodeAnimCurve( animCurveIndex ); } );
+        }
+
+        taskflow.wait_for_all( );
+    } else {
+        if ( IsNotNullAndNotEmpty( pNodesFb ) ) {
+            loadNodes( );
+        }
+
+        if ( IsNotNullAndNotEmpty( pMeshesFb ) ) {
+            loadMeshes( );
+        }
+
+        if ( IsNotNullAndNotEmpty( pSkinsFb ) ) {
+            loadSkins( );
+        }
+
+        for ( uint32_t animCurveIndex = 0; animCurveIndex < animCurveCount; ++animCurveIndex ) {
+            decodeAnimCurve( animCurveIndex );
+        }
+    }
+
+    phaseTimes.Tasks = GetElapsedMilliseconds( phaseStopwatch );
+    for ( const double animCurveDecodingTime : animCurveDecodingTimes ) {
+        phaseTimes.AnimCurveDecoding += animCurveDecodingTime;
+    }
+
+    phaseStopwatch.Start( );
+
+    if ( IsNotNullAndNotEmpty( pNodesFb ) ) {
+        SceneNodeTransformFrame &bindPoseFrame = pScene->BindPoseFrame;
+
+        FlattenNodeHierarchy( *pScene );
+        PartitionNodeHierarchy( *pScene );
         pScene->UpdateTransformMatrices( bindPoseFrame );
         //BuildSkeletons( pScene.get(), eastl::move( rootIds ), eastl::move( limbIds ) );
 
@@ -669,8 +3058,9 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
         for ( auto &node : pScene->Nodes ) {
             XMFLOAT4X4 WM;
             XMFLOAT4X4 HM;
-            XMStoreFloat4x4( &WM, bindPoseFrame.Transforms[ node.Id ].WorldMatrix );
-            XMStoreFloat4x4( &HM, bindPoseFrame.Transforms[ node.Id ].HierarchicalMatrix );
+            XMStoreFloat4x4( &WM, bindPoseFrame.GetWorldMatrix( node.Id ) );
+            XMStoreFloat4x4( &HM, node.HierarchicalMatrixId != detail::kInvalidId ? bindPoseFrame.GetHierarchicalMatrix( node.HierarchicalMatrixId )
+                                                                                 : bindPoseFrame.GetWorldMatrix( node.Id ) );
 
             LogInfo( "Node \"{}\"", node.pszName );
             LogInfo( "----------------------------------" );
@@ -688,13 +3078,29 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
 #endif
     }
 
+    phaseTimes.NodeHierarchy = GetElapsedMilliseconds( phaseStopwatch );
+    phaseStopwatch.Start( );
+
     if ( IsNotNullAndNotEmpty( pAnimCurvesFb ) ) {
 
         assert( IsNotNullAndNotEmpty( pAnimLayersFb ) );
         assert( IsNotNullAndNotEmpty( pAnimStacksFb ) );
         pScene->AnimCurves.reserve( pAnimCurvesFb->size( ) );
 
-        for ( auto pAnimCurveFb : *pAnimCurvesFb ) {
+        // The keys are decoded, the exact count is known (the compressed curves included).
+        size_t totalKeyCount = 0;
+        for ( const DecodedAnimCurveKeys &decodedKeys : decodedAnimCurveKeys ) {
+            totalKeyCount += decodedKeys.SimplifiedKeys.size( );
+        }
+
+        pScene->AnimCurveKeys.Reserve( totalKeyCount );
+
+        // The decoded keys are appended to the scene key arrays in the curve order.
+        size_t decodedKeyCount     = 0;
+        size_t constAnimCurveCount = 0;
+
+        for ( uint32_t animCurveIndex = 0; animCurveIndex < animCurveCount; ++animCurveIndex ) {
+            auto pAnimCurveFb = pAnimCurvesFb->Get( animCurveIndex );
             assert( pAnimCurveFb );
 
             LogInfo( "Processing curve: #{} -> \"{}\", keys={}",
@@ -722,103 +3128,39 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
             animCurve.eChannel    = SceneAnimCurve::EChannel( pAnimCurveFb->channel( ) );
             animCurve.eProperty   = SceneAnimCurve::EProperty( pAnimCurveFb->property( ) * SceneAnimCurve::eChannelCount );
 
-            assert( IsNotNullAndNotEmpty( pAnimCurveFb->keys( ) ) );
-            animCurve.Keys.reserve( pAnimCurveFb->keys( )->size( ) );
-
-            if ( pAnimCurveFb->compression_type() == apemodefb::ECompressionTypeFb_None ) {
-                auto keys = (const apemodefb::AnimCurveCubicKeyFb*) pAnimCurveFb->keys( )->data( );
-                auto keysEnd = keys + pAnimCurveFb->keys( )->size( ) / sizeof( apemodefb::AnimCurveCubicKeyFb );
-
-                eastl::transform( keys,
-                                  keysEnd,
-                                  eastl::inserter( animCurve.Keys, animCurve.Keys.begin( ) ),
-                                  []( const apemodefb::AnimCurveCubicKeyFb &keyFb ) {
-                                      auto pKeyFb = &keyFb;
-                                      return eastl::make_pair< float, SceneAnimCurveKey >( pKeyFb->time( ),
-                                                                                           SceneAnimCurveKey{
-                                                                                               SceneAnimCurveKey::EInterpolationMode(pKeyFb->interpolation_mode()),
-                                                                                               pKeyFb->time( ),
-                                                                                               pKeyFb->value_bez0_bez3( ),
-                                                                                               pKeyFb->bez1( ),
-                                                                                               pKeyFb->bez2( ),
-                                                                                           } );
-                                  } );
-
-            } else {
-                draco::DecoderBuffer decoderBuffer;
-                decoderBuffer.Init( (const char *)pAnimCurveFb->keys( )->data( ), pAnimCurveFb->keys( )->size( ) );
-
-                draco::DecoderOptions options;
-                draco::Decoder decoder;
-                draco::PointCloud animPointCloud;
-
-                draco::Status status = decoder.DecodeBufferToGeometry( &decoderBuffer, &animPointCloud );
-                if (status.code() == draco::Status::OK) {
-                    constexpr int keyValuesAttributeIndex = 0;
-                    constexpr int keyTimeAttributeIndex = 1;
-                    constexpr int keyTypeAttributeIndex = 2;
-
-                    const draco::PointAttribute* keyValuesAttribute = animPointCloud.attribute( keyValuesAttributeIndex );
-                    const draco::PointAttribute* keyTimeAttribute = animPointCloud.attribute( keyTimeAttributeIndex );
-                    const draco::PointAttribute* keyTypeAttribute = animPointCloud.attribute( keyTypeAttributeIndex );
-
-                    animCurve.Keys.reserve( animPointCloud.num_points( ) );
-                    for (uint32_t i = 0; i < animPointCloud.num_points( ); ++i) {
-                        const draco::PointIndex pointIndex {i};
-
-                        float mappedTime = 0;
-                        keyTimeAttribute->GetMappedValue( pointIndex, &mappedTime );
+            const size_t                                animCurveKeyCount       = decodedAnimCurveKeys[ animCurveIndex ].KeyCount;
+            const apemode::vector< SceneAnimCurveKey > &simplifiedAnimCurveKeys = decodedAnimCurveKeys[ animCurveIndex ].SimplifiedKeys;
 
-                        auto &key = animCurve.Keys[mappedTime];
-                        key.Time = mappedTime;
+            decodedKeyCount += animCurveKeyCount;
+            constAnimCurveCount += simplifiedAnimCurveKeys.size( ) == 1 ? 1 : 0;
 
-                        keyValuesAttribute->GetMappedValue( pointIndex, &key.Value );
-                        keyTypeAttribute->GetMappedValue( pointIndex, &key.eInterpMode );
-                    }
-                }
-
-                #if 0
-                draco::KeyframeAnimationDecoder keyframeAnimationDecoder;
-                draco::DecoderOptions options;
-                draco::KeyframeAnimation keyframeAnimation;
-
-                keyframeAnimationDecoder.Decode(options, &decoderBuffer, &keyframeAnimation);
-
-                const size_t numFrames = keyframeAnimation.num_frames();
-                const auto timestamps = keyframeAnimation.timestamps();
-                const auto * values = keyframeAnimation.keyframes(1);
-                const auto * interpolationTypes = keyframeAnimation.keyframes(2);
-
-                animCurve.Keys.reserve(numFrames);
-                for (uint32_t i = 0; i < numFrames; ++i) {
-                    float mappedTimestamp {};
-                    XMFLOAT3 mappedValues {};
-                    uint8_t mappedInterpolationType {};
-
-                    timestamps->GetMappedValue(draco::PointIndex(i), &mappedTimestamp);
-                    values->GetMappedValue(draco::PointIndex(i), &mappedValues);
-                    interpolationTypes->GetMappedValue(draco::PointIndex(i), &mappedInterpolationType);
-
-                    auto &key = animCurve.Keys[mappedTimestamp];
-                    key.Time = mappedTimestamp;
-                    key.Value = mappedValues.x;
-                    key.Bez1 = mappedValues.y;
-                    key.Bez2 = mappedValues.z;
-                    key.eInterpMode = SceneAnimCurveKey::EInterpolationMode(mappedInterpolationType);
-                }
-                #endif
-            }
+            animCurve.KeyCount = static_cast< uint32_t >( simplifiedAnimCurveKeys.size( ) );
+            animCurve.BaseKey  = pScene->AnimCurveKeys.Append( simplifiedAnimCurveKeys.data( ), animCurve.KeyCount );
 
-            animCurve.TimeMinMaxTotal.x = animCurve.Keys.cbegin( )->second.Time;
-            animCurve.TimeMinMaxTotal.y = animCurve.Keys.crbegin( )->second.Time;
+            animCurve.TimeMinMaxTotal.x = simplifiedAnimCurveKeys.front( ).Time;
+            animCurve.TimeMinMaxTotal.y = simplifiedAnimCurveKeys.back( ).Time;
             animCurve.TimeMinMaxTotal.z = animCurve.TimeMinMaxTotal.y - animCurve.TimeMinMaxTotal.x;
 
-            LogInfo( "\tStart: {} -> End: {} (Duration: {})",
+            LogInfo( "\tStart: {} -> End: {} (Duration: {}), keys: {} -> {}",
                      animCurve.TimeMinMaxTotal.x,
                      animCurve.TimeMinMaxTotal.y,
-                     animCurve.TimeMinMaxTotal.z );
+                     animCurve.TimeMinMaxTotal.z,
+                     animCurveKeyCount,
+                     simplifiedAnimCurveKeys.size( ) );
         }
 
+        const size_t keptKeyCount = pScene->AnimCurveKeys.Times.size( );
+        const size_t keySize      = 5 * sizeof( float ); /* Time, Value, Bez1, Bez2, Bez3 */
+        LogInfo( "Curve keys: {} -> {} (saved {} bytes), constant curves: {} / {}",
+                 decodedKeyCount,
+                 keptKeyCount,
+                 ( decodedKeyCount - keptKeyCount ) * keySize,
+                 constAnimCurveCount,
+                 pScene->AnimCurves.size( ) );
+
+        // The keys are copied to the scene arrays.
+        apemode::vector< DecodedAnimCurveKeys >( ).swap( decodedAnimCurveKeys );
+
 
         pScene->AnimNodeIdToAnimCurveIds.reserve( pAnimCurvesFb->size( ) );
         for ( auto &node : pScene->Nodes ) {
@@ -840,6 +3182,75 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
             }
         }
 
+        // Compile the bindings of the layers.
+        size_t foldedTrackCount = 0;
+        // The composite IDs are sorted by the node ID within the layer, and so are the nodes and the tracks of the layers.
+        for ( const auto &animNodeIdAnimCurveIds : pScene->AnimNodeIdToAnimCurveIds ) {
+            SceneAnimNodeId animNodeId;
+            animNodeId.AnimNodeCompositeId = animNodeIdAnimCurveIds.first;
+
+            SceneAnimLayer &animLayer = pScene->AnimLayers[ animNodeId.AnimLayerId.AnimLayerCompositeId ];
+            animLayer.AnimStackIndex  = animNodeId.AnimLayerId.AnimStackIndex;
+            animLayer.AnimLayerIndex  = animNodeId.AnimLayerId.AnimLayerIndex;
+
+            const size_t       trackCount     = animLayer.TrackNodeIds.size( );
+            SceneNodeTransform restProperties = pScene->BindPoseFrame.Properties[ animNodeId.NodeId ];
+
+            const SceneNodeAnimCurveIds &animCurveIds = animNodeIdAnimCurveIds.second;
+            for ( uint32_t propertyChannelIndex = 0; propertyChannelIndex < SceneAnimCurve::ePropertyCount; ++propertyChannelIndex ) {
+                const uint32_t animCurveId = animCurveIds.AnimCurveIds[ propertyChannelIndex ];
+                if ( animCurveId == detail::kInvalidId ) {
+                    continue;
+                }
+
+                const SceneAnimCurve::EProperty eProperty = pScene->AnimCurves[ animCurveId ].eProperty;
+                assert( uint32_t( eProperty ) + pScene->AnimCurves[ animCurveId ].eChannel == propertyChannelIndex );
+
+                switch ( eProperty ) {
+                    case SceneAnimCurve::eProperty_PreRotation:
+                    case SceneAnimCurve::eProperty_PostRotation:
+                    case SceneAnimCurve::eProperty_ScalingPivot:
+                    case SceneAnimCurve::eProperty_ScalingOffset:
+                    case SceneAnimCurve::eProperty_RotationPivot:
+                    case SceneAnimCurve::eProperty_RotationOffset:
+                    case SceneAnimCurve::eProperty_GeometricScaling:
+                    case SceneAnimCurve::eProperty_GeometricRotation:
+                    case SceneAnimCurve::eProperty_GeometricTranslation: {
+                        LogWarn("Animating an object-offset property: {}, node: {}",
+                                apemodefb::EnumNameEAnimCurvePropertyFb(
+                                apemodefb::EAnimCurvePropertyFb(eProperty / SceneAnimCurve::eChannelCount)),
+                                pScene->Nodes[ animNodeId.NodeId ].pszName );
+                    } break;
+                    default:
+                        break;
+                }
+
+                // The constant curve (single key) is folded into the rest properties, it is not evaluated.
+                const SceneAnimCurve &animCurve   = pScene->AnimCurves[ animCurveId ];
+                const float           valueFactor = IsRotationProperty( eProperty ) ? toRadsFactor : 1.0f;
+                if ( animCurve.KeyCount == 1 ) {
+                    *MapPropertyChannel( propertyChannelIndex, &restProperties ) = pScene->AnimCurveKeys.Values[ animCurve.BaseKey ] * valueFactor;
+                    ++foldedTrackCount;
+                    continue;
+                }
+
+                animLayer.TrackNodeIds.push_back( animNodeId.NodeId );
+                animLayer.TrackAnimCurveIds.push_back( animCurveId );
+                animLayer.TrackPropertyChannels.push_back( static_cast< uint8_t >( propertyChannelIndex ) );
+                animLayer.TrackValueFactors.push_back( valueFactor );
+            }
+
+            if ( animLayer.TrackNodeIds.size( ) != trackCount ) {
+                animLayer.NodeIds.push_back( animNodeId.NodeId );
+                animLayer.NodeRestProperties.push_back( restProperties );
+            } else {
+                animLayer.ConstNodeIds.push_back( animNodeId.NodeId );
+                animLayer.ConstNodeProperties.push_back( restProperties );
+            }
+        }
+
+        LogInfo( "Constant tracks folded into the rest poses: {}", foldedTrackCount );
+
         for ( auto pAnimLayerFb : *pAnimLayersFb ) {
             auto pAnimStackFb = pAnimStacksFb->Get( pAnimLayerFb->anim_stack_id( ) );
 
@@ -852,116 +3263,55 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
             SceneAnimLayerId animLayerId;
             animLayerId.AnimLayerIndex = pAnimLayerFb->anim_stack_idx( );
             animLayerId.AnimStackIndex = pAnimLayerFb->anim_stack_id( );
-        }
-    }
-
-    if ( IsNotNullAndNotEmpty( pMeshesFb ) ) {
-        { /* All the subsets are stored in Scene instance, and can be referenced
-           * by the BaseSubset and SubsetCount values in SceneMeshSubset struct.
-           */
 
-            size_t totalSubsetCount = 0;
-            for ( uint32_t meshId = 0; meshId < pMeshesFb->size( ); ++meshId ) {
-                auto pMeshFb = pMeshesFb->Get( meshId );
-                totalSubsetCount += pMeshFb->subsets( ) ? pMeshFb->subsets( )->size( ) : 0;
+            const auto animLayerIt = pScene->AnimLayers.find( animLayerId.AnimLayerCompositeId );
+            if ( animLayerIt != pScene->AnimLayers.end( ) ) {
+                LogInfo( "\tAnimated nodes: {}, constant nodes: {}, tracks: {}",
+                         animLayerIt->second.NodeIds.size( ),
+                         animLayerIt->second.ConstNodeIds.size( ),
+                         animLayerIt->second.TrackAnimCurveIds.size( ) );
             }
-
-            pScene->Subsets.reserve( totalSubsetCount );
-        }
-
-        pScene->Meshes.reserve( pMeshesFb->size( ) );
-        for ( uint32_t meshId = 0; meshId < pMeshesFb->size( ); ++meshId ) {
-            auto pMeshFb = pMeshesFb->Get( meshId );
-
-            assert( pMeshFb );
-            assert( IsNotNullAndNotEmpty( pMeshFb->vertices( ) ) );
-            // assert( IsNotNullAndNotEmpty( pMeshFb->indices( ) ) );
-            assert( IsNotNullAndNotEmpty( pMeshFb->subsets( ) ) );
-            assert( IsNotNullAndNotEmpty( pMeshFb->submeshes( ) ) );
-
-            // std::array<apemode::detail::SkinnedVertex, 128> sv;
-            // memcpy(sv.data(), pMeshFb->vertices(), std::min<size_t>(sizeof(sv), pMeshFb->vertices()->size()));
-
-            pScene->Meshes.emplace_back( );
-            auto &mesh = pScene->Meshes.back( );
-
-            mesh.SubsetCount = static_cast< uint32_t >( pMeshFb->subsets( )->size( ) );
-            mesh.BaseSubset  = static_cast< uint32_t >( pScene->Subsets.size( ) );
-            mesh.eVertexType = detail::eVertexType_Custom;
-
-//            auto pSubmeshesFb = pMeshFb->submeshes( );
-//            auto pSubmeshFb   = pSubmeshesFb->Get( 0 );
-//            switch ( pSubmeshFb->vertex_format( ) ) {
-//                case apemodefb::EVertexFormatFb_Default:
-//                    mesh.eVertexType = detail::eVertexType_Default;
-//                    break;
-//                case apemodefb::EVertexFormatFb_Skinned:
-//                    mesh.eVertexType = detail::eVertexType_Skinned;
-//                    break;
-//                case apemodefb::EVertexFormatFb_FatSkinned:
-//                    mesh.eVertexType = detail::eVertexType_FatSkinned;
-//                    break;
-//                default:
-//                    break;
-//            }
-
-            std::transform( pMeshFb->subsets( )->begin( ),
-                            pMeshFb->subsets( )->end( ),
-                            std::back_inserter( pScene->Subsets ),
-                            [&]( const apemodefb::SubsetFb *pSubsetFb ) {
-
-                                SceneMeshSubset subset;
-                                subset.MeshId     = mesh.Id;
-                                subset.MaterialId = pSubsetFb->material_id( );
-                                subset.BaseIndex  = pSubsetFb->base_index( );
-                                subset.IndexCount = pSubsetFb->index_count( );
-
-                                return subset;
-                            } );
-
-            mesh.Id     = meshId;
-            mesh.SkinId = pMeshFb->skin_id( );
         }
     }
 
-    if ( IsNotNullAndNotEmpty( pSkinsFb ) ) {
-        pScene->Skins.resize( pSkinsFb->size() );
-
-        for ( auto &mesh : pScene->Meshes ) {
-            if ( mesh.SkinId != detail::kInvalidId ) {
-                auto &skin = pScene->Skins[ mesh.SkinId ];
-                skin.Id = mesh.SkinId;
+    phaseTimes.AnimCurves = GetElapsedMilliseconds( phaseStopwatch );
+    phaseStopwatch.Start( );
 
-                auto pSkinFb          = pSkinsFb->Get( mesh.SkinId );
-                auto pInvBindMatrices = pSkinFb->inv_bind_pose_matrices( );
-
-                if ( skin.LinkIds.empty( ) && pSkinFb ) {
+    // The curves are loaded, the transform shapes can account for the animated properties.
+    ClassifyNodeTransforms( *pScene );
+    BakeStaticNodeTransforms( *pScene );
 
-                    auto pLinkIdsFb = pSkinFb->links_ids( );
-                    if ( IsNotNullAndNotEmpty( pLinkIdsFb ) ) {
+    phaseTimes.NodeTransforms = GetElapsedMilliseconds( phaseStopwatch );
+    phaseStopwatch.Start( );
 
-                        LogInfo( "Processing skin: \"{}\", links {}",
-                                 GetCStringProperty( pSrcScene, pSkinFb->name_id( ) ),
-                                 pLinkIdsFb->size( ) );
+    // The meshes and the skins are loaded, the nodes that affect none of them are not updated per frame.
+    if ( !options.bKeepNonContributingNodes ) {
+        PruneNonContributingNodes( *pScene );
+        PartitionNodeHierarchy( *pScene );
+    }
 
-                        skin.LinkIds.reserve( pLinkIdsFb->size( ) );
-                        skin.InvBindPoseMatrices.reserve( pLinkIdsFb->size( ) );
+    // The geometric transforms are classified and the nodes are pruned, the stored hierarchical matrices are reassigned.
+    if ( !pScene->OrderedNodeIds.empty( ) ) {
+        AssignHierarchicalMatrixIds( *pScene );
+        pScene->BindPoseFrame.SetAllDirty( );
+        pScene->UpdateTransformMatrices( pScene->BindPoseFrame );
+    }
 
-                        for ( uint32_t linkIndex = 0; linkIndex < pLinkIdsFb->size( ); ++linkIndex ) {
-                            auto linkNodeId = pLinkIdsFb->Get( linkIndex );
-                            LogInfo( "\t+ link {} \"{}\"", linkNodeId, pScene->Nodes[ linkNodeId ].pszName );
+    phaseTimes.NodePruning = GetElapsedMilliseconds( phaseStopwatch );
+    phaseStopwatch.Start( );
 
-                            const XMFLOAT4X4 *invBindPoseMatrixFb = (const XMFLOAT4X4 *) pInvBindMatrices->Get( linkIndex );
-                            XMMATRIX invBindPoseMatrix = XMLoadFloat4x4( invBindPoseMatrixFb );
-                            skin.LinkIds.push_back( linkNodeId );
-                            skin.InvBindPoseMatrices.push_back( invBindPoseMatrix );
-                        }
-                    }
-                }
-            }
+    // The pruned tracks are not resampled.
+    if ( options.bQuantizeAnimTracks ) {
+        for ( auto &animLayerPair : pScene->AnimLayers ) {
+            QuantizeAnimLayerTracks( *pScene, animLayerPair.second, options.AnimTrackSampleRate, options.AnimTrackErrorBudget );
         }
+
+        ReleaseQuantizedAnimCurveKeys( *pScene );
     }
 
+    phaseTimes.TrackQuantization = GetElapsedMilliseconds( phaseStopwatch );
+    phaseStopwatch.Start( );
+
     auto pTexturesFb = pSrcScene->textures( );
     auto pFilesFb    = pSrcScene->files( );
 
@@ -1034,84 +3384,365 @@ apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > && fi
         }         /* pMaterialFb */
     }             /* pMaterialsFb */
 
+    phaseTimes.Materials = GetElapsedMilliseconds( phaseStopwatch );
+    phaseTimes.Total     = GetElapsedMilliseconds( totalStopwatch );
+
+    LogInfo( "Scene loading phases ({}): total {:.2f} ms", pDefaultTaskflow ? "parallel" : "serial", phaseTimes.Total );
+    LogInfo( "\tVerification: {:.2f} ms", phaseTimes.Verification );
+    LogInfo( "\tTasks: {:.2f} ms (nodes {:.2f} ms, meshes {:.2f} ms, skins {:.2f} ms, curves {:.2f} ms in {} tasks)",
+             phaseTimes.Tasks,
+             phaseTimes.Nodes,
+             phaseTimes.Meshes,
+             phaseTimes.Skins,
+             phaseTimes.AnimCurveDecoding,
+             animCurveCount );
+    LogInfo( "\tNode hierarchy: {:.2f} ms", phaseTimes.NodeHierarchy );
+    LogInfo( "\tCurves and layers: {:.2f} ms", phaseTimes.AnimCurves );
+    LogInfo( "\tNode transforms: {:.2f} ms", phaseTimes.NodeTransforms );
+    LogInfo( "\tNode pruning: {:.2f} ms", phaseTimes.NodePruning );
+    LogInfo( "\tTrack quantization: {:.2f} ms", phaseTimes.TrackQuantization );
+    LogInfo( "\tMaterials: {:.2f} ms", phaseTimes.Materials );
+
     detail::ScenePrintPretty prettyPrint;
     prettyPrint.PrintPretty( pScene.get( ) );
-    return LoadedScene{std::move( fileContents ), pSrcScene, std::move( pScene )};
+
+    apemode::LoadedScene loadedScene;
+    loadedScene.pSrcScene = pSrcScene;
+    loadedScene.pScene    = std::move( pScene );
+    return loadedScene;
+}
+
+} // namespace
+
+apemode::LoadedScene apemode::LoadSceneFromBin( apemode::vector< uint8_t > &&fileContents, const SceneLoadOptions &options ) {
+    // The buffer is moved, the data pointer stays the same.
+    LoadedScene loadedScene = LoadSceneFromBuffer( fileContents.data( ), fileContents.size( ), options );
+    if ( loadedScene.pScene ) {
+        loadedScene.FileContents = std::move( fileContents );
+    }
+
+    return loadedScene;
+}
+
+apemode::LoadedScene apemode::LoadSceneFromMappedBin( apemode::unique_ptr< platform::IMappedContent > &&pMappedContents,
+                                                      const SceneLoadOptions &                         options ) {
+    if ( !pMappedContents ) {
+        LogError( "Failed to map the scene file." );
+        return LoadedScene{};
+    }
+
+    LoadedScene loadedScene = LoadSceneFromBuffer( pMappedContents->GetData( ), pMappedContents->GetSize( ), options );
+    if ( loadedScene.pScene ) {
+        loadedScene.pMappedContents = std::move( pMappedContents );
+    }
+
+    return loadedScene;
+}
+
+void apemode::DiscardUploadedPayloads( const LoadedScene &loadedScene ) {
+    if ( !loadedScene.pMappedContents || !loadedScene.pSrcScene ) {
+        return;
+    }
+
+    const platform::IMappedContent &mappedContents = *loadedScene.pMappedContents;
+    size_t                          discardedSize  = 0;
+
+    auto discardFn = [&]( const flatbuffers::Vector< uint8_t > *pPayloadFb ) {
+        if ( pPayloadFb && pPayloadFb->size( ) ) {
+            mappedContents.Discard( pPayloadFb->data( ), pPayloadFb->size( ) );
+            discardedSize += pPayloadFb->size( );
+        }
+    };
+
+    if ( auto pMeshesFb = loadedScene.pSrcScene->meshes( ) ) {
+        for ( auto pMeshFb : *pMeshesFb ) {
+            discardFn( pMeshFb->vertices( ) );
+            discardFn( pMeshFb->indices( ) );
+        }
+    }
+
+    if ( auto pFilesFb = loadedScene.pSrcScene->files( ) ) {
+        for ( auto pFileFb : *pFilesFb ) {
+            discardFn( pFileFb->buffer( ) );
+        }
+    }
+
+    LogInfo( "Discarded uploaded payloads: {} of {} bytes", discardedSize, mappedContents.GetSize( ) );
+}
+
+void apemode::SceneAnimCurveKeys::Reserve( const size_t keyCount ) {
+    Times.reserve( keyCount );
+    Values.reserve( keyCount );
+    Bez1.reserve( keyCount );
+    Bez2.reserve( keyCount );
+    Bez3.reserve( keyCount );
+}
+
+uint32_t apemode::SceneAnimCurveKeys::Append( const SceneAnimCurveKey *pKeys, const uint32_t keyCount ) {
+    assert( pKeys && keyCount );
+
+    const uint32_t baseKey = static_cast< uint32_t >( Times.size( ) );
+    Reserve( Times.size( ) + keyCount );
+
+    for ( uint32_t i = 0; i < keyCount; ++i ) {
+        const SceneAnimCurveKey &a = pKeys[ i ];
+        assert( i == 0 || pKeys[ i - 1 ].Time < a.Time );
+
+        Times.push_back( a.Time );
+        Values.push_back( a.Value );
+
+        if ( ( i + 1 ) == keyCount ) {
+            // Case: the last key, its segment is never interpolated.
+            Bez1.push_back( a.Value );
+            Bez2.push_back( a.Value );
+            Bez3.push_back( a.Value );
+            continue;
+        }
+
+        const SceneAnimCurveKey &b = pKeys[ i + 1 ];
+        switch ( a.eInterpMode ) {
+            case SceneAnimCurveKey::eInterpolationMode_Const:
+                Bez1.push_back( a.Value );
+                Bez2.push_back( a.Value );
+                Bez3.push_back( a.Value );
+                break;
+
+            case SceneAnimCurveKey::eInterpolationMode_Linear: {
+                // Evenly placed control points make the cubic Bezier curve linear.
+                const float delta = b.Value - a.Value;
+                Bez1.push_back( a.Value + delta / 3.0f );
+                Bez2.push_back( a.Value + delta * 2.0f / 3.0f );
+                Bez3.push_back( b.Value );
+            } break;
+
+            default:
+                Bez1.push_back( a.Bez1 );
+                Bez2.push_back( a.Bez2 );
+                Bez3.push_back( b.PrevBez3( ) );
+                break;
+        }
+    }
+
+    return baseKey;
 }
 
-void apemode::SceneAnimCurve::GetKeyIndices( float & time, uint32_t &i, uint32_t &j ) const {
+void apemode::SceneAnimCurve::GetSegment( const SceneAnimCurveKeys &keys,
+                                          const float               time,
+                                          uint32_t &                keyIndex,
+                                          float &                   t,
+                                          uint32_t *                pSegmentHint ) const {
+    assert( !IsQuantized( ) && "The keys are released, evaluate the curve with Scene::CalculateAnimCurves." );
+    assert( KeyCount && ( BaseKey + KeyCount ) <= keys.Times.size( ) );
+    t = 0.0f;
 
     if ( apemode::IsNearlyEqualOrLess( time, TimeMinMaxTotal.x ) ) {
         // Case: before the curve's first key, or on it.
-        i = 0;
-        j = 0;
+        keyIndex = BaseKey;
+        if ( pSegmentHint ) {
+            *pSegmentHint = 0;
+        }
     } else if ( apemode::IsNearlyEqualOrGreater( time, TimeMinMaxTotal.y ) ) {
         // Case: after the curve's last key, or on it.
-        i = static_cast< uint32_t >( Keys.size( ) ) - 1;
-        j = i;
+        keyIndex = BaseKey + KeyCount - 1;
     } else {
         // Case: inside the curve's timeline.
-        auto matchOrUpperBoundIt = Keys.lower_bound( time );
-        assert( matchOrUpperBoundIt != Keys.end( ) );
+        const float *pTimes = keys.Times.data( ) + BaseKey;
 
-        if ( apemode::IsNearlyEqual( matchOrUpperBoundIt->second.Time, time ) ) {
-            // Case: exactly on curve's key.
-            i = static_cast< uint32_t >( eastl::distance( Keys.cbegin( ), matchOrUpperBoundIt ) );
-            j = i;
+        // The playback time mostly moves forward by less than a segment per frame,
+        // so the cached segment or a couple of the next ones are checked before searching.
+        constexpr uint32_t kMaxSegmentHintSteps = 4;
+
+        uint32_t segmentIndex = pSegmentHint ? *pSegmentHint : KeyCount;
+        if ( segmentIndex < KeyCount && pTimes[ segmentIndex ] <= time ) {
+            const uint32_t segmentIndexEnd = eastl::min( segmentIndex + kMaxSegmentHintSteps, KeyCount - 1 );
+            while ( segmentIndex < segmentIndexEnd && pTimes[ segmentIndex + 1 ] <= time ) {
+                ++segmentIndex;
+            }
+
+            if ( segmentIndex == segmentIndexEnd ) {
+                segmentIndex = KeyCount;
+            }
         } else {
-            const auto lowerBoundIt = eastl::prev( matchOrUpperBoundIt );
-            const auto upperBoundIt = matchOrUpperBoundIt;
-            assert( lowerBoundIt != Keys.end( ) );
+            segmentIndex = KeyCount;
+        }
+
+        if ( segmentIndex == KeyCount ) {
+            // Case: no hint, seek or loop, the upper bound is the key that ends the segment.
+            const float *pUpperBound = eastl::upper_bound( pTimes + 1, pTimes + KeyCount, time );
+            assert( pUpperBound != ( pTimes + KeyCount ) );
+            segmentIndex = static_cast< uint32_t >( eastl::distance( pTimes, pUpperBound ) ) - 1;
+        }
+
+        if ( pSegmentHint ) {
+            *pSegmentHint = segmentIndex;
+        }
+
+        keyIndex = BaseKey + segmentIndex;
+
+        const float segmentStartTime = pTimes[ segmentIndex ];
+        const float segmentEndTime   = pTimes[ segmentIndex + 1 ];
 
+        if ( apemode::IsNearlyEqual( segmentEndTime, time ) ) {
+            // Case: exactly on curve's key.
+            ++keyIndex;
+        } else if ( !apemode::IsNearlyEqual( segmentStartTime, time ) ) {
             // Case: inside the curve's segment.
-            i = static_cast< uint32_t >( eastl::distance( Keys.cbegin( ), lowerBoundIt ) );
-            j = static_cast< uint32_t >( eastl::distance( Keys.cbegin( ), upperBoundIt ) );
+            t = ( time - segmentStartTime ) / ( segmentEndTime - segmentStartTime );
         }
     }
 }
 
-float CubicInterp( const float P0, const float P1, const float P2, const float P3, const float t ) {
-#define SQUARED( x ) ( ( x ) * ( x ) )
-#define CUBED( x ) ( ( x ) * ( x ) * ( x ) )
-    return CUBED( 1 - t ) * P0 + 3 * SQUARED( 1 - t ) * t * P1 + 3 * ( 1 - t ) * SQUARED( t ) * P2 + CUBED( t ) * P3;
-#undef SQUARED
-#undef CUBED
+float apemode::SceneAnimCurve::Calculate( const SceneAnimCurveKeys &keys, const float time, SceneAnimCursor *pCursor ) const {
+    assert( !pCursor || Id < pCursor->SegmentKeyIndices.size( ) );
+
+    uint32_t keyIndex;
+    float    t;
+    GetSegment( keys, time, keyIndex, t, pCursor ? &pCursor->SegmentKeyIndices[ Id ] : nullptr );
+
+    const float interpolatedValue = keys.Interpolate( keyIndex, t );
+    assert( !isnan( interpolatedValue ) );
+    return interpolatedValue;
 }
 
-float InterpolateValue( const float time, const SceneAnimCurveKey& a, const SceneAnimCurveKey& b ) {
-    switch ( a.eInterpMode ) {
-        case apemode::SceneAnimCurveKey::eInterpolationMode_Const:
-            return a.Value;
+namespace {
 
-        case apemode::SceneAnimCurveKey::eInterpolationMode_Linear: {
-            const float l = ( time - a.Time ) / ( b.Time - a.Time );
-            const float t = ( b.Value - a.Value ) * l + a.Value;
-            return t;
+/* AnimCurveSegmentBatch class stores the gathered segments of the curves,
+ * so that they can be loaded to SIMD registers and interpolated at once.
+ */
+template < uint32_t TBatchSize >
+struct AnimCurveSegmentBatch {
+    alignas( 16 ) float T[ TBatchSize ];
+    alignas( 16 ) float P0[ TBatchSize ];
+    alignas( 16 ) float P1[ TBatchSize ];
+    alignas( 16 ) float P2[ TBatchSize ];
+    alignas( 16 ) float P3[ TBatchSize ];
+
+    void Gather( const apemode::Scene &scene, const uint32_t *pAnimCurveIds, const float time, apemode::SceneAnimCursor *pAnimCursor ) {
+        const apemode::SceneAnimCurveKeys &keys = scene.AnimCurveKeys;
+
+        for ( uint32_t i = 0; i < TBatchSize; ++i ) {
+            uint32_t  keyIndex;
+            uint32_t *pSegmentHint = pAnimCursor ? &pAnimCursor->SegmentKeyIndices[ pAnimCurveIds[ i ] ] : nullptr;
+            scene.AnimCurves[ pAnimCurveIds[ i ] ].GetSegment( keys, time, keyIndex, T[ i ], pSegmentHint );
+
+            P0[ i ] = keys.Values[ keyIndex ];
+            P1[ i ] = keys.Bez1[ keyIndex ];
+            P2[ i ] = keys.Bez2[ keyIndex ];
+            P3[ i ] = keys.Bez3[ keyIndex ];
         }
+    }
 
-        default: {
-            const float l = ( time - a.Time ) / ( b.Time - a.Time );
-            const float t = CubicInterp( a.Bez0( ), a.Bez1, a.Bez2, b.PrevBez3( ), l );
-            return t;
+    /* Gathers the segments of the animation curve for the time values of the instances.
+     */
+    void Gather( const apemode::Scene &            scene,
+                 const uint32_t                    animCurveId,
+                 const float *                     pTimes,
+                 apemode::SceneAnimCursor *const * ppAnimCursors ) {
+        const apemode::SceneAnimCurveKeys &keys      = scene.AnimCurveKeys;
+        const apemode::SceneAnimCurve &    animCurve = scene.AnimCurves[ animCurveId ];
+
+        for ( uint32_t i = 0; i < TBatchSize; ++i ) {
+            uint32_t  keyIndex;
+            uint32_t *pSegmentHint = ppAnimCursors ? &ppAnimCursors[ i ]->SegmentKeyIndices[ animCurveId ] : nullptr;
+            animCurve.GetSegment( keys, pTimes[ i ], keyIndex, T[ i ], pSegmentHint );
+
+            P0[ i ] = keys.Values[ keyIndex ];
+            P1[ i ] = keys.Bez1[ keyIndex ];
+            P2[ i ] = keys.Bez2[ keyIndex ];
+            P3[ i ] = keys.Bez3[ keyIndex ];
         }
     }
+};
+
+void InterpolateAnimCurveSegments4( const AnimCurveSegmentBatch< 4 > &batch, float *pOutValues ) {
+    const XMVECTOR t  = XMLoadFloat4( reinterpret_cast< const XMFLOAT4 * >( batch.T ) );
+    const XMVECTOR u  = XMVectorSubtract( XMVectorSplatOne( ), t );
+    const XMVECTOR uu = XMVectorMultiply( u, u );
+    const XMVECTOR tt = XMVectorMultiply( t, t );
+    const XMVECTOR k3 = XMVectorReplicate( 3.0f );
+
+    XMVECTOR value = XMVectorMultiply( XMVectorMultiply( uu, u ), XMLoadFloat4( reinterpret_cast< const XMFLOAT4 * >( batch.P0 ) ) );
+    value = XMVectorMultiplyAdd( XMVectorMultiply( XMVectorMultiply( k3, uu ), t ), XMLoadFloat4( reinterpret_cast< const XMFLOAT4 * >( batch.P1 ) ), value );
+    value = XMVectorMultiplyAdd( XMVectorMultiply( XMVectorMultiply( k3, u ), tt ), XMLoadFloat4( reinterpret_cast< const XMFLOAT4 * >( batch.P2 ) ), value );
+    value = XMVectorMultiplyAdd( XMVectorMultiply( tt, t ), XMLoadFloat4( reinterpret_cast< const XMFLOAT4 * >( batch.P3 ) ), value );
+
+    XMStoreFloat4( reinterpret_cast< XMFLOAT4 * >( pOutValues ), value );
 }
 
-float apemode::SceneAnimCurve::Calculate( float time ) const {
+/* Returns the value of the quantized curve (without the track value factor) from the quantized track of its layer.
+ */
+float CalculateQuantizedAnimCurve( const apemode::Scene &scene, const SceneAnimCurve &animCurve, const float time ) {
+    assert( animCurve.IsQuantized( ) );
 
-    uint32_t i, j;
-    GetKeyIndices( time, i, j );
+    const SceneAnimLayer *pAnimLayer = scene.GetAnimLayer( animCurve.AnimStackIndex, animCurve.AnimLayerIndex );
+    assert( pAnimLayer && pAnimLayer->QuantizedTracks.SampleCount && animCurve.QuantizedTrackIndex < pAnimLayer->TrackAnimCurveIds.size( ) );
 
-    if ( i == j ) {
-        const SceneAnimCurveKey a = Keys.at( i ).second;
-        return a.Value;
-    } else {
-        const SceneAnimCurveKey a = Keys.at( i ).second;
-        const SceneAnimCurveKey b = Keys.at( j ).second;
+    float value;
+    CalculateAnimLayerTracks( scene, *pAnimLayer, &animCurve.QuantizedTrackIndex, 1, time, &value, nullptr );
+    return value / pAnimLayer->TrackValueFactors[ animCurve.QuantizedTrackIndex ];
+}
+
+} // namespace
+
+void apemode::Scene::CalculateAnimCurves( const uint32_t *pAnimCurveIds,
+                                          const size_t    animCurveCount,
+                                          const float     time,
+                                          float *         pOutValues,
+                                          SceneAnimCursor *pAnimCursor ) const {
+    assert( !animCurveCount || ( pAnimCurveIds && pOutValues ) );
+    assert( !pAnimCursor || pAnimCursor->SegmentKeyIndices.size( ) == AnimCurves.size( ) );
+
+    // The keys of the quantized curves are released, the batches are not gathered.
+    for ( size_t j = 0; j < animCurveCount; ++j ) {
+        if ( AnimCurves[ pAnimCurveIds[ j ] ].IsQuantized( ) ) {
+            for ( size_t k = 0; k < animCurveCount; ++k ) {
+                const SceneAnimCurve &animCurve = AnimCurves[ pAnimCurveIds[ k ] ];
+                pOutValues[ k ] = animCurve.IsQuantized( ) ? CalculateQuantizedAnimCurve( *this, animCurve, time )
+                                                           : animCurve.Calculate( AnimCurveKeys, time, pAnimCursor );
+            }
+
+            return;
+        }
+    }
+
+    size_t i = 0;
+
+    for ( AnimCurveSegmentBatch< 4 > batch; ( i + 4 ) <= animCurveCount; i += 4 ) {
+        batch.Gather( *this, pAnimCurveIds + i, time, pAnimCursor );
+        InterpolateAnimCurveSegments4( batch, pOutValues + i );
+    }
+
+    for ( ; i < animCurveCount; ++i ) {
+        pOutValues[ i ] = AnimCurves[ pAnimCurveIds[ i ] ].Calculate( AnimCurveKeys, time, pAnimCursor );
+    }
+}
+
+void apemode::Scene::CalculateAnimCurveInstances( const uint32_t          animCurveId,
+                                                  const float *           pTimes,
+                                                  const size_t            instanceCount,
+                                                  float *                 pOutValues,
+                                                  SceneAnimCursor *const *ppAnimCursors ) const {
+    assert( animCurveId < AnimCurves.size( ) );
+    assert( !instanceCount || ( pTimes && pOutValues ) );
+
+    // The keys of the quantized curve are released, the instances are evaluated from the quantized track.
+    if ( AnimCurves[ animCurveId ].IsQuantized( ) ) {
+        for ( size_t j = 0; j < instanceCount; ++j ) {
+            pOutValues[ j ] = CalculateQuantizedAnimCurve( *this, AnimCurves[ animCurveId ], pTimes[ j ] );
+        }
+
+        return;
+    }
+
+    size_t i = 0;
+
+    for ( AnimCurveSegmentBatch< 4 > batch; ( i + 4 ) <= instanceCount; i += 4 ) {
+        batch.Gather( *this, animCurveId, pTimes + i, ppAnimCursors ? ppAnimCursors + i : nullptr );
+        InterpolateAnimCurveSegments4( batch, pOutValues + i );
+    }
 
-        const float interpolatedValue = InterpolateValue( time, a, b );
-        assert( !isnan( interpolatedValue) );
-        return interpolatedValue;
+    for ( ; i < instanceCount; ++i ) {
+        pOutValues[ i ] = AnimCurves[ animCurveId ].Calculate( AnimCurveKeys, pTimes[ i ], ppAnimCursors ? ppAnimCursors[ i ] : nullptr );
     }
 }
 
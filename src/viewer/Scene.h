@@ -4,6 +4,7 @@
 #include <flatbuffers/util.h>
 #include <scene_generated.h>
 
+#include <apemode/platform/IAssetManager.h>
 #include <apemode/platform/MathInc.h>
 #include <apemode/platform/memory/MemoryManager.h>
 
@@ -59,7 +60,18 @@ enum ERotationOrder {
     eRotationOrder_EulerYXZ,
     eRotationOrder_EulerZXY,
     eRotationOrder_EulerZYX,
-    eRotationOrder_EulerSphericXYZ
+    eRotationOrder_EulerSphericXYZ,
+    eRotationOrderCount
+};
+
+/* Transform shapes, the local matrices are calculated with the specialized kernels.
+ * The shapes are assigned on load, the properties that are not part of the shape are zero and never animated.
+ */
+enum ETransformShape {
+    eTransformShape_TRS = 0,       /* Scaling, rotation and translation. */
+    eTransformShape_TRSPreRotated, /* Scaling, rotation, pre-rotation and translation. */
+    eTransformShape_Full,          /* Pivots, offsets, pre- and post-rotation. */
+    eTransformShapeCount
 };
 
 /* Default vertex structure.
@@ -219,9 +231,15 @@ struct SceneNodeTransform {
      * @return Node geometric transform.
      */
     XMMATRIX CalculateGeometricMatrix( const detail::ERotationOrder eOrder ) const;
+
+    /* Calculate local transform with the kernel specialized for the transform shape.
+     * @return Node local transform (same as CalculateLocalMatrix).
+     */
+    XMMATRIX CalculateLocalMatrix( const detail::ETransformShape eShape, const detail::ERotationOrder eOrder ) const;
 };
 
 /* SceneAnimCurvKey class stores time, value, and cubic tangents (cu).
+ * Used for decoding the keys, the scene stores them in SceneAnimCurveKeys.
  */
 struct SceneAnimCurveKey {
     enum EInterpolationMode {
@@ -246,7 +264,52 @@ struct SceneAnimCurveKey {
     }
 };
 
-/* SceneAnimCurve class stores curve parameters and time-value keys.
+/* SceneAnimCurveKeys class stores the keys of all the scene animation curves in flat arrays.
+ * Each key starts a segment that is stored as a cubic Bezier curve (Value, Bez1, Bez2, Bez3),
+ * constant and linear segments are converted to it on load, so that all the keys are interpolated the same way.
+ * The curves reference their keys by BaseKey and KeyCount values.
+ */
+struct SceneAnimCurveKeys {
+    apemode::vector< float > Times;
+    apemode::vector< float > Values;
+    apemode::vector< float > Bez1;
+    apemode::vector< float > Bez2;
+    apemode::vector< float > Bez3;
+
+    /* Reserves the memory for the given total key count.
+     */
+    void Reserve( size_t keyCount );
+
+    /* Appends the keys (must be sorted by time), returns the index of the first appended key.
+     */
+    uint32_t Append( const SceneAnimCurveKey *pKeys, uint32_t keyCount );
+
+    /* Returns interpolated segment value, the interpolation factor is expected to be in [0, 1] range.
+     */
+    inline float Interpolate( const uint32_t keyIndex, const float t ) const {
+        const float u = 1.0f - t;
+        return u * u * u * Values[ keyIndex ] + 3.0f * u * u * t * Bez1[ keyIndex ] + 3.0f * u * t * t * Bez2[ keyIndex ] +
+               t * t * t * Bez3[ keyIndex ];
+    }
+};
+
+/* SceneAnimCursor class stores the last evaluated segment of each animation curve (indexed by curve ID).
+ * Monotonic playback continues from the cached segments instead of searching for them every frame.
+ * Each animated instance is expected to own its cursor.
+ */
+struct SceneAnimCursor {
+    apemode::vector< uint32_t > SegmentKeyIndices;
+};
+
+/* SceneAnimInstanceScratch class contains the temporary storage of Scene::UpdateTransformPropertiesInstanced.
+ * The storage is reused across the updates, so that the batched update does not allocate per call.
+ */
+struct SceneAnimInstanceScratch {
+    apemode::vector< float > TempTimes;  /* Time value for each instance (looped). */
+    apemode::vector< float > TempValues; /* Track value for each instance. */
+};
+
+/* SceneAnimCurve class stores curve parameters and references its time-value keys.
  */
 struct SceneAnimCurve {
 
@@ -281,25 +344,35 @@ struct SceneAnimCurve {
 
     detail::SceneDeviceAssetPtr pDeviceAsset;
 
-    uint32_t  Id              = detail::kInvalidId;
-    uint16_t  AnimStackIndex  = detail::kInvalidId16;
-    uint16_t  AnimLayerIndex  = detail::kInvalidId16;
-    EProperty eProperty       = ePropertyCount;
-    EChannel  eChannel        = eChannelCount;
-    XMFLOAT3  TimeMinMaxTotal = XMFLOAT3{0, 0, 0};
-
-    /* Animation keys, each is the 2D vector where X stands for time and Y stands for value.
+    uint32_t  Id                  = detail::kInvalidId;
+    uint16_t  AnimStackIndex      = detail::kInvalidId16;
+    uint16_t  AnimLayerIndex      = detail::kInvalidId16;
+    EProperty eProperty           = ePropertyCount;
+    EChannel  eChannel            = eChannelCount;
+    XMFLOAT3  TimeMinMaxTotal     = XMFLOAT3{0, 0, 0};
+    uint32_t  BaseKey             = 0;
+    uint32_t  KeyCount            = 0;
+    uint32_t  QuantizedTrackIndex = detail::kInvalidId; /* Track in SceneAnimLayer::QuantizedTracks of its layer if the keys are released. */
+
+    /* Returns true if the keys of the curve are released, and it is evaluated from the quantized track of its layer.
+     * The quantized curves are evaluated with Scene::CalculateAnimCurves only.
      */
-    apemode::vector_map< float, SceneAnimCurveKey > Keys;
+    inline bool IsQuantized( ) const {
+        return QuantizedTrackIndex != detail::kInvalidId;
+    }
 
-    /* Assigns two indices of the keys for the given time value, loops the time value.
-     * The two key indices can be used for accessing actual animation keys' values and interpolating between them.
+    /* Assigns the key index of the segment and the interpolation factor within the segment for the given time value.
+     * The key index is the absolute index in SceneAnimCurveKeys arrays.
+     * If the segment hint (the key index relative to the curve) is provided, the search starts from it, and it gets updated.
+     * The curve is expected to keep the keys (see IsQuantized).
      */
-    void GetKeyIndices( float &time, uint32_t &i, uint32_t &j ) const;
+    void GetSegment( const SceneAnimCurveKeys &keys, float time, uint32_t &keyIndex, float &t, uint32_t *pSegmentHint = nullptr ) const;
 
     /* Returns interpolated curve's value for the given time value.
+     * The cursor is optional, and should be initialized with Scene::InitializeAnimCursor.
+     * The curve is expected to keep the keys (see IsQuantized).
      */
-    float Calculate( float time ) const;
+    float Calculate( const SceneAnimCurveKeys &keys, float time, SceneAnimCursor *pCursor = nullptr ) const;
 };
 
 /* SceneNodeAnimCurveIds class contains animation curve IDs (for each channel of each property).
@@ -319,29 +392,127 @@ struct SceneNode {
     const char * pszName = nullptr;
     detail::SceneDeviceAssetPtr pDeviceAsset;
 
-    uint32_t               Id            = detail::kInvalidId;
-    uint32_t               ParentId      = detail::kInvalidId;
-    uint32_t               MeshId        = detail::kInvalidId;
-    uint32_t               LimitsId      = detail::kInvalidId;
-    detail::ERotationOrder eOrder        = detail::eRotationOrder_EulerXYZ;
-    detail::EInheritType   eInheritType  = detail::eInheritType_RSrs;
-    detail::ESkeletonType  eSkeletonType = detail::eSkeletonType_None;
+    uint32_t                Id              = detail::kInvalidId;
+    uint32_t                ParentId        = detail::kInvalidId;
+    uint32_t                MeshId          = detail::kInvalidId;
+    uint32_t                LimitsId        = detail::kInvalidId;
+    uint32_t                OrderIndex      = detail::kInvalidId; /* Index in Scene::OrderedNodeIds (kInvalidId if pruned). */
+    uint32_t                DescendantCount = 0;                  /* Node count in the subtree (excluding this one). */
+    uint32_t                StaticMatrixId  = detail::kInvalidId; /* Index in Scene::StaticLocalMatrices if not animated and not limited. */
+    uint32_t                HierarchicalMatrixId = detail::kInvalidId; /* Index in SceneNodeTransformFrame::HierarchicalMatrices if it differs from the world one. */
+    detail::ERotationOrder  eOrder          = detail::eRotationOrder_EulerXYZ;
+    detail::EInheritType    eInheritType    = detail::eInheritType_RSrs;
+    detail::ESkeletonType   eSkeletonType   = detail::eSkeletonType_None;
+    detail::ETransformShape eTransformShape = detail::eTransformShape_Full;
+    bool                    bHasGeometricTransform = true; /* False if the geometric transform is identity and not animated. */
 };
 
-/* SceneNodeTransformComposite class contains node transformation properties and calculated matrices.
+/* SceneNodeTransformFrame class contains transforms of the scene nodes.
+ * The properties and the world matrices are stored in the separate arrays (indexed by node ID),
+ * so that the world matrix reads do not fetch the properties.
+ * The local matrices are calculated from the properties during the propagation, only the ones written directly are stored.
+ * The hierarchical matrices are only stored for the parent nodes with the geometric transform (see SceneNode::HierarchicalMatrixId),
+ * for the rest of the nodes they match the world matrices.
+ * The matrices are affine, and stored as 4x3 (3x4 affine part of the row-vector matrices, the last column is implicit).
+ * The frame takes 193 bytes per node (properties, world matrix and flags).
  */
-struct SceneNodeTransformComposite {
-    SceneNodeTransform Properties;
-    XMMATRIX           WorldMatrix;
-    XMMATRIX           LocalMatrix;
-    XMMATRIX           GeometricalMatrix;
-    XMMATRIX           HierarchicalMatrix;
+struct SceneNodeTransformFrame {
+    enum EDirtyFlags {
+        eDirtyFlag_Properties = 1, /* Properties were modified, local matrix is recalculated. */
+        eDirtyFlag_Hierarchy  = 2, /* One of the ancestors was updated, limits are not applied again. */
+        eDirtyFlag_Unbaked    = 4, /* Properties of the static node differ from the bind pose, its baked matrices are not used. */
+        eDirtyFlag_Local      = 8, /* Local matrix was written directly, it is not recalculated until the properties are modified. */
+
+        eDirtyFlagMask_Update = eDirtyFlag_Properties | eDirtyFlag_Hierarchy, /* Flags that are reset after the update. */
+    };
+
+    std::vector< SceneNodeTransform > Properties;
+    std::vector< XMFLOAT4X3 >         WorldMatrices;
+    std::vector< XMFLOAT4X3 >         HierarchicalMatrices;
+
+    /* Local matrices written directly (see SetLocalMatrix), sorted by node ID.
+     */
+    apemode::vector_map< uint32_t, XMFLOAT4X3 > LocalMatrices;
+
+    /* Flags of the nodes with modified properties (indexed by node ID).
+     * Scene::UpdateTransformMatrices updates the flagged nodes with their descendants, and resets the update flags.
+     */
+    std::vector< uint8_t > DirtyFlags;
+
+    /* Composite ID of the animation stack and layer the frame was animated with (kInvalidId if not animated).
+     * Scene::UpdateTransformProperties resets the frame to the bind pose when it changes.
+     */
+    uint32_t AnimLayerCompositeId = detail::kInvalidId;
+
+    /* Resizes the arrays, flags all the nodes.
+     * The hierarchical matrices are resized by Scene::UpdateTransformMatrices.
+     */
+    inline void Resize( const size_t nodeCount ) {
+        Properties.resize( nodeCount );
+        WorldMatrices.resize( nodeCount );
+        LocalMatrices.clear( );
+        SetAllDirty( );
+    }
+
+    inline size_t GetNodeCount( ) const {
+        return Properties.size( );
+    }
+
+    inline XMMATRIX GetHierarchicalMatrix( const uint32_t hierarchicalMatrixId ) const {
+        return XMLoadFloat4x3( &HierarchicalMatrices[ hierarchicalMatrixId ] );
+    }
+
+    inline XMMATRIX GetWorldMatrix( const uint32_t nodeId ) const {
+        return XMLoadFloat4x3( &WorldMatrices[ nodeId ] );
+    }
+
+    inline XMFLOAT3 GetWorldPosition( const uint32_t nodeId ) const {
+        const XMFLOAT4X3 &worldMatrix = WorldMatrices[ nodeId ];
+        return XMFLOAT3{worldMatrix._41, worldMatrix._42, worldMatrix._43};
+    }
+
+    /* Flags the node for the next transform matrices update, should be called after modifying its properties.
+     */
+    inline void SetDirty( const uint32_t nodeId ) {
+        DirtyFlags[ nodeId ] = ( DirtyFlags[ nodeId ] & ~eDirtyFlag_Local ) | eDirtyFlag_Properties;
+    }
+
+    /* Writes the local matrix of the node, and flags the node for the next transform matrices update.
+     * The local matrix is reused by the updates (including the full ones) until the node is flagged with SetDirty.
+     */
+    inline void SetLocalMatrix( const uint32_t nodeId, FXMMATRIX localMatrix ) {
+        XMStoreFloat4x3( &LocalMatrices[ nodeId ], localMatrix );
+        DirtyFlags[ nodeId ] = ( DirtyFlags[ nodeId ] & ~eDirtyFlag_Properties ) | eDirtyFlag_Hierarchy | eDirtyFlag_Local;
+    }
+
+    /* Flags all the nodes for the next transform matrices update.
+     */
+    inline void SetAllDirty( ) {
+        DirtyFlags.assign( Properties.size( ), eDirtyFlag_Properties );
+    }
+
+    /* Resets the update flags, the state flags (eDirtyFlag_Unbaked, eDirtyFlag_Local) are kept.
+     */
+    inline void ClearDirtyFlags( ) {
+        for ( uint8_t &dirtyFlags : DirtyFlags ) {
+            dirtyFlags &= ~eDirtyFlagMask_Update;
+        }
+    }
 };
 
-/* SceneNodeTransformFrame class contains transforms of the scene nodes.
+/* SceneTransformJob class contains the range of the ordered nodes, which is a set of complete sibling subtrees.
  */
-struct SceneNodeTransformFrame {
-    std::vector< SceneNodeTransformComposite > Transforms;
+struct SceneTransformJob {
+    uint32_t OrderIndexBegin = 0;
+    uint32_t OrderIndexEnd   = 0;
+};
+
+/* SceneTransformJobs class contains the partitioning of the node hierarchy for the parallel transform propagation.
+ * The shared nodes (ancestors of the job subtrees) are updated first, then the jobs are independent.
+ */
+struct SceneTransformJobs {
+    apemode::vector< uint32_t >          SharedOrderIndices;
+    apemode::vector< SceneTransformJob > Jobs;
 };
 
 /* SceneSkin class contains the information related to the skinning.
@@ -350,6 +521,20 @@ struct SceneSkin {
     uint32_t Id = detail::kInvalidId;
     apemode::vector< uint32_t > LinkIds;
     apemode::vector< XMMATRIX > InvBindPoseMatrices;
+
+    /* Bounds of the weighted vertices in the bone spaces (by link index), see Scene::UpdateSkinBoneBounds.
+     * Only the links in BoundedLinkIndices have the vertices, the skin bounds are calculated with them.
+     */
+    apemode::vector< apemode::BoundingBox > BoneBounds;
+    apemode::vector< uint32_t >             BoundedLinkIndices;
+};
+
+/* SceneSkinBounds class contains the world space bounds of the skins for the transform frame (by skin ID).
+ * The skins without the bone bounds are not valid (cannot be culled).
+ */
+struct SceneSkinBounds {
+    apemode::vector< apemode::BoundingBox > Bounds;
+    apemode::vector< uint8_t >              IsValid;
 };
 
 /* SceneAnimStack class contains the animation stack name and layer count.
@@ -359,6 +544,134 @@ struct SceneAnimStack {
     uint32_t    LayerCount = 0;
 };
 
+/* SceneAnimQuantizedTracks class contains the tracks of the layer resampled at the fixed rate and quantized to 16 bits.
+ * The samples are stored sample-major (SampleIndex * TrackCount + TrackIndex), so that all the tracks are read sequentially.
+ * The track value is RangeMins[ TrackIndex ] + RangeScales[ TrackIndex ] * Samples[ ... ], with the track value factor applied.
+ */
+struct SceneAnimQuantizedTracks {
+    float                       SampleRate  = 0; /* Samples per second. */
+    float                       TimeMin     = 0;
+    uint32_t                    SampleCount = 0; /* Sample count per track. */
+    apemode::vector< float >    RangeMins;
+    apemode::vector< float >    RangeScales;
+    apemode::vector< uint16_t > Samples;
+};
+
+/* SceneAnimLayer class contains the compiled bindings of the layer of the animation stack.
+ * Each track binds the animation curve to the property channel of the node, the tracks are sorted by node ID.
+ * The constant curves are not tracks, their values are folded into the rest properties of the nodes.
+ */
+struct SceneAnimLayer {
+    uint16_t                              AnimStackIndex = detail::kInvalidId16;
+    uint16_t                              AnimLayerIndex = detail::kInvalidId16;
+    apemode::vector< uint32_t >           NodeIds;               /* Animated nodes (sorted). */
+    apemode::vector< SceneNodeTransform > NodeRestProperties;    /* Bind pose with the constant curves for each animated node. */
+    apemode::vector< uint32_t >           ConstNodeIds;          /* Nodes with the constant curves only (sorted). */
+    apemode::vector< SceneNodeTransform > ConstNodeProperties;   /* Bind pose with the constant curves for each constant node. */
+    apemode::vector< uint32_t >           TrackNodeIds;          /* Animated node for each track. */
+    apemode::vector< uint32_t >           TrackAnimCurveIds;     /* Animation curve for each track. */
+    apemode::vector< uint8_t >            TrackPropertyChannels; /* SceneAnimCurve::EProperty + SceneAnimCurve::EChannel for each track. */
+    apemode::vector< float >              TrackValueFactors;     /* Curve value factor for each track (degrees to radians for rotations). */
+    SceneAnimQuantizedTracks              QuantizedTracks;       /* Evaluated instead of the curves if not empty. */
+};
+
+/* ScenePoseCache class contains the ring of the poses sampled at the fixed rate (see Scene::UpdateTransformPropertiesCached).
+ * Each sample stores the decomposed local transforms of the animated nodes of the layer, the arrays are indexed by
+ * SampleSlot * NodeCount + the node index in SceneAnimLayer::NodeIds.
+ */
+struct ScenePoseCache {
+    float                             SampleRate           = 30; /* Samples per second. */
+    uint32_t                          SampleCount          = 4;  /* Ring size. */
+    uint32_t                          NodeCount            = 0;
+    uint32_t                          AnimLayerCompositeId = detail::kInvalidId;
+    std::vector< int64_t >            SampleIndices;  /* Sample index (time * SampleRate) for each slot. */
+    std::vector< SceneNodeTransform > Properties;     /* Evaluated properties (for the geometric transforms and subtree updates). */
+    std::vector< XMFLOAT3 >           Scalings;       /* Local scaling. */
+    std::vector< XMFLOAT4 >           Rotations;      /* Local rotation quaternion. */
+    std::vector< XMFLOAT3 >           Translations;   /* Local translation. */
+    SceneNodeTransformFrame           SampleFrame;    /* Frame the samples are evaluated to. */
+    SceneAnimCursor                   AnimCursor;     /* Cursor for the sample evaluation. */
+};
+
+/* SceneAnimLod class contains the animation level of detail state (see Scene::UpdateTransformPropertiesLod).
+ * The level of each skin is selected by its projected size (see Scene::UpdateAnimLod), the bones of the skin are sampled
+ * at the update rate of the level (the adjacent samples are interpolated), the leaf bones with the small influence are not evaluated.
+ */
+struct SceneAnimLod {
+    static constexpr uint8_t kFullRateLevel = 0xff;
+
+    struct Level {
+        float MinScreenSize    = 0; /* Projected skin size (pixels) the level is selected from. */
+        float SampleRate       = 0; /* Samples per second, 0 to evaluate every update. */
+        float MinBoneInfluence = 0; /* The leaf bones with smaller influence are not evaluated. */
+    };
+
+    std::vector< Level >    Levels;               /* Sorted by descending MinScreenSize. */
+    std::vector< float >    SkinRadii;            /* Bind pose radius of the bones for each skin. */
+    std::vector< uint8_t >  SkinLevels;           /* Selected level for each skin. */
+    std::vector< float >    NodeInfluences;       /* Leaf bone length relative to the skin size for each node (1 for the rest). */
+    std::vector< uint8_t >  NodeLevels;           /* The finest level of the skins for each node (kFullRateLevel for the rest). */
+    std::vector< uint8_t >  NodePruned;           /* Non-zero if the node is not evaluated. */
+    uint32_t                AnimLayerCompositeId = detail::kInvalidId;
+    std::vector< int64_t >  TrackSampleIndices;   /* Sample index (time * SampleRate) of TrackSamples0 for each track. */
+    std::vector< uint8_t >  TrackSampleLevels;    /* Level the samples were evaluated at for each track. */
+    std::vector< float >    TrackSamples0;        /* Track values at the sample index. */
+    std::vector< float >    TrackSamples1;        /* Track values at the next sample index. */
+    std::vector< uint32_t > TempTrackIndices[ 3 ];
+    std::vector< float >    TempTrackValues;
+};
+
+/* SceneAnimBlendInput class contains the layer of the animation stack with its playback and weight.
+ */
+struct SceneAnimBlendInput {
+    uint16_t AnimStackId = 0;
+    uint16_t AnimLayerId = 0;
+    float    TimeOffset  = 0;     /* Added to the scaled blend time. */
+    float    TimeScale   = 1;     /* Playback speed. */
+    float    Weight      = 1;     /* The inputs with zero weight are not evaluated. */
+    bool     bAdditive   = false; /* The difference from the bind pose is added on top of the blended inputs. */
+};
+
+/* SceneAnimCrossFade class fades out one input and fades in the other one within the time span (in the blend time).
+ */
+struct SceneAnimCrossFade {
+    uint32_t FromInputIndex = 0;
+    uint32_t ToInputIndex   = 0;
+    float    StartTime      = 0;
+    float    Duration       = 0;
+};
+
+/* SceneAnimBlend class contains the weighted blend of the animation layers (see Scene::UpdateTransformPropertiesBlended).
+ * The evaluation state is rebuilt when the layers of the inputs change.
+ */
+struct SceneAnimBlend {
+    static constexpr uint32_t kAnimLayerCompositeId = detail::kInvalidId - 1; /* Marks the frames animated with the blend. */
+
+    std::vector< SceneAnimBlendInput > Inputs;
+    std::vector< SceneAnimCrossFade >  CrossFades;
+
+    std::vector< uint32_t >           PreparedLayerIds;    /* Composite IDs of the layers of the inputs the state was built for. */
+    std::vector< uint32_t >           NodeIds;             /* Union of the animated and constant nodes of the layers (sorted). */
+    std::vector< uint32_t >           NodeSlots;           /* Index in NodeIds for each node (kInvalidId if not blended). */
+    std::vector< SceneNodeTransform > InputRestProperties; /* Rest properties for each input and node slot. */
+    std::vector< SceneNodeTransform > InputProperties;     /* Evaluated properties for each input and node slot. */
+    std::vector< float >              InputWeights;        /* Weights with the cross-fades applied. */
+    std::vector< SceneAnimCursor >    AnimCursors;         /* Cursor for each input. */
+    std::vector< uint32_t >           TempTrackIndices;
+    std::vector< float >              TempTrackValues;
+
+    /* Adds the cross-fade from one input to the other one.
+     */
+    inline void CrossFade( const uint32_t fromInputIndex, const uint32_t toInputIndex, const float startTime, const float duration ) {
+        SceneAnimCrossFade crossFade;
+        crossFade.FromInputIndex = fromInputIndex;
+        crossFade.ToInputIndex   = toInputIndex;
+        crossFade.StartTime      = startTime;
+        crossFade.Duration       = duration;
+        CrossFades.push_back( crossFade );
+    }
+};
+
 /* Scene class contains nodes, meshes, materials, animation curves and transform frames.
  */
 struct Scene {
@@ -376,11 +689,39 @@ struct Scene {
     apemode::vector_multimap< uint32_t, uint32_t > NodeToChildIds;
     SceneNodeTransformFrame                        BindPoseFrame;
 
+    /* Node IDs in parent-before-child (depth-first) order, the descendants of each node follow it contiguously.
+     * Transform matrices are propagated in a single linear pass over it.
+     * The nodes that affect no mesh or skin are excluded unless SceneLoadOptions::bKeepNonContributingNodes is set,
+     * their matrices stay in the bind pose.
+     */
+    apemode::vector< uint32_t > OrderedNodeIds;
+
+    /* Order indices of the parents for the OrderedNodeIds (kInvalidId for the root node).
+     * The parent hierarchical matrices are read from the ordered array without the node ID lookups.
+     */
+    apemode::vector< uint32_t > OrderedParentIndices;
+
+    /* Balanced subtree jobs for UpdateTransformMatricesParallel.
+     */
+    SceneTransformJobs TransformJobs;
+
+    /* Number of the nodes with the stored hierarchical matrices (see SceneNode::HierarchicalMatrixId).
+     */
+    uint32_t HierarchicalMatrixCount = 0;
+
+    /* Local and geometric matrices baked on load for the static nodes (SceneNode::StaticMatrixId).
+     * The static nodes that leave the bind pose are recalculated (see SceneNodeTransformFrame::eDirtyFlag_Unbaked).
+     */
+    std::vector< XMFLOAT4X3 > StaticLocalMatrices;
+    std::vector< XMFLOAT4X3 > StaticGeometricMatrices;
+
     apemode::vector< SceneSkin >                             Skins;
     apemode::vector< SceneAnimCurve >                        AnimCurves;
+    SceneAnimCurveKeys                                       AnimCurveKeys;
     apemode::vector_multimap< uint32_t, uint32_t >           NodeIdToAnimCurveIds;
     apemode::vector_map< uint64_t, SceneNodeAnimCurveIds >   AnimNodeIdToAnimCurveIds;
     apemode::vector< SceneAnimStack >                        AnimStacks;
+    apemode::vector_map< uint32_t, SceneAnimLayer >          AnimLayers;
 
     apemode::BoundingBox BindPoseBoundingBox;
 
@@ -388,21 +729,101 @@ struct Scene {
     // Transform matrices storage.
     //
 
-    /* Updates transform frame.
+    /* Updates transform frame for the descendants of the node (regardless of the dirty flags).
      */
     void UpdateTransformMatrices( uint32_t nodeId, SceneNodeTransformFrame &transformFrame ) const;
 
-    /* Updates transform frame.
+    /* Updates transform frame for the dirty nodes and their descendants.
      */
     void UpdateTransformMatrices( SceneNodeTransformFrame &transformFrame ) const;
 
-    /* Initializes transform frame.
+    /* Updates transform frame, the subtree jobs run on the workers of the default taskflow, returns when they are completed.
+     * Falls back to UpdateTransformMatrices for the small scenes.
+     */
+    void UpdateTransformMatricesParallel( SceneNodeTransformFrame &transformFrame ) const;
+
+    /* Initializes transform frame (with the bind pose, once it is calculated).
      */
     void InitializeTransformFrame( SceneNodeTransformFrame &transformFrame ) const;
 
+    /* Initializes animation cursor.
+     */
+    void InitializeAnimCursor( SceneAnimCursor &animCursor ) const;
+
     /* Animates transform frame, returns it.
+     * Only the animated nodes are reset to the bind pose and evaluated, the frame is fully reset when the stack or layer changes.
+     * The cursor is optional, it makes the key lookups amortized constant for the monotonic playback.
+     */
+    void UpdateTransformProperties( float                    time,
+                                    bool                     bLoop,
+                                    uint16_t                 animStackId,
+                                    uint16_t                 animLayerId,
+                                    SceneNodeTransformFrame *pOutAnimatedFrame,
+                                    SceneAnimCursor *        pAnimCursor = nullptr );
+
+    /* Animates transform frames of the instances of the scene, each instance at its own time value.
+     * The tracks are iterated in the outer loop and the instances in the inner one, so that the keys of each curve are read once.
+     * The scratch storage is owned by the caller (see SceneAnimInstanceScratch), the cursors are optional (one for each instance).
      */
-    void UpdateTransformProperties( float time, bool bLoop, uint16_t animStackId, uint16_t animLayerId, SceneNodeTransformFrame * pOutAnimatedFrame );
+    void UpdateTransformPropertiesInstanced( const float *                   pTimes,
+                                             size_t                          instanceCount,
+                                             bool                            bLoop,
+                                             uint16_t                        animStackId,
+                                             uint16_t                        animLayerId,
+                                             SceneNodeTransformFrame *const *ppOutAnimatedFrames,
+                                             SceneAnimInstanceScratch *      pScratch,
+                                             SceneAnimCursor *const *        ppAnimCursors = nullptr );
+
+    /* Initializes pose cache with the sample rate (samples per second) and the ring size (at least 2 samples).
+     */
+    void InitializePoseCache( ScenePoseCache &poseCache, float sampleRate, uint32_t sampleCount = 4 ) const;
+
+    /* Animates transform frame with the poses sampled at the fixed rate, so that the curve evaluation cost
+     * does not depend on how often it is called. The adjacent samples are blended (slerp for the rotations, lerp for the rest).
+     * The blended local matrices are written to the frame, and the animated nodes are flagged for the hierarchy update only
+     * (the properties are the ones of the previous sample, the subtree updates will recalculate the matrices from them).
+     */
+    void UpdateTransformPropertiesCached( float                    time,
+                                          bool                     bLoop,
+                                          uint16_t                 animStackId,
+                                          uint16_t                 animLayerId,
+                                          SceneNodeTransformFrame *pOutAnimatedFrame,
+                                          ScenePoseCache *         pPoseCache );
+
+    /* Initializes animation LOD with the levels, calculates the bind pose radii of the skins and the influences of the leaf bones.
+     */
+    void InitializeAnimLod( SceneAnimLod &animLod, const SceneAnimLod::Level *pLevels, size_t levelCount ) const;
+
+    /* Selects the levels of the skins by their projected sizes, and assigns them to the bones (the finest level wins).
+     * The projection scale is the vertical focal length in pixels (projection matrix _22 times the half of the viewport height).
+     */
+    void UpdateAnimLod( SceneAnimLod &                 animLod,
+                        const SceneNodeTransformFrame &transformFrame,
+                        FXMMATRIX                      viewMatrix,
+                        float                          projectionScale ) const;
+
+    /* Animates transform frame with the animation LOD, so that the cost depends on the screen size of the skins.
+     * The nodes of the full rate levels (and the nodes of no skin) are evaluated as in UpdateTransformProperties.
+     * The nodes of the other levels are sampled at the level rate, the samples are kept in the LOD state and interpolated.
+     * The pruned nodes keep their properties, the hierarchy update moves them along with their parents.
+     */
+    void UpdateTransformPropertiesLod( float                    time,
+                                       bool                     bLoop,
+                                       uint16_t                 animStackId,
+                                       uint16_t                 animLayerId,
+                                       SceneNodeTransformFrame *pOutAnimatedFrame,
+                                       SceneAnimLod *           pAnimLod,
+                                       SceneAnimCursor *        pAnimCursor = nullptr );
+
+    /* Animates transform frame with the weighted blend of the layers (see SceneAnimBlend).
+     * The tracks of each weighted input are evaluated once, and the nodes are blended in a single pass over the union of the animated nodes:
+     * the translations and scalings are averaged, the rotations are blended as quaternions, the additive inputs are applied on top.
+     * The blended local matrices are written to the frame, and reused by the hierarchy update (as in UpdateTransformPropertiesCached).
+     */
+    void UpdateTransformPropertiesBlended( float                    time,
+                                           bool                     bLoop,
+                                           SceneAnimBlend *         pAnimBlend,
+                                           SceneNodeTransformFrame *pOutAnimatedFrame );
 
     /* Returns animated transform frame.
      */
@@ -416,31 +837,133 @@ struct Scene {
      */
     bool HasAnimStackLayer( uint16_t animStackId, uint16_t animLayerId ) const;
 
+    /* Returns the nodes animated by the layer of the animation stack.
+     */
+    const SceneAnimLayer *GetAnimLayer( uint16_t animStackId, uint16_t animLayerId ) const;
+
     /* Returns animation curves for the node.
      */
     const SceneNodeAnimCurveIds *GetAnimCurveIds( uint32_t nodeId, uint16_t animStackId, uint16_t animLayerId ) const;
 
-    /* Calculates skin matrix palette.
+    /* Calculates the values of the animation curves for the given time value.
+     * Evaluates 4 curves per iteration (DirectXMath: SSE, NEON).
+     * The quantized curves (see SceneAnimCurve::IsQuantized) are evaluated from the quantized tracks of their layers.
+     */
+    void CalculateAnimCurves( const uint32_t * pAnimCurveIds,
+                              size_t           animCurveCount,
+                              float            time,
+                              float *          pOutValues,
+                              SceneAnimCursor *pAnimCursor = nullptr ) const;
+
+    /* Calculates the values of the animation curve for the given time values (one for each instance).
+     * Evaluates 4 instances per iteration (DirectXMath: SSE, NEON), the cursors are optional (one for each instance).
+     * The quantized curve (see SceneAnimCurve::IsQuantized) is evaluated from the quantized track of its layer.
+     */
+    void CalculateAnimCurveInstances( uint32_t                animCurveId,
+                                      const float *           pTimes,
+                                      size_t                  instanceCount,
+                                      float *                 pOutValues,
+                                      SceneAnimCursor *const *ppAnimCursors = nullptr ) const;
+
+    /* Calculates skin matrix palette, 4 bones per iteration (DirectXMath: SSE, NEON).
+     * The normal matrices are the inverse-transposed offset matrices (calculated with the 3x3 cofactors, the matrices are affine).
+     * The matrices are written sequentially, the output can be the mapped memory.
      */
     void UpdateSkinMatrices( const SceneSkin &              skin,
                              const SceneNodeTransformFrame *pSceneAnimatedFrame,
-                             const XMMATRIX                 nodeWorldTransform,
                              XMFLOAT4X4 *                   pOffsetMatrices,
                              XMFLOAT4X4 *                   pNormalMatrices,
                              size_t                         matrixCount ) const;
+
+    /* Calculates compact skin matrix palette, 3 rows (transposed 3x4 offset matrices) per bone.
+     * The normal matrices are not calculated, they are derived from the blended matrices in the vertex shader.
+     */
+    void UpdateSkinAffineMatrices( const SceneSkin &              skin,
+                                   const SceneNodeTransformFrame *pSceneAnimatedFrame,
+                                   XMFLOAT4 *                     pAffineRows,
+                                   size_t                         matrixCount ) const;
+
+    /* Calculates dual quaternion skin palette, the real (rotation) and the dual (translation) parts per bone.
+     * The scaling of the offset matrices is dropped, the dual quaternions are rigid transforms.
+     */
+    void UpdateSkinDualQuaternions( const SceneSkin &              skin,
+                                    const SceneNodeTransformFrame *pSceneAnimatedFrame,
+                                    XMFLOAT4 *                     pDualQuaternions,
+                                    size_t                         dualQuaternionCount ) const;
+
+    //
+    // Skin bounds.
+    //
+
+    /* Extends the bone bounds of the mesh skin with the vertices (SkinnedVertex or FatSkinnedVertex, see SceneMesh::eVertexType).
+     * Each vertex is added to the bounds of all the bones it is weighted with, so the skinned vertex (the weighted sum)
+     * is always inside of the skin bounds, whatever the pose is.
+     */
+    void UpdateSkinBoneBounds( uint32_t meshId, const void *pVertices, size_t verticesSize );
+
+    /* Calculates the world space bounds of the skin, the bone bounds are transformed with the world matrices of the links.
+     * @return False if the skin has no bone bounds.
+     */
+    bool CalculateSkinBounds( const SceneSkin &skin, const SceneNodeTransformFrame &transformFrame, apemode::BoundingBox &outBounds ) const;
+
+    /* Calculates the world space bounds of all the skins (see CalculateSkinBounds).
+     */
+    void UpdateSkinBounds( const SceneNodeTransformFrame &transformFrame, SceneSkinBounds &skinBounds ) const;
 };
 
 /* Represents the loaded scene.
  */
 struct LoadedScene {
-    apemode::vector< uint8_t >   FileContents; /**! The contents of the scene file. */
-    const apemodefb::SceneFb *   pSrcScene;    /**! Is valid as long as FileContents. Make sure FileContents outlives it. */
-    apemode::unique_ptr< Scene > pScene;       /**! The scene info. */
+    apemode::vector< uint8_t >                      FileContents;    /**! The contents of the scene file (if read). */
+    apemode::unique_ptr< platform::IMappedContent > pMappedContents; /**! The mapping of the scene file (if mapped). */
+    const apemodefb::SceneFb *                      pSrcScene = nullptr; /**! Is valid as long as FileContents or pMappedContents. */
+    apemode::unique_ptr< Scene >                    pScene;          /**! The scene info. */
+};
+
+/* Scene loading options.
+ */
+struct SceneLoadOptions {
+    /* Resample and quantize the animation tracks (see SceneAnimQuantizedTracks), the keys of the quantized curves are released.
+     * The sample rate is doubled (up to 240 Hz) until the error of each track fits the budget (in the property units, degrees for rotations).
+     */
+    bool  bQuantizeAnimTracks  = false;
+    float AnimTrackSampleRate  = 30;
+    float AnimTrackErrorBudget = 1e-2f;
+
+    /* Keep animating and propagating the nodes that affect no mesh or skin (helpers, locators, cameras).
+     * By default, only the nodes with meshes, the skin links and their ancestors are updated per frame.
+     */
+    bool bKeepNonContributingNodes = false;
+
+    /* Verify the scene buffer before loading (flatbuffers::Verifier), the offsets are checked in place.
+     */
+    bool bVerifyBuffer = true;
+
+    /* Load the nodes, the meshes, the skins and the curves as the local task graph on the workers of the application taskflow (each curve is decoded separately).
+     * The loaded scene is the same as with the serial loading, the phase times are logged in both cases.
+     */
+    bool bParallelLoading = true;
+
+    /* Compare each simplified curve to its decoded keys (on the keys and in the middle of the segments), the curves that exceed the tolerance are logged.
+     * A debugging option, the decoded keys are evaluated twice per curve.
+     */
+    bool bValidateAnimCurves = false;
 };
 
 /* Loads scene from the contents of the FbxPipeline's exported scene file.
  */
-LoadedScene LoadSceneFromBin( apemode::vector< uint8_t > &&fileContents );
+LoadedScene LoadSceneFromBin( apemode::vector< uint8_t > &&fileContents, const SceneLoadOptions &options = SceneLoadOptions( ) );
+
+/* Loads scene from the mapping of the FbxPipeline's exported scene file (see IAsset::MapContent).
+ * The mesh and texture payloads are referenced in the mapping, they are not copied.
+ */
+LoadedScene LoadSceneFromMappedBin( apemode::unique_ptr< platform::IMappedContent > &&pMappedContents,
+                                    const SceneLoadOptions &                         options = SceneLoadOptions( ) );
+
+/* Hints that the mesh and texture payloads of the mapped scene file were uploaded, their pages can be released.
+ * The payloads are reloaded from the file if accessed again, nothing is done for the scene files read to memory.
+ */
+void DiscardUploadedPayloads( const LoadedScene &loadedScene );
 
 namespace utils {
 
@@ -453,6 +976,11 @@ apemodefb::Vec2Fb       GetVec2Property( const apemodefb::SceneFb *pScene, const
 apemodefb::Vec3Fb       GetVec3Property( const apemodefb::SceneFb *pScene, const uint32_t valueId );
 apemodefb::Vec4Fb       GetVec4Property( const apemodefb::SceneFb *pScene, const uint32_t valueId, const float defaultW = 1.0f );
 
+/* Simplifies the curve with the step in the middle (linear, constant, linear keys), returns true if all the keys are kept.
+ * A debugging check of the curve simplification, see SceneLoadOptions::bValidateAnimCurves.
+ */
+bool CheckAnimCurveKeySimplification( );
+
 } // namespace utils
 
 } // namespace apemode
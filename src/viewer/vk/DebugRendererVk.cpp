@@ -399,21 +399,12 @@ void PopulateNodeConnectionLines( const apemode::Scene*                   pScene
                                   apemodevk::vector< apemode::XMFLOAT3 >* pOutLines ) {
     using namespace apemode;
     if ( pScene && pTransformFrame && pOutLines ) {
-        auto& nodeTransformComposite = pTransformFrame->Transforms[ nodeId ];
-
-        XMFLOAT4X4 nodeWorldMatrix;
-        XMFLOAT4X4 childWorldMatrix;
-
-        XMStoreFloat4x4( &nodeWorldMatrix, nodeTransformComposite.WorldMatrix );
-        XMFLOAT3 nodeWorldPosition{nodeWorldMatrix._41, nodeWorldMatrix._42, nodeWorldMatrix._43};
+        const XMFLOAT3 nodeWorldPosition = pTransformFrame->GetWorldPosition( nodeId );
 
         const auto childIdRange = pScene->NodeToChildIds.equal_range( nodeId );
         for ( auto childIdIt = childIdRange.first; childIdIt != childIdRange.second; ++childIdIt ) {
-            const uint32_t childId                 = childIdIt->second;
-            const auto&    childTransformComposite = pTransformFrame->Transforms[ childId ];
-
-            XMStoreFloat4x4( &childWorldMatrix, childTransformComposite.WorldMatrix );
-            XMFLOAT3 childWorldPosition{childWorldMatrix._41, childWorldMatrix._42, childWorldMatrix._43};
+            const uint32_t childId            = childIdIt->second;
+            const XMFLOAT3 childWorldPosition = pTransformFrame->GetWorldPosition( childId );
 
             pOutLines->push_back( nodeWorldPosition );
             pOutLines->push_back( childWorldPosition );
@@ -0,0 +1,719 @@
+#include "SceneAnimatorVk.h"
+
+#include <viewer/Scene.h>
+#include <viewer/vk/ShaderModulesVk.h>
+
+#include <apemode/vk/Buffer.Vulkan.h>
+#include <apemode/vk/QueuePools.Vulkan.h>
+#include <apemode/vk/TOneTimeCmdBufferSubmit.Vulkan.h>
+
+#include <apemode/platform/AppState.h>
+#include <apemode/platform/ArrayUtils.h>
+#include <apemode/platform/MathInc.h>
+
+namespace {
+
+using namespace apemodexm;
+
+/* The structures match the ones of SceneAnimation.comp (std430).
+ */
+struct AnimCurveKeyGPU {
+    float Time;
+    float Value;
+    float Bez1;
+    float Bez2;
+    float Bez3;
+    float Padding[ 3 ];
+};
+
+struct AnimTrackGPU {
+    uint32_t NodeId;
+    uint32_t PropertyChannel;
+    uint32_t BaseKey;
+    uint32_t KeyCount;
+    float    ValueFactor;
+    float    TimeMin;
+    float    TimeMax;
+    uint32_t Padding;
+};
+
+struct AnimNodeGPU {
+    uint32_t NodeId;
+    uint32_t ParentId;
+    uint32_t Flags; /* Rotation order (8 bits), has geometric transform (1 << 8). */
+    uint32_t LimitsIndex;
+};
+
+struct AnimBoneGPU {
+    XMFLOAT4X4 InvBindPoseMatrix;
+    XMUINT4    Indices; /* Link node, offset and normal matrix indices within the instance palette. */
+};
+
+constexpr uint32_t kLimitsVectorCount = 6; /* Min and max vectors for translation, rotation and scaling. */
+constexpr uint32_t kGroupSize         = 64;
+
+static_assert( sizeof( AnimCurveKeyGPU ) == 32, "Expected std430 layout." );
+static_assert( sizeof( AnimTrackGPU ) == 32, "Expected std430 layout." );
+static_assert( sizeof( AnimBoneGPU ) == 80, "Expected std430 layout." );
+static_assert( sizeof( apemode::SceneNodeTransform ) == sizeof( float ) * apemode::SceneAnimCurve::ePropertyCount, "Properties are copied as floats." );
+
+XMFLOAT4 ToLimitsVector( const XMFLOAT3 v, const XMINT3 isActive ) {
+    // The x flag is checked for all the components (see SceneNodeTransform::ApplyLimits).
+    return XMFLOAT4{v.x, v.y, v.z, isActive.x ? 1.0f : 0.0f};
+}
+
+/* Records the memory barrier for the compute shader writes that are read (or written) by the next stage.
+ */
+void CmdMemoryBarrier( apemodevk::GraphicsDevice* pNode,
+                       VkCommandBuffer            pCmdBuffer,
+                       VkPipelineStageFlags       eSrcStageFlags,
+                       VkAccessFlags              eSrcAccessFlags,
+                       VkPipelineStageFlags       eDstStageFlags,
+                       VkAccessFlags              eDstAccessFlags ) {
+    VkMemoryBarrier memoryBarrier;
+    apemodevk::InitializeStruct( memoryBarrier );
+    memoryBarrier.srcAccessMask = eSrcAccessFlags;
+    memoryBarrier.dstAccessMask = eDstAccessFlags;
+
+    pNode->vkCmdPipelineBarrier( pCmdBuffer,     /* Cmd */
+                                 eSrcStageFlags, /* Src stage */
+                                 eDstStageFlags, /* Dst stage */
+                                 0,              /* Dependency flags */
+                                 1,              /* Memory barrier count */
+                                 &memoryBarrier, /* Memory barriers */
+                                 0,              /* Buffer barrier count */
+                                 nullptr,        /* Buffer barriers */
+                                 0,              /* Img barrier count */
+                                 nullptr );      /* Img barriers */
+}
+
+} // namespace
+
+bool apemode::vk::SceneAnimator::Recreate( const RecreateParameters* pParams ) {
+    using namespace apemodevk;
+
+    if ( nullptr == pParams || nullptr == pParams->pNode || nullptr == pParams->pScene ) {
+        return false;
+    }
+
+    pNode = pParams->pNode;
+    pDescSet = VK_NULL_HANDLE;
+
+    const Scene* pScene = pParams->pScene;
+
+    const SceneAnimLayer* pAnimLayer = pScene->GetAnimLayer( pParams->AnimStackId, pParams->AnimLayerId );
+    if ( nullptr == pAnimLayer ) {
+        apemode::LogWarn( "The animation layer is missing: stack={}, layer={}", pParams->AnimStackId, pParams->AnimLayerId );
+        return false;
+    }
+
+    if ( pAnimLayer->QuantizedTracks.SampleCount ) {
+        apemode::LogWarn( "The quantized animation layers are not supported, the curve keys are released." );
+        return false;
+    }
+
+    if ( pNode->AdapterProps.limits.maxPerStageDescriptorStorageBuffers < eBindingCount ) {
+        apemode::LogWarn( "The device supports {} storage buffers per stage, required: {}",
+                          pNode->AdapterProps.limits.maxPerStageDescriptorStorageBuffers,
+                          uint32_t( eBindingCount ) );
+        return false;
+    }
+
+    AnimStackId   = pParams->AnimStackId;
+    AnimLayerId   = pParams->AnimLayerId;
+    InstanceCount = eastl::min( eastl::max( pParams->InstanceCount, 1u ), kMaxInstanceCount );
+    NodeCount     = uint32_t( pScene->Nodes.size( ) );
+
+    //
+    // Curve keys and tracks.
+    //
+
+    const SceneAnimCurveKeys& keys = pScene->AnimCurveKeys;
+
+    apemode::vector< AnimCurveKeyGPU > animCurveKeys( keys.Times.size( ) );
+    for ( size_t i = 0; i < keys.Times.size( ); ++i ) {
+        AnimCurveKeyGPU& key = animCurveKeys[ i ];
+        key.Time  = keys.Times[ i ];
+        key.Value = keys.Values[ i ];
+        key.Bez1  = keys.Bez1[ i ];
+        key.Bez2  = keys.Bez2[ i ];
+        key.Bez3  = keys.Bez3[ i ];
+        key.Padding[ 0 ] = key.Padding[ 1 ] = key.Padding[ 2 ] = 0;
+    }
+
+    apemode::vector< AnimTrackGPU > animTracks( pAnimLayer->TrackAnimCurveIds.size( ) );
+    for ( size_t i = 0; i < animTracks.size( ); ++i ) {
+        const SceneAnimCurve& animCurve = pScene->AnimCurves[ pAnimLayer->TrackAnimCurveIds[ i ] ];
+
+        AnimTrackGPU& track = animTracks[ i ];
+        track.NodeId          = pAnimLayer->TrackNodeIds[ i ];
+        track.PropertyChannel = pAnimLayer->TrackPropertyChannels[ i ];
+        track.BaseKey         = animCurve.BaseKey;
+        track.KeyCount        = animCurve.KeyCount;
+        track.ValueFactor     = pAnimLayer->TrackValueFactors[ i ];
+        track.TimeMin         = animCurve.TimeMinMaxTotal.x;
+        track.TimeMax         = animCurve.TimeMinMaxTotal.y;
+        track.Padding         = 0;
+    }
+
+    TrackRange.ItemBegin = 0;
+    TrackRange.ItemCount = uint32_t( animTracks.size( ) );
+
+    //
+    // Rest properties: the bind pose with the constant curves of the layer, and the rest properties of the animated nodes.
+    //
+
+    const SceneNodeTransformFrame& bindPoseFrame = pScene->GetBindPoseTransformFrame( );
+    assert( bindPoseFrame.GetNodeCount( ) == NodeCount );
+
+    apemode::vector< SceneNodeTransform > restProperties( bindPoseFrame.Properties.begin( ), bindPoseFrame.Properties.end( ) );
+    for ( size_t i = 0; i < pAnimLayer->ConstNodeIds.size( ); ++i ) {
+        restProperties[ pAnimLayer->ConstNodeIds[ i ] ] = pAnimLayer->ConstNodeProperties[ i ];
+    }
+    for ( size_t i = 0; i < pAnimLayer->NodeIds.size( ); ++i ) {
+        restProperties[ pAnimLayer->NodeIds[ i ] ] = pAnimLayer->NodeRestProperties[ i ];
+    }
+
+    apemode::vector< XMFLOAT4 > animLimits;
+    animLimits.reserve( pScene->Limits.size( ) * kLimitsVectorCount );
+    for ( const SceneNodeTransformLimits& limits : pScene->Limits ) {
+        animLimits.push_back( ToLimitsVector( limits.TranslationMin, limits.IsTranslationMinActive ) );
+        animLimits.push_back( ToLimitsVector( limits.TranslationMax, limits.IsTranslationMaxActive ) );
+        animLimits.push_back( ToLimitsVector( limits.RotationMin, limits.IsRotationMinActive ) );
+        animLimits.push_back( ToLimitsVector( limits.RotationMax, limits.IsRotationMaxActive ) );
+        animLimits.push_back( ToLimitsVector( limits.ScalingMin, limits.IsScalingMinActive ) );
+        animLimits.push_back( ToLimitsVector( limits.ScalingMax, limits.IsScalingMaxActive ) );
+    }
+
+    //
+    // Hierarchy levels: the ordered nodes are grouped by depth (the parents are ordered before the children),
+    // the nodes of each level are independent. The animated nodes follow the levels.
+    //
+
+    apemode::vector< uint32_t > nodeDepths( NodeCount, 0 );
+    uint32_t                    maxNodeDepth = 0;
+    for ( size_t i = 0; i < pScene->OrderedNodeIds.size( ); ++i ) {
+        const uint32_t parentOrderIndex = pScene->OrderedParentIndices[ i ];
+        const uint32_t depth = parentOrderIndex != detail::kInvalidId ? nodeDepths[ pScene->OrderedNodeIds[ parentOrderIndex ] ] + 1 : 0;
+
+        nodeDepths[ pScene->OrderedNodeIds[ i ] ] = depth;
+        maxNodeDepth = eastl::max( maxNodeDepth, depth );
+    }
+
+    LevelRanges.clear( );
+    LevelRanges.resize( pScene->OrderedNodeIds.empty( ) ? 0 : maxNodeDepth + 1 );
+    for ( const uint32_t nodeId : pScene->OrderedNodeIds ) {
+        ++LevelRanges[ nodeDepths[ nodeId ] ].ItemCount;
+    }
+
+    uint32_t itemBegin = 0;
+    for ( ItemRange& levelRange : LevelRanges ) {
+        levelRange.ItemBegin = itemBegin;
+        itemBegin += levelRange.ItemCount;
+    }
+
+    apemode::vector< AnimNodeGPU > animNodes( pScene->OrderedNodeIds.size( ) + pAnimLayer->NodeIds.size( ) );
+    apemode::vector< uint32_t >    levelItemCounts( LevelRanges.size( ), 0 );
+
+    for ( const uint32_t nodeId : pScene->OrderedNodeIds ) {
+        const SceneNode& node  = pScene->Nodes[ nodeId ];
+        const uint32_t   depth = nodeDepths[ nodeId ];
+
+        AnimNodeGPU& animNode = animNodes[ LevelRanges[ depth ].ItemBegin + levelItemCounts[ depth ]++ ];
+        animNode.NodeId       = nodeId;
+        animNode.ParentId     = node.ParentId;
+        animNode.Flags        = uint32_t( node.eOrder ) | ( node.bHasGeometricTransform ? 0x100 : 0 );
+        animNode.LimitsIndex  = node.LimitsId != detail::kInvalidId ? node.LimitsId * kLimitsVectorCount : detail::kInvalidId;
+    }
+
+    AnimNodeRange.ItemBegin = uint32_t( pScene->OrderedNodeIds.size( ) );
+    AnimNodeRange.ItemCount = uint32_t( pAnimLayer->NodeIds.size( ) );
+
+    for ( uint32_t i = 0; i < AnimNodeRange.ItemCount; ++i ) {
+        AnimNodeGPU& animNode = animNodes[ AnimNodeRange.ItemBegin + i ];
+        animNode.NodeId       = pAnimLayer->NodeIds[ i ];
+        animNode.ParentId     = detail::kInvalidId;
+        animNode.Flags        = 0;
+        animNode.LimitsIndex  = detail::kInvalidId;
+    }
+
+    //
+    // Bones and palettes: the skin ranges are placed as in SceneRenderer::UpdateSkinPalettes (storage buffer palettes),
+    // the offset matrices are followed by the normal matrices, the ranges are aligned to the matrix size.
+    //
+
+    SkinOffsets.clear( );
+    SkinOffsets.resize( pScene->Skins.size( ) );
+
+    apemode::vector< AnimBoneGPU > animBones;
+    uint32_t                       paletteMatrixCount = 0;
+
+    for ( const SceneSkin& skin : pScene->Skins ) {
+        const uint32_t boneCount = uint32_t( skin.LinkIds.size( ) );
+        assert( skin.InvBindPoseMatrices.size( ) == boneCount );
+
+        SceneRenderer::BonePalettePC& skinOffsets = SkinOffsets[ skin.Id ];
+        skinOffsets.BonePaletteOffset = paletteMatrixCount * 4; /* In vectors. */
+        skinOffsets.BoneNormalOffset  = paletteMatrixCount + boneCount;
+
+        for ( uint32_t i = 0; i < boneCount; ++i ) {
+            AnimBoneGPU& animBone = animBones.emplace_back( );
+            XMStoreFloat4x4( &animBone.InvBindPoseMatrix, skin.InvBindPoseMatrices[ i ] );
+            animBone.Indices.x = skin.LinkIds[ i ];
+            animBone.Indices.y = paletteMatrixCount + i;
+            animBone.Indices.z = skinOffsets.BoneNormalOffset + i;
+            animBone.Indices.w = 0;
+        }
+
+        paletteMatrixCount += boneCount * 2;
+    }
+
+    PaletteMatrixCount   = paletteMatrixCount;
+    BoneRange.ItemBegin  = 0;
+    BoneRange.ItemCount  = uint32_t( animBones.size( ) );
+
+    //
+    // Buffers, the empty ones are allocated with the minimal size (the descriptors cannot reference null buffers).
+    //
+
+    const VkDeviceSize restPropertiesSize = sizeof( SceneNodeTransform ) * restProperties.size( );
+
+    // Each buffer is bound with a single descriptor, the instance count is clamped to fit the instance buffers into the range limit.
+    const VkDeviceSize maxBufferRange   = pNode->AdapterProps.limits.maxStorageBufferRange;
+    const VkDeviceSize instanceDataSize = eastl::max( restPropertiesSize,
+                                                      eastl::max< VkDeviceSize >( sizeof( XMFLOAT4X4 ) * 2 * NodeCount,
+                                                                                  sizeof( XMFLOAT4X4 ) * PaletteMatrixCount ) );
+
+    const uint32_t maxInstanceCount = instanceDataSize ? uint32_t( eastl::min< VkDeviceSize >( maxBufferRange / instanceDataSize, kMaxInstanceCount ) )
+                                                       : kMaxInstanceCount;
+    if ( 0 == maxInstanceCount ) {
+        apemode::LogWarn( "The instance buffers exceed the storage buffer range: {} > {}", instanceDataSize, maxBufferRange );
+        return false;
+    }
+
+    if ( InstanceCount > maxInstanceCount ) {
+        apemode::LogWarn( "The instance count is clamped to fit the storage buffer range: {} -> {}", InstanceCount, maxInstanceCount );
+        InstanceCount = maxInstanceCount;
+    }
+
+    BufferSizes[ eBinding_AnimCurveKeys ]  = sizeof( AnimCurveKeyGPU ) * animCurveKeys.size( );
+    BufferSizes[ eBinding_AnimTracks ]     = sizeof( AnimTrackGPU ) * animTracks.size( );
+    BufferSizes[ eBinding_AnimNodes ]      = sizeof( AnimNodeGPU ) * animNodes.size( );
+    BufferSizes[ eBinding_AnimLimits ]     = sizeof( XMFLOAT4 ) * animLimits.size( );
+    BufferSizes[ eBinding_RestProperties ] = restPropertiesSize;
+    BufferSizes[ eBinding_AnimBones ]      = sizeof( AnimBoneGPU ) * animBones.size( );
+    BufferSizes[ eBinding_InstanceTimes ]  = sizeof( float ) * InstanceCount;
+    BufferSizes[ eBinding_Properties ]     = restPropertiesSize * InstanceCount;
+    BufferSizes[ eBinding_Matrices ]       = sizeof( XMFLOAT4X4 ) * 2 * NodeCount * InstanceCount;
+    BufferSizes[ eBinding_BonePalettes ]   = sizeof( XMFLOAT4X4 ) * PaletteMatrixCount * InstanceCount;
+
+    for ( uint32_t i = 0; i < eBindingCount; ++i ) {
+        if ( BufferSizes[ i ] > maxBufferRange ) {
+            apemode::LogWarn( "The buffer #{} exceeds the storage buffer range: {} > {}", i, BufferSizes[ i ], maxBufferRange );
+            return false;
+        }
+    }
+
+    const void* ppSrcBufferData[ eBindingCount ] = {animCurveKeys.data( ),
+                                                    animTracks.data( ),
+                                                    animNodes.data( ),
+                                                    animLimits.data( ),
+                                                    restProperties.data( ),
+                                                    animBones.data( ),
+                                                    nullptr,
+                                                    nullptr,
+                                                    nullptr,
+                                                    nullptr};
+
+    VkDeviceSize srcBufferSizes[ eBindingCount ];
+    VkDeviceSize stagingSize = restPropertiesSize;
+    for ( uint32_t i = 0; i < eBindingCount; ++i ) {
+        srcBufferSizes[ i ] = ppSrcBufferData[ i ] ? BufferSizes[ i ] : 0;
+        BufferSizes[ i ]    = eastl::max< VkDeviceSize >( BufferSizes[ i ], 16 );
+
+        VkBufferCreateInfo bufferCreateInfo;
+        InitializeStruct( bufferCreateInfo );
+        bufferCreateInfo.size  = BufferSizes[ i ];
+        bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+        VmaAllocationCreateInfo allocationCreateInfo;
+        InitializeStruct( allocationCreateInfo );
+        allocationCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        if ( !hBuffers[ i ].Recreate( pNode->hAllocator, bufferCreateInfo, allocationCreateInfo ) ) {
+            return false;
+        }
+
+        if ( ppSrcBufferData[ i ] ) {
+            stagingSize += BufferSizes[ i ];
+        }
+    }
+
+    //
+    // Upload the constant buffers, and initialize the properties of all the instances with the rest properties.
+    //
+
+    THandle< BufferComposite > hStagingBuffer;
+
+    VkBufferCreateInfo stagingCreateInfo;
+    InitializeStruct( stagingCreateInfo );
+    stagingCreateInfo.size  = stagingSize;
+    stagingCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    VmaAllocationCreateInfo stagingAllocationCreateInfo;
+    InitializeStruct( stagingAllocationCreateInfo );
+    stagingAllocationCreateInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    stagingAllocationCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    if ( !hStagingBuffer.Recreate( pNode->hAllocator, stagingCreateInfo, stagingAllocationCreateInfo ) ) {
+        return false;
+    }
+
+    uint8_t* pMappedStagingMemory = MapStagingBuffer( pNode, hStagingBuffer );
+    if ( !pMappedStagingMemory ) {
+        return false;
+    }
+
+    VkBufferCopy bufferCopies[ eBindingCount ];
+    VkDeviceSize stagingOffset = 0;
+    for ( uint32_t i = 0; i < eBindingCount; ++i ) {
+        InitializeStruct( bufferCopies[ i ] );
+        if ( ppSrcBufferData[ i ] ) {
+            memset( pMappedStagingMemory + stagingOffset, 0, size_t( BufferSizes[ i ] ) );
+            memcpy( pMappedStagingMemory + stagingOffset, ppSrcBufferData[ i ], size_t( srcBufferSizes[ i ] ) );
+            bufferCopies[ i ].srcOffset = stagingOffset;
+            bufferCopies[ i ].size      = BufferSizes[ i ];
+            stagingOffset += BufferSizes[ i ];
+        }
+    }
+
+    const VkDeviceSize restPropertiesStagingOffset = bufferCopies[ eBinding_RestProperties ].srcOffset;
+    UnmapStagingBuffer( pNode, hStagingBuffer );
+
+    const auto uploadResult = TOneTimeCmdBufferSubmit( pNode, 0, true, [&]( VkCommandBuffer pCmdBuffer ) {
+        for ( uint32_t i = 0; i < eBindingCount; ++i ) {
+            if ( ppSrcBufferData[ i ] ) {
+                pNode->vkCmdCopyBuffer( pCmdBuffer, hStagingBuffer, hBuffers[ i ], 1, &bufferCopies[ i ] );
+            }
+        }
+
+        if ( restPropertiesSize ) {
+            for ( uint32_t i = 0; i < InstanceCount; ++i ) {
+                VkBufferCopy propertiesCopy;
+                InitializeStruct( propertiesCopy );
+                propertiesCopy.srcOffset = restPropertiesStagingOffset;
+                propertiesCopy.dstOffset = restPropertiesSize * i;
+                propertiesCopy.size      = restPropertiesSize;
+                pNode->vkCmdCopyBuffer( pCmdBuffer, hStagingBuffer, hBuffers[ eBinding_Properties ], 1, &propertiesCopy );
+            }
+        }
+
+        pNode->vkCmdFillBuffer( pCmdBuffer, hBuffers[ eBinding_InstanceTimes ], 0, VK_WHOLE_SIZE, 0 );
+        pNode->vkCmdFillBuffer( pCmdBuffer, hBuffers[ eBinding_Matrices ], 0, VK_WHOLE_SIZE, 0 );
+        pNode->vkCmdFillBuffer( pCmdBuffer, hBuffers[ eBinding_BonePalettes ], 0, VK_WHOLE_SIZE, 0 );
+
+        CmdMemoryBarrier( pNode,
+                          pCmdBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                          VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+        return true;
+    } );
+
+    if ( !IsOk( uploadResult ) ) {
+        return false;
+    }
+
+    //
+    // Set 0
+    //
+    // layout( std430, set = 0, binding = 0..9 ) buffer ...;
+    //
+
+    VkDescriptorSetLayoutBinding descriptorSetLayoutBindings[ eBindingCount ];
+    InitializeStruct( descriptorSetLayoutBindings );
+
+    for ( uint32_t i = 0; i < eBindingCount; ++i ) {
+        descriptorSetLayoutBindings[ i ].binding         = i;
+        descriptorSetLayoutBindings[ i ].descriptorCount = 1;
+        descriptorSetLayoutBindings[ i ].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorSetLayoutBindings[ i ].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
+    InitializeStruct( descriptorSetLayoutCreateInfo );
+    descriptorSetLayoutCreateInfo.bindingCount = eBindingCount;
+    descriptorSetLayoutCreateInfo.pBindings    = descriptorSetLayoutBindings;
+
+    if ( !hDescSetLayout.Recreate( *pNode, descriptorSetLayoutCreateInfo ) ) {
+        return false;
+    }
+
+    VkPushConstantRange animationPushConstant;
+    InitializeStruct( animationPushConstant );
+    animationPushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    animationPushConstant.size       = sizeof( AnimationPC );
+
+    VkDescriptorSetLayout descriptorSetLayouts[ 1 ] = {hDescSetLayout};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
+    InitializeStruct( pipelineLayoutCreateInfo );
+    pipelineLayoutCreateInfo.setLayoutCount         = 1;
+    pipelineLayoutCreateInfo.pSetLayouts            = descriptorSetLayouts;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges    = &animationPushConstant;
+
+    if ( !hPipelineLayout.Recreate( *pNode, pipelineLayoutCreateInfo ) ) {
+        return false;
+    }
+
+    THandle< VkShaderModule > hComputeShaderModule = CompileShader( pNode, pParams->pAssetManager, "shaders/Viewer.cso.d/SceneAnimation.comp.spv" );
+    if ( hComputeShaderModule.IsNull( ) ) {
+        assert( false );
+        return false;
+    }
+
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo;
+    InitializeStruct( pipelineCacheCreateInfo );
+    if ( !hPipelineCache.Recreate( *pNode, pipelineCacheCreateInfo ) ) {
+        return false;
+    }
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo;
+    InitializeStruct( computePipelineCreateInfo );
+    computePipelineCreateInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computePipelineCreateInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    computePipelineCreateInfo.stage.module = hComputeShaderModule;
+    computePipelineCreateInfo.stage.pName  = "main";
+    computePipelineCreateInfo.layout       = hPipelineLayout;
+
+    if ( !hPipeline.Recreate( *pNode, hPipelineCache, computePipelineCreateInfo ) ) {
+        return false;
+    }
+
+    if ( !DescSetPool.Recreate( *pNode, pParams->pDescPool, hDescSetLayout ) ) {
+        return false;
+    }
+
+    TDescriptorSetBindings< eBindingCount > descriptorSetBindings;
+    for ( uint32_t i = 0; i < eBindingCount; ++i ) {
+        descriptorSetBindings.pBinding[ i ].eDescriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorSetBindings.pBinding[ i ].BufferInfo.buffer = hBuffers[ i ];
+        descriptorSetBindings.pBinding[ i ].BufferInfo.offset = 0;
+        descriptorSetBindings.pBinding[ i ].BufferInfo.range  = BufferSizes[ i ];
+    }
+
+    pDescSet = DescSetPool.GetDescriptorSet( &descriptorSetBindings );
+    if ( VK_NULL_HANDLE == pDescSet ) {
+        return false;
+    }
+
+    DeviceBonePalettes.Storage.buffer = hBuffers[ eBinding_BonePalettes ];
+    DeviceBonePalettes.Storage.offset = 0;
+    DeviceBonePalettes.Storage.range  = sizeof( XMFLOAT4X4 ) * eastl::max( PaletteMatrixCount, 1u );
+    DeviceBonePalettes.pSkinOffsets   = SkinOffsets.data( );
+
+    apemode::LogInfo( "Scene animator: instances: {}, nodes: {}, levels: {}, tracks: {}, keys: {}, bones: {}",
+                      InstanceCount,
+                      NodeCount,
+                      LevelRanges.size( ),
+                      TrackRange.ItemCount,
+                      animCurveKeys.size( ),
+                      BoneRange.ItemCount );
+
+    return true;
+}
+
+void apemode::vk::SceneAnimator::Update( const UpdateParameters* pParams ) {
+    using namespace apemodevk;
+
+    if ( VK_NULL_HANDLE == pDescSet || nullptr == pParams || nullptr == pParams->pTimes ) {
+        return;
+    }
+
+    VkCommandBuffer pCmdBuffer = pParams->pCmdBuffer;
+
+    // The palettes and the times of the previous update can still be read.
+    CmdMemoryBarrier( pNode,
+                      pCmdBuffer,
+                      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+                      VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                      VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+
+    pNode->vkCmdUpdateBuffer( pCmdBuffer, hBuffers[ eBinding_InstanceTimes ], 0, sizeof( float ) * InstanceCount, pParams->pTimes );
+
+    CmdMemoryBarrier( pNode,
+                      pCmdBuffer,
+                      VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      VK_ACCESS_TRANSFER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                      VK_ACCESS_SHADER_READ_BIT );
+
+    pNode->vkCmdBindPipeline( pCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hPipeline );
+    pNode->vkCmdBindDescriptorSets( pCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hPipelineLayout, 0, 1, &pDescSet, 0, nullptr );
+
+    AnimationPC animationPC;
+    animationPC.InstanceCount      = InstanceCount;
+    animationPC.NodeCount          = NodeCount;
+    animationPC.PaletteMatrixCount = PaletteMatrixCount;
+    animationPC.Loop               = pParams->bLoop ? 1 : 0;
+
+    const uint32_t maxGroupCount = pNode->AdapterProps.limits.maxComputeWorkGroupCount[ 0 ];
+
+    // Each pass depends on the writes of the previous one.
+    bool bPendingWrites = false;
+    const auto dispatchPass = [&]( const EPass ePass, const ItemRange& itemRange ) {
+        const uint32_t totalItemCount = itemRange.ItemCount * InstanceCount;
+        if ( !totalItemCount ) {
+            return;
+        }
+
+        if ( bPendingWrites ) {
+            CmdMemoryBarrier( pNode,
+                              pCmdBuffer,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                              VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                              VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT );
+        }
+
+        animationPC.Pass      = ePass;
+        animationPC.ItemBegin = itemRange.ItemBegin;
+        animationPC.ItemCount = itemRange.ItemCount;
+
+        pNode->vkCmdPushConstants( pCmdBuffer, hPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( AnimationPC ), &animationPC );
+        pNode->vkCmdDispatch( pCmdBuffer, eastl::min( ( totalItemCount + kGroupSize - 1 ) / kGroupSize, maxGroupCount ), 1, 1 );
+        bPendingWrites = true;
+    };
+
+    dispatchPass( ePass_ResetProperties, AnimNodeRange );
+    dispatchPass( ePass_EvaluateTracks, TrackRange );
+    for ( const ItemRange& levelRange : LevelRanges ) {
+        dispatchPass( ePass_UpdateMatrices, levelRange );
+    }
+    dispatchPass( ePass_UpdatePalettes, BoneRange );
+
+    CmdMemoryBarrier( pNode,
+                      pCmdBuffer,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                      VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT );
+}
+
+bool apemode::vk::SceneAnimator::Validate( Scene* pScene, const float time, const float tolerance, float* pOutMaxError, const bool bLoop ) {
+    using namespace apemodevk;
+
+    float  maxErrorStorage;
+    float& maxError = pOutMaxError ? *pOutMaxError : maxErrorStorage;
+    maxError        = -1;
+
+    if ( VK_NULL_HANDLE == pDescSet || nullptr == pScene || pScene->Nodes.size( ) != NodeCount ) {
+        return false;
+    }
+
+    if ( !PaletteMatrixCount ) {
+        maxError = 0;
+        return true;
+    }
+
+    //
+    // Evaluate the instances on the device, and read back the palettes of the first one.
+    //
+
+    const VkDeviceSize paletteSize = sizeof( XMFLOAT4X4 ) * PaletteMatrixCount;
+
+    THandle< BufferComposite > hReadbackBuffer;
+
+    VkBufferCreateInfo readbackCreateInfo;
+    InitializeStruct( readbackCreateInfo );
+    readbackCreateInfo.size  = paletteSize;
+    readbackCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    VmaAllocationCreateInfo readbackAllocationCreateInfo;
+    InitializeStruct( readbackAllocationCreateInfo );
+    readbackAllocationCreateInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    readbackAllocationCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    if ( !hReadbackBuffer.Recreate( pNode->hAllocator, readbackCreateInfo, readbackAllocationCreateInfo ) ) {
+        return false;
+    }
+
+    const apemode::vector< float > times( InstanceCount, time );
+
+    const auto validationResult = TOneTimeCmdBufferSubmit( pNode, 0, true, [&]( VkCommandBuffer pCmdBuffer ) {
+        UpdateParameters updateParams;
+        updateParams.pCmdBuffer = pCmdBuffer;
+        updateParams.pTimes     = times.data( );
+        updateParams.bLoop      = bLoop;
+        Update( &updateParams );
+
+        VkBufferCopy bufferCopy;
+        InitializeStruct( bufferCopy );
+        bufferCopy.size = paletteSize;
+        pNode->vkCmdCopyBuffer( pCmdBuffer, hBuffers[ eBinding_BonePalettes ], hReadbackBuffer, 1, &bufferCopy );
+
+        CmdMemoryBarrier( pNode,
+                          pCmdBuffer,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_ACCESS_TRANSFER_WRITE_BIT,
+                          VK_PIPELINE_STAGE_HOST_BIT,
+                          VK_ACCESS_HOST_READ_BIT );
+        return true;
+    } );
+
+    if ( !IsOk( validationResult ) ) {
+        return false;
+    }
+
+    const uint8_t* pMappedReadbackMemory = MapStagingBuffer( pNode, hReadbackBuffer );
+    if ( !pMappedReadbackMemory ) {
+        return false;
+    }
+
+    //
+    // Calculate the palettes on CPU, and compare them.
+    //
+
+    SceneNodeTransformFrame transformFrame;
+    pScene->InitializeTransformFrame( transformFrame );
+    pScene->UpdateTransformProperties( time, bLoop, AnimStackId, AnimLayerId, &transformFrame );
+    pScene->UpdateTransformMatrices( transformFrame );
+
+    const XMFLOAT4X4* pDeviceMatrices = reinterpret_cast< const XMFLOAT4X4* >( pMappedReadbackMemory );
+
+    apemode::vector< XMFLOAT4X4 > offsetMatrices;
+    apemode::vector< XMFLOAT4X4 > normalMatrices;
+
+    maxError = 0;
+    for ( const SceneSkin& skin : pScene->Skins ) {
+        const size_t boneCount = skin.LinkIds.size( );
+        offsetMatrices.resize( boneCount );
+        normalMatrices.resize( boneCount );
+
+        pScene->UpdateSkinMatrices( skin, &transformFrame, offsetMatrices.data( ), normalMatrices.data( ), boneCount );
+
+        const SceneRenderer::BonePalettePC& skinOffsets = SkinOffsets[ skin.Id ];
+        for ( size_t i = 0; i < boneCount; ++i ) {
+            const XMFLOAT4X4& deviceOffsetMatrix = pDeviceMatrices[ skinOffsets.BonePaletteOffset / 4 + i ];
+            const XMFLOAT4X4& deviceNormalMatrix = pDeviceMatrices[ skinOffsets.BoneNormalOffset + i ];
+
+            for ( uint32_t e = 0; e < 16; ++e ) {
+                const float expectedOffset = offsetMatrices[ i ].m[ e / 4 ][ e % 4 ];
+                const float expectedNormal = normalMatrices[ i ].m[ e / 4 ][ e % 4 ];
+
+                maxError = eastl::max( maxError, fabsf( deviceOffsetMatrix.m[ e / 4 ][ e % 4 ] - expectedOffset ) / eastl::max( 1.0f, fabsf( expectedOffset ) ) );
+                maxError = eastl::max( maxError, fabsf( deviceNormalMatrix.m[ e / 4 ][ e % 4 ] - expectedNormal ) / eastl::max( 1.0f, fabsf( expectedNormal ) ) );
+            }
+        }
+    }
+
+    UnmapStagingBuffer( pNode, hReadbackBuffer );
+    return maxError <= tolerance;
+}
+
+const apemode::vk::SceneRenderer::DeviceBonePalettes* apemode::vk::SceneAnimator::GetDeviceBonePalettes( ) const {
+    return VK_NULL_HANDLE != pDescSet ? &DeviceBonePalettes : nullptr;
+}
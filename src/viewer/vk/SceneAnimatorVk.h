@@ -0,0 +1,128 @@
+#pragma once
+
+#include <viewer/vk/SceneRendererVk.h>
+
+#include <apemode/vk/Buffer.Vulkan.h>
+#include <apemode/vk/DescriptorPool.Vulkan.h>
+#include <apemode/vk/GraphicsDevice.Vulkan.h>
+
+#include <apemode/platform/IAssetManager.h>
+
+namespace apemode {
+struct Scene;
+
+namespace vk {
+
+/* SceneAnimator class evaluates the animation layer of the scene instances with the compute shader (SceneAnimation.comp).
+ * The curve keys, the tracks and the node hierarchy are uploaded once, the passes are recorded to the command buffer each frame:
+ * the animated nodes are reset to the rest properties, the tracks are evaluated, the matrices are propagated level by level,
+ * and the skin palettes are written in the layout of the renderer storage buffer palettes (see SceneRenderer::DeviceBonePalettes).
+ * The quantized layers are not supported (their curve keys are released on load).
+ */
+class SceneAnimator {
+public:
+    struct RecreateParameters {
+        apemodevk::GraphicsDevice*        pNode         = nullptr;        /* Required. */
+        apemode::platform::IAssetManager* pAssetManager = nullptr;        /* Required. */
+        VkDescriptorPool                  pDescPool     = VK_NULL_HANDLE; /* Required. */
+        const Scene*                      pScene        = nullptr;        /* Required. */
+        uint16_t                          AnimStackId   = 0;              /* Required. */
+        uint16_t                          AnimLayerId   = 0;              /* Required. */
+        uint32_t                          InstanceCount = 1;              /* Optional. */
+    };
+
+    bool Recreate( const RecreateParameters* pParams );
+
+    struct UpdateParameters {
+        VkCommandBuffer pCmdBuffer = VK_NULL_HANDLE; /* Required, outside of the render pass. */
+        const float*    pTimes     = nullptr;        /* Required, one for each instance. */
+        bool            bLoop      = true;           /* Optional. */
+    };
+
+    /* Records the animation passes, the palettes are ready for the vertex shaders after them.
+     */
+    void Update( const UpdateParameters* pParams );
+
+    /* Evaluates the instances at the time value, reads back the palettes of the first instance,
+     * and compares them to the palettes calculated on CPU (UpdateTransformProperties, UpdateTransformMatrices, UpdateSkinMatrices).
+     * The error is relative for the values above 1, the maximum error is optional (negative if the evaluation failed).
+     * @return True if the maximum error is within the tolerance, false otherwise.
+     */
+    bool Validate( Scene* pScene, float time, float tolerance = kValidationTolerance, float* pOutMaxError = nullptr, bool bLoop = true );
+
+    /* The palettes are compared after the propagation through the hierarchy, the float operations differ in order.
+     */
+    static constexpr float kValidationTolerance = 1e-3f;
+
+    /* Returns the palettes of the first instance for rendering (null if not recreated).
+     */
+    const SceneRenderer::DeviceBonePalettes* GetDeviceBonePalettes( ) const;
+
+    /* The instance times are updated with the command buffer (up to 64KB).
+     */
+    static constexpr uint32_t kMaxInstanceCount = 16384;
+
+    enum EPass {
+        ePass_ResetProperties = 0,
+        ePass_EvaluateTracks,
+        ePass_UpdateMatrices,
+        ePass_UpdatePalettes,
+    };
+
+    enum EBinding {
+        eBinding_AnimCurveKeys = 0,
+        eBinding_AnimTracks,
+        eBinding_AnimNodes,
+        eBinding_AnimLimits,
+        eBinding_RestProperties,
+        eBinding_AnimBones,
+        eBinding_InstanceTimes,
+        eBinding_Properties,
+        eBinding_Matrices,
+        eBinding_BonePalettes,
+        eBindingCount,
+    };
+
+    /* Push constants of the compute pipeline.
+     */
+    struct AnimationPC {
+        uint32_t Pass;
+        uint32_t ItemBegin;
+        uint32_t ItemCount;
+        uint32_t InstanceCount;
+        uint32_t NodeCount;
+        uint32_t PaletteMatrixCount;
+        uint32_t Loop;
+    };
+
+    /* Range of the items of the pass (in AnimNodes, AnimTracks or AnimBones buffers).
+     */
+    struct ItemRange {
+        uint32_t ItemBegin = 0;
+        uint32_t ItemCount = 0;
+    };
+
+    apemodevk::GraphicsDevice*                            pNode = nullptr;
+    apemodevk::THandle< VkDescriptorSetLayout >           hDescSetLayout;
+    apemodevk::THandle< VkPipelineLayout >                hPipelineLayout;
+    apemodevk::THandle< VkPipelineCache >                 hPipelineCache;
+    apemodevk::THandle< VkPipeline >                      hPipeline;
+    apemodevk::DescriptorSetPool                          DescSetPool;
+    VkDescriptorSet                                       pDescSet = VK_NULL_HANDLE;
+    apemodevk::THandle< apemodevk::BufferComposite >      hBuffers[ eBindingCount ];
+    VkDeviceSize                                          BufferSizes[ eBindingCount ] = {0};
+    apemodevk::vector< ItemRange >                        LevelRanges;   /* Node ranges of the hierarchy levels. */
+    ItemRange                                             AnimNodeRange; /* Animated nodes (after the levels). */
+    ItemRange                                             TrackRange;
+    ItemRange                                             BoneRange;
+    apemodevk::vector< SceneRenderer::BonePalettePC >     SkinOffsets; /* By skin ID. */
+    SceneRenderer::DeviceBonePalettes                     DeviceBonePalettes;
+    uint32_t                                              InstanceCount      = 0;
+    uint32_t                                              NodeCount          = 0;
+    uint32_t                                              PaletteMatrixCount = 0;
+    uint16_t                                              AnimStackId        = 0;
+    uint16_t                                              AnimLayerId        = 0;
+};
+
+} // namespace vk
+} // namespace apemode
@@ -2,6 +2,7 @@
 #include "SceneRendererVk.h"
 
 #include <viewer/vk/SceneUploaderVk.h>
+#include <viewer/vk/ShaderModulesVk.h>
 #include <viewer/Scene.h>
 
 #include <apemode/vk/Buffer.Vulkan.h>
@@ -42,6 +43,35 @@ struct LightUBO {
     XMFLOAT4 LightColor;
 };
 
+/* Returns true if all the corners of the box are outside of one of the clip planes (-w <= x, y <= w, 0 <= z <= w).
+ * The planes are linear in the world space, so the test is conservative for any projection (the corners behind the camera included).
+ */
+bool IsOutsideClipVolume( const apemode::BoundingBox& bounds, FXMMATRIX viewProjMatrix ) {
+    XMFLOAT3 corners[ apemode::BoundingBox::CORNER_COUNT ];
+    bounds.GetCorners( corners );
+
+    uint32_t outsideMask = 0x3f;
+    for ( const XMFLOAT3& corner : corners ) {
+        XMFLOAT4 clipCorner;
+        XMStoreFloat4( &clipCorner, XMVector3Transform( XMLoadFloat3( &corner ), viewProjMatrix ) );
+
+        uint32_t cornerOutsideMask = 0;
+        cornerOutsideMask |= clipCorner.x < -clipCorner.w ? 0x01 : 0;
+        cornerOutsideMask |= clipCorner.x > clipCorner.w ? 0x02 : 0;
+        cornerOutsideMask |= clipCorner.y < -clipCorner.w ? 0x04 : 0;
+        cornerOutsideMask |= clipCorner.y > clipCorner.w ? 0x08 : 0;
+        cornerOutsideMask |= clipCorner.z < 0 ? 0x10 : 0;
+        cornerOutsideMask |= clipCorner.z > clipCorner.w ? 0x20 : 0;
+
+        outsideMask &= cornerOutsideMask;
+        if ( !outsideMask ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool FillCombinedImgSamplerBinding( apemodevk::DescriptorSetBindingsBase::Binding* pBinding,
                                     VkImageView                            pImgView,
                                     VkSampler                              pSampler,
@@ -90,6 +120,16 @@ bool apemode::vk::SceneRenderer::RenderScene( const Scene* pScene, const SceneRe
     const apemode::SceneNodeTransformFrame* pTransformFrame =
         pParams->pTransformFrame ? pParams->pTransformFrame : &pScene->GetBindPoseTransformFrame( );
 
+    // The skinned nodes are rendered with the identity world matrices, the world space skin bounds are tested.
+    CulledSkins.assign( pScene->Skins.size( ), 0 );
+    if ( pParams->pSkinBounds && pParams->pSkinBounds->IsValid.size( ) == pScene->Skins.size( ) ) {
+        const XMMATRIX viewProjMatrix = XMLoadFloat4x4( &pParams->ViewMatrix ) * XMLoadFloat4x4( &pParams->ProjMatrix );
+        for ( size_t skinId = 0; skinId < pScene->Skins.size( ); ++skinId ) {
+            CulledSkins[ skinId ] = pParams->pSkinBounds->IsValid[ skinId ] &&
+                                    IsOutsideClipVolume( pParams->pSkinBounds->Bounds[ skinId ], viewProjMatrix );
+        }
+    }
+
     SortedNodeIds.clear( );
     SortedNodeIds.reserve( pScene->Nodes.size( ) );
 
@@ -99,6 +139,9 @@ bool apemode::vk::SceneRenderer::RenderScene( const Scene* pScene, const SceneRe
         }
 
         const SceneMesh& mesh = pScene->Meshes[ node.MeshId ];
+        if ( IsSkinCulled( mesh.SkinId ) ) {
+            continue;
+        }
 
         switch ( mesh.eVertexType ) {
             case apemode::detail::eVertexType_Default:
@@ -121,6 +164,8 @@ bool apemode::vk::SceneRenderer::RenderScene( const Scene* pScene, const SceneRe
         }
     }
 
+    UpdateSkinPalettes( pScene, Frames[ pParams->FrameIndex ], pTransformFrame, pParams->pDeviceBonePalettes );
+
     for ( PipelineComposite::Flags ePipelineFlags :
           {// PipelineComposite::kFlag_VertexType_Packed | PipelineComposite::kFlag_BlendType_Disabled,
            // PipelineComposite::kFlag_VertexType_PackedSkinned | PipelineComposite::kFlag_BlendType_Disabled,
@@ -139,6 +184,151 @@ bool apemode::vk::SceneRenderer::RenderScene( const Scene* pScene, const SceneRe
     return true;
 }
 
+void apemode::vk::SceneRenderer::UpdateSkinPalettes( const Scene*                            pScene,
+                                                     Frame&                                  frame,
+                                                     const apemode::SceneNodeTransformFrame* pTransformFrame,
+                                                     const DeviceBonePalettes*               pDeviceBonePalettes ) {
+    SkinPalettes.clear( );
+    BonePaletteStorage = {VK_NULL_HANDLE, 0, 0};
+
+    // The palettes were calculated on the device, only the offsets of the skins are referenced.
+    if ( pDeviceBonePalettes && bBonePaletteSSBO && eBonePaletteFormat == eBonePaletteFormat_Matrix4x4 ) {
+        assert( pDeviceBonePalettes->pSkinOffsets );
+        BonePaletteStorage = pDeviceBonePalettes->Storage;
+
+        for ( const SceneNode& node : pScene->Nodes ) {
+            if ( node.MeshId != uint32_t( -1 ) && pScene->Meshes[ node.MeshId ].SkinId != uint32_t( -1 ) ) {
+                const uint32_t skinId = pScene->Meshes[ node.MeshId ].SkinId;
+                if ( IsSkinCulled( skinId ) ) {
+                    continue;
+                }
+
+                SkinPalettes[ skinId ].Offsets = pDeviceBonePalettes->pSkinOffsets[ skinId ];
+            }
+        }
+
+        return;
+    }
+
+    const uint32_t maxBoneCount      = bBonePaletteSSBO ? uint32_t( -1 ) : GetMaxBoneCount( eBonePaletteFormat );
+    const uint32_t bonePaletteStride = GetBonePaletteStride( eBonePaletteFormat );
+    const uint32_t boneNormalsStride = eBonePaletteFormat == eBonePaletteFormat_Matrix4x4 ? uint32_t( sizeof( XMFLOAT4X4 ) ) : 0;
+
+    // The buffer pool is not thread-safe, the palettes are allocated before the parallel calculations.
+    uint32_t bonePaletteStorageSize = 0;
+    for ( const SceneNode& node : pScene->Nodes ) {
+        if ( node.MeshId == uint32_t( -1 ) ) {
+            continue;
+        }
+
+        const uint32_t skinId = pScene->Meshes[ node.MeshId ].SkinId;
+        if ( skinId == uint32_t( -1 ) || pScene->Skins[ skinId ].LinkIds.size( ) > maxBoneCount || IsSkinCulled( skinId ) ||
+             SkinPalettes.find( skinId ) != SkinPalettes.end( ) ) {
+            continue;
+        }
+
+        SkinPalette skinPalette;
+
+        if ( bBonePaletteSSBO ) {
+            // Only the offsets are known here, the storage range is allocated for all the skins below.
+            // The skin ranges are aligned to the matrix size, so the normal matrices can be indexed.
+            const uint32_t boneCount = uint32_t( pScene->Skins[ skinId ].LinkIds.size( ) );
+            bonePaletteStorageSize   = AlignedOffset( bonePaletteStorageSize, uint32_t( sizeof( XMFLOAT4X4 ) ) );
+
+            skinPalette.Offsets.BonePaletteOffset = bonePaletteStorageSize / uint32_t( sizeof( XMFLOAT4 ) );
+            bonePaletteStorageSize += bonePaletteStride * boneCount;
+            skinPalette.Offsets.BoneNormalOffset = bonePaletteStorageSize / uint32_t( sizeof( XMFLOAT4X4 ) );
+            bonePaletteStorageSize += boneNormalsStride * boneCount;
+
+            SkinPalettes[ skinId ] = skinPalette;
+            continue;
+        }
+
+        const uint32_t boneOffsetsRange = bonePaletteStride * maxBoneCount;
+        const uint32_t boneNormalsRange = boneNormalsStride * maxBoneCount;
+
+        skinPalette.BoneOffsets = frame.BufferPool.Suballocate( boneOffsetsRange, &skinPalette.pMappedBoneOffsets );
+        assert( VK_NULL_HANDLE != skinPalette.BoneOffsets.DescriptorBufferInfo.buffer );
+        skinPalette.BoneOffsets.DescriptorBufferInfo.range = boneOffsetsRange;
+
+        if ( boneNormalsRange ) {
+            skinPalette.BoneNormals = frame.BufferPool.Suballocate( boneNormalsRange, &skinPalette.pMappedBoneNormals );
+            assert( VK_NULL_HANDLE != skinPalette.BoneNormals.DescriptorBufferInfo.buffer );
+            skinPalette.BoneNormals.DescriptorBufferInfo.range = boneNormalsRange;
+        } else {
+            skinPalette.BoneNormals        = skinPalette.BoneOffsets;
+            skinPalette.pMappedBoneNormals = skinPalette.pMappedBoneOffsets;
+        }
+
+        if ( nullptr == skinPalette.pMappedBoneOffsets || nullptr == skinPalette.pMappedBoneNormals ) {
+            continue;
+        }
+
+        SkinPalettes[ skinId ] = skinPalette;
+    }
+
+    if ( bBonePaletteSSBO && bonePaletteStorageSize ) {
+        void* pMappedBonePalettes = nullptr;
+
+        const auto bonePaletteStorage = frame.BonePalettePool.Suballocate( bonePaletteStorageSize, &pMappedBonePalettes );
+        if ( nullptr == pMappedBonePalettes ) {
+            SkinPalettes.clear( );
+            return;
+        }
+
+        // The storage buffer is not dynamic, the descriptor set is the same for all the draws of the frame.
+        BonePaletteStorage        = bonePaletteStorage.DescriptorBufferInfo;
+        BonePaletteStorage.offset = bonePaletteStorage.DynamicOffset;
+        BonePaletteStorage.range  = bonePaletteStorageSize;
+
+        for ( auto& skinPalettePair : SkinPalettes ) {
+            SkinPalette& skinPalette       = skinPalettePair.second;
+            skinPalette.pMappedBoneOffsets = reinterpret_cast< XMFLOAT4* >( pMappedBonePalettes ) + skinPalette.Offsets.BonePaletteOffset;
+            skinPalette.pMappedBoneNormals = reinterpret_cast< XMFLOAT4X4* >( pMappedBonePalettes ) + skinPalette.Offsets.BoneNormalOffset;
+        }
+    }
+
+    const auto updateSkinPalette = [this, pScene, pTransformFrame]( const uint32_t skinId, const SkinPalette& skinPalette ) {
+        const SceneSkin& skin      = pScene->Skins[ skinId ];
+        const size_t     boneCount = skin.LinkIds.size( );
+
+        switch ( eBonePaletteFormat ) {
+            case eBonePaletteFormat_Affine3x4:
+                pScene->UpdateSkinAffineMatrices(
+                    skin, pTransformFrame, reinterpret_cast< XMFLOAT4* >( skinPalette.pMappedBoneOffsets ), boneCount );
+                break;
+            case eBonePaletteFormat_DualQuaternion:
+                pScene->UpdateSkinDualQuaternions(
+                    skin, pTransformFrame, reinterpret_cast< XMFLOAT4* >( skinPalette.pMappedBoneOffsets ), boneCount );
+                break;
+            default:
+                pScene->UpdateSkinMatrices( skin,
+                                            pTransformFrame,
+                                            reinterpret_cast< XMFLOAT4X4* >( skinPalette.pMappedBoneOffsets ),
+                                            reinterpret_cast< XMFLOAT4X4* >( skinPalette.pMappedBoneNormals ),
+                                            boneCount );
+                break;
+        }
+    };
+
+    tf::Taskflow* pDefaultTaskflow = apemode::AppState::Get( ) ? apemode::AppState::Get( )->GetDefaultTaskflow( ) : nullptr;
+    if ( !pDefaultTaskflow || SkinPalettes.size( ) < 2 ) {
+        for ( const auto& skinPalettePair : SkinPalettes ) {
+            updateSkinPalette( skinPalettePair.first, skinPalettePair.second );
+        }
+
+        return;
+    }
+
+    // The palettes are updated on the workers of the application taskflow, only the palette tasks are awaited.
+    tf::Taskflow taskflow( pDefaultTaskflow->share_executor( ) );
+    for ( const auto& skinPalettePair : SkinPalettes ) {
+        taskflow.silent_emplace( [&updateSkinPalette, &skinPalettePair] { updateSkinPalette( skinPalettePair.first, skinPalettePair.second ); } );
+    }
+
+    taskflow.wait_for_all( );
+}
+
 bool apemode::vk::SceneRenderer::RenderScene( const Scene*                            pScene,
                                               const RenderParameters*                 pParams,
                                               PipelineComposite&                      pipeline,
@@ -246,10 +436,10 @@ bool apemode::vk::SceneRenderer::RenderScene( const Scene*
 
         if ( mesh.SkinId != uint32_t( -1 ) ) {
             auto& skin = pScene->Skins[ mesh.SkinId ];
-            if ( skin.LinkIds.size( ) > kMaxBoneCount ) {
+            if ( !bBonePaletteSSBO && skin.LinkIds.size( ) > GetMaxBoneCount( eBonePaletteFormat ) ) {
                 apemodevk::platform::LogFmt( apemodevk::platform::Err,
                                              "The skin is too big, supported skeleton = %u, received = %u",
-                                             uint32_t( kMaxBoneCount ),
+                                             GetMaxBoneCount( eBonePaletteFormat ),
                                              uint32_t( skin.LinkIds.size( ) ) );
                 continue;
             }
@@ -263,7 +453,7 @@ bool apemode::vk::SceneRenderer::RenderScene( const Scene*
         //
 
         ObjectUBO objectData;
-        const XMMATRIX worldMatrix  = pTransformFrame->Transforms[ node.Id ].WorldMatrix;
+        const XMMATRIX worldMatrix  = pTransformFrame->GetWorldMatrix( node.Id );
         const XMMATRIX normalMatrix = XMMatrixTranspose( XMMatrixInverse( nullptr, worldMatrix ) );
 
         if ( mesh.SkinId != uint32_t( -1 ) ) {
@@ -287,56 +477,56 @@ bool apemode::vk::SceneRenderer::RenderScene( const Scene*
         if ( mesh.SkinId != uint32_t( -1 ) ) {
 
             //
-            // Calculate SkinnedObject
+            // SkinnedObject
+            // The palette was calculated and uploaded once for all the nodes of the skin (see UpdateSkinPalettes).
             //
 
             assert( HasFlagEq( pipeline.eFlags, PipelineComposite::kFlag_VertexType_FatSkinned ) ||
                     HasFlagEq( pipeline.eFlags, PipelineComposite::kFlag_VertexType_Skinned ) );
 
-            auto& skin = pScene->Skins[ mesh.SkinId ];
-            assert( skin.LinkIds.size( ) <= BoneOffsetMatrices.size( ) );
-            assert( skin.LinkIds.size( ) <= BoneNormalMatrices.size( ) );
-
-            pScene->UpdateSkinMatrices( skin,
-                                        pTransformFrame,
-                                        worldMatrix,
-                                        BoneOffsetMatrices.data( ),
-                                        BoneNormalMatrices.data( ),
-                                        kMaxBoneCount );
+            const auto skinPaletteIt = SkinPalettes.find( mesh.SkinId );
+            if ( skinPaletteIt == SkinPalettes.end( ) ) {
+                continue;
+            }
 
-            //
-            // Upload SkinnedObject
-            //
+            if ( bBonePaletteSSBO ) {
+                TDescriptorSetBindings< 2 > descriptorSetForSkinnedObj;
+                descriptorSetForSkinnedObj.pBinding[ 0 ].eDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER; /* 0 */
+                descriptorSetForSkinnedObj.pBinding[ 0 ].BufferInfo      = BonePaletteStorage;
 
-            const uint32_t boneOffsetsRange = uint32_t( sizeof( XMFLOAT4X4 ) * kMaxBoneCount );
-            const uint32_t boneNormalsRange = uint32_t( sizeof( XMFLOAT4X4 ) * kMaxBoneCount );
+                descriptorSetForSkinnedObj.pBinding[ 1 ].eDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER; /* 1 */
+                descriptorSetForSkinnedObj.pBinding[ 1 ].BufferInfo      = BonePaletteStorage;
 
-            apemodevk::HostBufferPool::SuballocResult boneOffsetsUploadBufferRange;
-            boneOffsetsUploadBufferRange = frame.BufferPool.Suballocate( BoneOffsetMatrices.data( ), boneOffsetsRange );
-            assert( VK_NULL_HANDLE != boneOffsetsUploadBufferRange.DescriptorBufferInfo.buffer );
-            boneOffsetsUploadBufferRange.DescriptorBufferInfo.range = boneOffsetsRange;
+                ppDescriptorSets[ kDescriptorSetForSkinnedObj ] =
+                    frame.DescriptorSetPools[ kDescriptorSetForSkinnedObj ].GetDescriptorSet( &descriptorSetForSkinnedObj );
 
-            apemodevk::HostBufferPool::SuballocResult boneNormalsUploadBufferRange;
-            boneNormalsUploadBufferRange = frame.BufferPool.Suballocate( BoneNormalMatrices.data( ), boneNormalsRange );
-            assert( VK_NULL_HANDLE != boneNormalsUploadBufferRange.DescriptorBufferInfo.buffer );
-            boneNormalsUploadBufferRange.DescriptorBufferInfo.range = boneNormalsRange;
+                pNode->vkCmdPushConstants( pParams->pCmdBuffer,
+                                           pipeline.pPipelineLayout,
+                                           VK_SHADER_STAGE_VERTEX_BIT,
+                                           0,
+                                           sizeof( BonePalettePC ),
+                                           &skinPaletteIt->second.Offsets );
+            } else {
+                const auto& boneOffsetsUploadBufferRange = skinPaletteIt->second.BoneOffsets;
+                const auto& boneNormalsUploadBufferRange = skinPaletteIt->second.BoneNormals;
 
-            pDynamicOffsets[ kDynamicOffset_BoneOffsetsUBO ] = boneOffsetsUploadBufferRange.DynamicOffset;
-            pDynamicOffsets[ kDynamicOffset_BoneNormalsUBO ] = boneNormalsUploadBufferRange.DynamicOffset;
+                pDynamicOffsets[ kDynamicOffset_BoneOffsetsUBO ] = boneOffsetsUploadBufferRange.DynamicOffset;
+                pDynamicOffsets[ kDynamicOffset_BoneNormalsUBO ] = boneNormalsUploadBufferRange.DynamicOffset;
 
-            //
-            // DescriptorSet SkinnedObject
-            //
+                //
+                // DescriptorSet SkinnedObject
+                //
 
-            TDescriptorSetBindings< 2 > descriptorSetForSkinnedObj;
-            descriptorSetForSkinnedObj.pBinding[ 0 ].eDescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; /* 0 */
-            descriptorSetForSkinnedObj.pBinding[ 0 ].BufferInfo      = boneOffsetsUploadBufferRange.DescriptorBufferInfo;
+                TDescriptorSetBindings< 2 > descriptorSetForSkinnedObj;
+                descriptorSetForSkinnedObj.pBinding[ 0 ].eDescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; /* 0 */
+                descriptorSetForSkinnedObj.pBinding[ 0 ].BufferInfo      = boneOffsetsUploadBufferRange.DescriptorBufferInfo;
 
-            descriptorSetForSkinnedObj.pBinding[ 1 ].eDescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; /* 1 */
-            descriptorSetForSkinnedObj.pBinding[ 1 ].BufferInfo      = boneNormalsUploadBufferRange.DescriptorBufferInfo;
+                descriptorSetForSkinnedObj.pBinding[ 1 ].eDescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; /* 1 */
+                descriptorSetForSkinnedObj.pBinding[ 1 ].BufferInfo      = boneNormalsUploadBufferRange.DescriptorBufferInfo;
 
-            ppDescriptorSets[ kDescriptorSetForSkinnedObj ] =
-                frame.DescriptorSetPools[ kDescriptorSetForSkinnedObj ].GetDescriptorSet( &descriptorSetForSkinnedObj );
+                ppDescriptorSets[ kDescriptorSetForSkinnedObj ] =
+                    frame.DescriptorSetPools[ kDescriptorSetForSkinnedObj ].GetDescriptorSet( &descriptorSetForSkinnedObj );
+            }
         }
 
         auto pSubsetIt    = pScene->Subsets.data( ) + mesh.BaseSubset;
@@ -482,7 +672,7 @@ bool apemode::vk::SceneRenderer::RenderScene( const Scene*
                 0,                               /* FirstSet */
                 mesh.SkinId != uint32_t( -1 ) ? kDescriptorSetCountForSkinned : kDescriptorSetCountForStatic, /* SetCount */
                 ppDescriptorSets,                                                                             /* Sets */
-                mesh.SkinId != uint32_t( -1 ) ? kDynamicOffsetSkinnedCount : kDynamicOffsetStaticCount, /* DymamicOffsetCount */
+                mesh.SkinId != uint32_t( -1 ) && !bBonePaletteSSBO ? kDynamicOffsetSkinnedCount : kDynamicOffsetStaticCount, /* DymamicOffsetCount */
                 pDynamicOffsets );                                                                      /* DymamicOffsets */
 
             VkBuffer     ppVertexBuffers[ 1 ] = {pMeshAsset->hVertexBuffer.Handle.pBuffer};
@@ -700,45 +890,30 @@ void TSetPipelineVertexInputStateCreateInfo< apemode::detail::FatSkinnedVertex >
     pPipelineVertexInputState->vertexAttributeDescriptionCount = location;
 }
 
-apemode::vector< uint8_t > GetPrecompiledShader( const apemode::platform::IAssetManager* pAssetManager,
-                                                 const char*                             pszPrecompiledShaderAsset ) {
-    auto compiledVertexShaderAsset = pAssetManager->Acquire( pszPrecompiledShaderAsset );
-    assert( compiledVertexShaderAsset );
-    if ( !compiledVertexShaderAsset ) {
-        apemodevk::platform::DebugBreak( );
-        return {};
-    }
+} // namespace
 
-    auto compiledVertexShader = compiledVertexShaderAsset->GetContentAsBinaryBuffer( );
-    assert( compiledVertexShader.size( ) );
-    pAssetManager->Release( compiledVertexShaderAsset );
-    if ( compiledVertexShader.empty( ) ) {
-        apemodevk::platform::DebugBreak( );
-        return {};
+uint32_t apemode::vk::SceneRenderer::GetMaxBoneCount( const EBonePaletteFormat eBonePaletteFormat ) {
+    switch ( eBonePaletteFormat ) {
+        case eBonePaletteFormat_Affine3x4:
+            return kMaxAffineBoneCount;
+        case eBonePaletteFormat_DualQuaternion:
+            return kMaxDualQuaternionBoneCount;
+        default:
+            return kMaxBoneCount;
     }
-
-    return eastl::move( compiledVertexShader );
 }
 
-apemodevk::THandle< VkShaderModule > CompileShader( apemodevk::GraphicsDevice*              pNode,
-                                                    const apemode::platform::IAssetManager* pAssetManager,
-                                                    const char*                             pszPrecompiledShaderAsset ) {
-    apemodevk::THandle< VkShaderModule > shaderModule;
-
-    auto precompiledShader = GetPrecompiledShader( pAssetManager, pszPrecompiledShaderAsset );
-    if ( !precompiledShader.empty( ) ) {
-        VkShaderModuleCreateInfo shaderModuleCreateInfo;
-        apemodevk::InitializeStruct( shaderModuleCreateInfo );
-        shaderModuleCreateInfo.pCode = reinterpret_cast< const uint32_t* >( precompiledShader.data( ) );
-        shaderModuleCreateInfo.codeSize = precompiledShader.size( );
-        shaderModule.Recreate( pNode->hLogicalDevice, shaderModuleCreateInfo );
+uint32_t apemode::vk::SceneRenderer::GetBonePaletteStride( const EBonePaletteFormat eBonePaletteFormat ) {
+    switch ( eBonePaletteFormat ) {
+        case eBonePaletteFormat_Affine3x4:
+            return uint32_t( sizeof( XMFLOAT4 ) * 3 );
+        case eBonePaletteFormat_DualQuaternion:
+            return uint32_t( sizeof( XMFLOAT4 ) * 2 );
+        default:
+            return uint32_t( sizeof( XMFLOAT4X4 ) );
     }
-
-    return eastl::move( shaderModule );
 }
 
-} // namespace
-
 bool apemode::vk::SceneRenderer::Recreate( const RecreateParametersBase* pParamsBase ) {
     using namespace apemodevk;
 
@@ -752,8 +927,9 @@ bool apemode::vk::SceneRenderer::Recreate( const RecreateParametersBase* pParams
 
     pNode = pParams->pNode;
 
-    BoneOffsetMatrices.resize( kMaxBoneCount );
-    BoneNormalMatrices.resize( kMaxBoneCount );
+    assert( pParams->eBonePaletteFormat < eBonePaletteFormatCount );
+    eBonePaletteFormat = pParams->eBonePaletteFormat;
+    bBonePaletteSSBO   = pParams->bBonePaletteSSBO;
 
     //
     // Initialize all the configurations that are supported.
@@ -777,8 +953,8 @@ bool apemode::vk::SceneRenderer::Recreate( const RecreateParametersBase* pParams
     //
 
     THandle< VkShaderModule > hVertexShaderModule = CompileShader( pNode, pParams->pAssetManager, "shaders/Viewer.cso.d/UScene.vert.spv" );
-    THandle< VkShaderModule > hSkinnedVertexShaderModule = CompileShader( pNode, pParams->pAssetManager, "shaders/Viewer.cso.d/UScene.vert-defs-SKINNING=1.spv" );
-    THandle< VkShaderModule > hSkinned8VertexShaderModule = CompileShader( pNode, pParams->pAssetManager, "shaders/Viewer.cso.d/UScene.vert-defs-SKINNING8=1.spv" );
+    THandle< VkShaderModule > hSkinnedVertexShaderModule = CompileShader( pNode, pParams->pAssetManager, bBonePaletteSSBO ? "shaders/Viewer.cso.d/UScene.vert-defs-BONE_PALETTE_SSBO=1+SKINNING=1.spv" : "shaders/Viewer.cso.d/UScene.vert-defs-SKINNING=1.spv" );
+    THandle< VkShaderModule > hSkinned8VertexShaderModule = CompileShader( pNode, pParams->pAssetManager, bBonePaletteSSBO ? "shaders/Viewer.cso.d/UScene.vert-defs-BONE_PALETTE_SSBO=1+SKINNING8=1.spv" : "shaders/Viewer.cso.d/UScene.vert-defs-SKINNING8=1.spv" );
     THandle< VkShaderModule > hFragmentShaderModule = CompileShader( pNode, pParams->pAssetManager, "shaders/Viewer.cso.d/UScene.frag.spv" );
 
     if ( hVertexShaderModule.IsNull( ) ||
@@ -789,21 +965,46 @@ bool apemode::vk::SceneRenderer::Recreate( const RecreateParametersBase* pParams
         return false;
     }
 
-    VkSpecializationInfo specializationInfo;
-    InitializeStruct( specializationInfo );
+    //
+    // layout( constant_id = 0 ) const int kBonePaletteVectorCount;
+    // layout( constant_id = 1 ) const int kBonePaletteFormat;
+    // layout( constant_id = 2 ) const int kBoneNormalCount;
+    //
+
+    struct SkinningSpecializationConstants {
+        int BonePaletteVectorCount;
+        int BonePaletteFormat;
+        int BoneNormalCount;
+    } skinningSpecializationConstants;
 
-    VkSpecializationMapEntry boneCountEntry;
-    InitializeStruct( boneCountEntry );
-    boneCountEntry.constantID = 0;
-    boneCountEntry.offset     = 0;
-    boneCountEntry.size       = sizeof( int );
+    const uint32_t maxBoneCount = GetMaxBoneCount( eBonePaletteFormat );
 
-    const int maxBoneCount = int( kMaxBoneCount );
+    skinningSpecializationConstants.BonePaletteVectorCount = int( GetBonePaletteStride( eBonePaletteFormat ) * maxBoneCount / sizeof( XMFLOAT4 ) );
+    skinningSpecializationConstants.BonePaletteFormat      = int( eBonePaletteFormat );
+    skinningSpecializationConstants.BoneNormalCount        = eBonePaletteFormat == eBonePaletteFormat_Matrix4x4 ? int( maxBoneCount ) : 1;
 
-    specializationInfo.pMapEntries   = &boneCountEntry;
-    specializationInfo.mapEntryCount = 1;
-    specializationInfo.pData         = &maxBoneCount;
-    specializationInfo.dataSize      = sizeof( maxBoneCount );
+    VkSpecializationMapEntry skinningSpecializationEntries[ 3 ];
+    InitializeStruct( skinningSpecializationEntries );
+
+    skinningSpecializationEntries[ 0 ].constantID = 0;
+    skinningSpecializationEntries[ 0 ].offset     = offsetof( SkinningSpecializationConstants, BonePaletteVectorCount );
+    skinningSpecializationEntries[ 0 ].size       = sizeof( int );
+
+    skinningSpecializationEntries[ 1 ].constantID = 1;
+    skinningSpecializationEntries[ 1 ].offset     = offsetof( SkinningSpecializationConstants, BonePaletteFormat );
+    skinningSpecializationEntries[ 1 ].size       = sizeof( int );
+
+    skinningSpecializationEntries[ 2 ].constantID = 2;
+    skinningSpecializationEntries[ 2 ].offset     = offsetof( SkinningSpecializationConstants, BoneNormalCount );
+    skinningSpecializationEntries[ 2 ].size       = sizeof( int );
+
+    VkSpecializationInfo specializationInfo;
+    InitializeStruct( specializationInfo );
+
+    specializationInfo.pMapEntries   = skinningSpecializationEntries;
+    specializationInfo.mapEntryCount = apemode::GetArraySize( skinningSpecializationEntries );
+    specializationInfo.pData         = &skinningSpecializationConstants;
+    specializationInfo.dataSize      = sizeof( skinningSpecializationConstants );
 
     //
     // Set 0 (Pass)
@@ -869,21 +1070,28 @@ bool apemode::vk::SceneRenderer::Recreate( const RecreateParametersBase* pParams
     }
 
     //
-    // Set 3 (SkinnedObject)
+    // Set 2 (SkinnedObject)
     //
-    // layout( std140, set = 3, binding = 0 ) uniform SkinnedObjectUBO;
+    // layout( std140, set = 2, binding = 0 ) uniform BoneOffsetsUBO;
+    // layout( std140, set = 2, binding = 1 ) uniform BoneNormalsUBO;
+    // or
+    // layout( std430, set = 2, binding = 0 ) readonly buffer BoneOffsetsSSBO;
+    // layout( std430, set = 2, binding = 1 ) readonly buffer BoneNormalsSSBO;
+
+    const VkDescriptorType eBonePaletteDescriptorType = bBonePaletteSSBO ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                                                                         : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 
     VkDescriptorSetLayoutBinding descriptorSetLayoutBindingsForSkinnedObj[ 2 ];
     InitializeStruct( descriptorSetLayoutBindingsForSkinnedObj );
 
     descriptorSetLayoutBindingsForSkinnedObj[ 0 ].binding         = 0;
     descriptorSetLayoutBindingsForSkinnedObj[ 0 ].descriptorCount = 1;
-    descriptorSetLayoutBindingsForSkinnedObj[ 0 ].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorSetLayoutBindingsForSkinnedObj[ 0 ].descriptorType  = eBonePaletteDescriptorType;
     descriptorSetLayoutBindingsForSkinnedObj[ 0 ].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
 
     descriptorSetLayoutBindingsForSkinnedObj[ 1 ].binding         = 1;
     descriptorSetLayoutBindingsForSkinnedObj[ 1 ].descriptorCount = 1;
-    descriptorSetLayoutBindingsForSkinnedObj[ 1 ].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorSetLayoutBindingsForSkinnedObj[ 1 ].descriptorType  = eBonePaletteDescriptorType;
     descriptorSetLayoutBindingsForSkinnedObj[ 1 ].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
 
     //
@@ -922,11 +1130,21 @@ bool apemode::vk::SceneRenderer::Recreate( const RecreateParametersBase* pParams
     staticPipelineLayoutCreateInfo.setLayoutCount = kDescriptorSetCountForStatic;
     staticPipelineLayoutCreateInfo.pSetLayouts    = ppDescriptorSetLayouts;
 
+    VkPushConstantRange bonePalettePushConstant;
+    InitializeStruct( bonePalettePushConstant );
+    bonePalettePushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    bonePalettePushConstant.size       = sizeof( BonePalettePC );
+
     VkPipelineLayoutCreateInfo skinnedPipelineLayoutCreateInfo;
     InitializeStruct( skinnedPipelineLayoutCreateInfo );
     skinnedPipelineLayoutCreateInfo.setLayoutCount = kDescriptorSetCountForSkinned;
     skinnedPipelineLayoutCreateInfo.pSetLayouts    = ppDescriptorSetLayouts;
 
+    if ( bBonePaletteSSBO ) {
+        skinnedPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        skinnedPipelineLayoutCreateInfo.pPushConstantRanges    = &bonePalettePushConstant;
+    }
+
     if ( !hPipelineLayouts[ kPipelineLayoutForStatic ].Recreate( *pNode, staticPipelineLayoutCreateInfo ) ||
          !hPipelineLayouts[ kPipelineLayoutForSkinned ].Recreate( *pNode, skinnedPipelineLayoutCreateInfo ) ) {
         assert( false );
@@ -1073,6 +1291,9 @@ bool apemode::vk::SceneRenderer::Recreate( const RecreateParametersBase* pParams
     Frames.resize( pParams->FrameCount );
     for ( auto & frame : Frames ) {
         frame.BufferPool.Recreate( pNode, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, false );
+        if ( bBonePaletteSSBO ) {
+            frame.BonePalettePool.Recreate( pNode, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false );
+        }
 
         if ( !frame.DescriptorSetPools[ kDescriptorSetForPass ].Recreate(
                  *pNode, pParams->pDescPool, hDescriptorSetLayouts[ kDescriptorSetForPass ] ) ) {
@@ -1095,11 +1316,13 @@ bool apemode::vk::SceneRenderer::Recreate( const RecreateParametersBase* pParams
 
 bool apemode::vk::SceneRenderer::Reset( const Scene* pScene, uint32_t frameIndex ) {
     Frames[ frameIndex ].BufferPool.Reset( );
+    Frames[ frameIndex ].BonePalettePool.Reset( );
     return true;
 }
 
 bool apemode::vk::SceneRenderer::Flush( const Scene* pScene, uint32_t frameIndex ) {
     Frames[ frameIndex ].BufferPool.Flush( );
+    Frames[ frameIndex ].BonePalettePool.Flush( );
     return true;
 }
 
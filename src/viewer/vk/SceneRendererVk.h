@@ -22,16 +22,29 @@ public:
     SceneRenderer( )          = default;
     virtual ~SceneRenderer( ) = default;
 
+    /* Bone palette encoding, passed to the skinning shaders as the specialization constant.
+     */
+    enum EBonePaletteFormat {
+        eBonePaletteFormat_Matrix4x4,      /* Offset and normal 4x4 matrices (128 bytes per bone). */
+        eBonePaletteFormat_Affine3x4,      /* Offset 3x4 matrices, the normal matrices are derived in the shader (48 bytes per bone). */
+        eBonePaletteFormat_DualQuaternion, /* Rigid transforms without scaling (32 bytes per bone). */
+        eBonePaletteFormatCount,
+    };
+
     struct RecreateParameters : RecreateParametersBase {
-        apemodevk::GraphicsDevice*        pNode         = nullptr;        /* Required. */
-        apemode::platform::IAssetManager* pAssetManager = nullptr;        /* Required. */
-        VkDescriptorPool                  pDescPool     = VK_NULL_HANDLE; /* Required. */
-        VkRenderPass                      pRenderPass   = VK_NULL_HANDLE; /* Required. */
-        uint32_t                          FrameCount    = 0;              /* Required. */
+        apemodevk::GraphicsDevice*        pNode              = nullptr;                      /* Required. */
+        apemode::platform::IAssetManager* pAssetManager      = nullptr;                      /* Required. */
+        VkDescriptorPool                  pDescPool          = VK_NULL_HANDLE;               /* Required. */
+        VkRenderPass                      pRenderPass        = VK_NULL_HANDLE;               /* Required. */
+        uint32_t                          FrameCount         = 0;                            /* Required. */
+        EBonePaletteFormat                eBonePaletteFormat = eBonePaletteFormat_Matrix4x4; /* Optional. */
+        bool                              bBonePaletteSSBO   = false;                        /* Optional. */
     };
 
     bool Recreate( const RecreateParametersBase* pParams ) override;
 
+    struct DeviceBonePalettes;
+
     struct RenderParameters : SceneRenderParametersBase {
         class EnvMap {
         public:
@@ -55,6 +68,8 @@ public:
         XMFLOAT4                       LightDirection;              /* Required. */
         XMFLOAT4                       LightColor;                  /* Required. */
         const SceneNodeTransformFrame* pTransformFrame = nullptr;   /* Ok (BindPose). */
+        const DeviceBonePalettes*      pDeviceBonePalettes = nullptr; /* Optional (bBonePaletteSSBO, Matrix4x4). */
+        const SceneSkinBounds*         pSkinBounds         = nullptr; /* Optional (world space, see Scene::UpdateSkinBounds). */
     };
 
     bool Reset( const Scene* pScene, uint32_t FrameIndex ) override;
@@ -75,15 +90,50 @@ public:
     static constexpr uint32_t kPipelineLayoutForStatic  = 0;
     static constexpr uint32_t kPipelineLayoutForSkinned = 1;
 
-    // TODO: Set as pecialization constant.
-    // static constexpr uint32_t kBoneCount = 64;
-    static const uint32_t kMaxBoneCount = 128;
+    /* The bone count is limited by the UBO range (16KB is guaranteed), compact palettes fit more bones.
+     * The storage buffer palettes (bBonePaletteSSBO) have no limit.
+     */
+    static const uint32_t kMaxBoneCount               = 128;
+    static const uint32_t kMaxAffineBoneCount         = 256;
+    static const uint32_t kMaxDualQuaternionBoneCount = 512;
+
+    static uint32_t GetMaxBoneCount( EBonePaletteFormat eBonePaletteFormat );
+    static uint32_t GetBonePaletteStride( EBonePaletteFormat eBonePaletteFormat );
 
     struct Frame {
         apemodevk::HostBufferPool    BufferPool;
+        apemodevk::HostBufferPool    BonePalettePool; /* Storage buffers for the skin palettes (if bBonePaletteSSBO). */
         apemodevk::DescriptorSetPool DescriptorSetPools[ kDescriptorSetCount ];
     };
 
+    /* Push constants of the skinned pipelines (if bBonePaletteSSBO).
+     */
+    struct BonePalettePC {
+        uint32_t BonePaletteOffset; /* In vectors. */
+        uint32_t BoneNormalOffset;  /* In matrices. */
+    };
+
+    /* Skin palettes calculated on the device (see SceneAnimator), in the layout of the storage buffer palettes.
+     * The palettes are used instead of the ones calculated from the transform frame.
+     */
+    struct DeviceBonePalettes {
+        VkDescriptorBufferInfo Storage      = {VK_NULL_HANDLE, 0, 0};
+        const BonePalettePC*   pSkinOffsets = nullptr; /* By skin ID. */
+    };
+
+    /* SkinPalette struct contains the uploaded matrices of the skin for the current frame.
+     * Each skin palette is calculated and uploaded once, all the nodes of the skin reference it.
+     * The compact palettes have no normal matrices, BoneNormals references the BoneOffsets range.
+     * The storage buffer palettes are placed in the shared frame range, and referenced by the offsets.
+     */
+    struct SkinPalette {
+        apemodevk::HostBufferPool::SuballocResult BoneOffsets;
+        apemodevk::HostBufferPool::SuballocResult BoneNormals;
+        void*                                     pMappedBoneOffsets = nullptr;
+        void*                                     pMappedBoneNormals = nullptr;
+        BonePalettePC                             Offsets            = {0, 0};
+    };
+
     struct PipelineComposite {
         enum FlagBits {
             /* Vertex */
@@ -109,6 +159,20 @@ public:
         PipelineComposite& operator=( PipelineComposite&& other );
     };
 
+    /* Calculates and uploads the palettes of the skins used by the nodes, the skins are processed in parallel.
+     * The device palettes are referenced instead, if provided.
+     */
+    void UpdateSkinPalettes( const Scene*                            pScene,
+                             Frame&                                  frame,
+                             const apemode::SceneNodeTransformFrame* pTransformFrame,
+                             const DeviceBonePalettes*               pDeviceBonePalettes = nullptr );
+
+    /* Returns true if the skin bounds are outside of the view volume in the current frame (its nodes and palettes are skipped).
+     */
+    inline bool IsSkinCulled( const uint32_t skinId ) const {
+        return skinId < CulledSkins.size( ) && CulledSkins[ skinId ];
+    }
+
     bool RenderScene( const Scene*                            pScene,
                       const RenderParameters*                 pParams,
                       PipelineComposite&                      pipeline,
@@ -121,8 +185,11 @@ public:
     apemodevk::THandle< VkPipelineLayout >           hPipelineLayouts[ kPipelineLayoutCount ];
     apemodevk::THandle< VkDescriptorSetLayout >      hDescriptorSetLayouts[ kDescriptorSetCount ];
     apemodevk::vector_multimap< uint32_t, uint32_t > SortedNodeIds;
-    apemodevk::vector< XMFLOAT4X4 >                  BoneOffsetMatrices;
-    apemodevk::vector< XMFLOAT4X4 >                  BoneNormalMatrices;
+    apemodevk::vector_map< uint32_t, SkinPalette >   SkinPalettes;
+    apemodevk::vector< uint8_t >                     CulledSkins; /* By skin ID. */
+    EBonePaletteFormat                               eBonePaletteFormat = eBonePaletteFormat_Matrix4x4;
+    bool                                             bBonePaletteSSBO   = false;
+    VkDescriptorBufferInfo                           BonePaletteStorage = {VK_NULL_HANDLE, 0, 0};
 };
 
 } // namespace vk
@@ -773,6 +773,11 @@ InitializedMeshInfo InitializeMesh( apemode::SceneMesh&
         }
     }
 
+    // The vertices are decoded here, the bone bounds of the skin are extended with them (for the skin bounds per frame).
+    pScene->UpdateSkinBoneBounds( mesh.Id,
+                                  initializedMeshInfo.VertexUploadInfo.pSrcBufferData,
+                                  size_t( initializedMeshInfo.VertexUploadInfo.SrcBufferSize ) );
+
     initializedMeshInfo.VertexUploadInfo.eDstAccessFlags = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
     initializedMeshInfo.IndexUploadInfo.eDstAccessFlags  = VK_ACCESS_INDEX_READ_BIT;
 
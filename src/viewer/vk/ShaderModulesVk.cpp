@@ -0,0 +1,38 @@
+#include "ShaderModulesVk.h"
+
+apemode::vector< uint8_t > apemode::vk::GetPrecompiledShader( const apemode::platform::IAssetManager* pAssetManager,
+                                                              const char*                             pszPrecompiledShaderAsset ) {
+    auto compiledShaderAsset = pAssetManager->Acquire( pszPrecompiledShaderAsset );
+    assert( compiledShaderAsset );
+    if ( !compiledShaderAsset ) {
+        apemodevk::platform::DebugBreak( );
+        return {};
+    }
+
+    auto compiledShader = compiledShaderAsset->GetContentAsBinaryBuffer( );
+    assert( compiledShader.size( ) );
+    pAssetManager->Release( compiledShaderAsset );
+    if ( compiledShader.empty( ) ) {
+        apemodevk::platform::DebugBreak( );
+        return {};
+    }
+
+    return eastl::move( compiledShader );
+}
+
+apemodevk::THandle< VkShaderModule > apemode::vk::CompileShader( apemodevk::GraphicsDevice*              pNode,
+                                                                 const apemode::platform::IAssetManager* pAssetManager,
+                                                                 const char*                             pszPrecompiledShaderAsset ) {
+    apemodevk::THandle< VkShaderModule > shaderModule;
+
+    auto precompiledShader = GetPrecompiledShader( pAssetManager, pszPrecompiledShaderAsset );
+    if ( !precompiledShader.empty( ) ) {
+        VkShaderModuleCreateInfo shaderModuleCreateInfo;
+        apemodevk::InitializeStruct( shaderModuleCreateInfo );
+        shaderModuleCreateInfo.pCode    = reinterpret_cast< const uint32_t* >( precompiledShader.data( ) );
+        shaderModuleCreateInfo.codeSize = precompiledShader.size( );
+        shaderModule.Recreate( pNode->hLogicalDevice, shaderModuleCreateInfo );
+    }
+
+    return eastl::move( shaderModule );
+}
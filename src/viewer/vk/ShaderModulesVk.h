@@ -0,0 +1,23 @@
+#pragma once
+
+#include <apemode/vk/GraphicsDevice.Vulkan.h>
+#include <apemode/vk/THandle.Vulkan.h>
+
+#include <apemode/platform/IAssetManager.h>
+
+namespace apemode {
+namespace vk {
+
+/* Returns the contents of the precompiled shader asset (SPIR-V, see Viewer.cso.json), or an empty buffer if it is missing.
+ */
+apemode::vector< uint8_t > GetPrecompiledShader( const apemode::platform::IAssetManager* pAssetManager,
+                                                 const char*                             pszPrecompiledShaderAsset );
+
+/* Creates the shader module from the precompiled shader asset, the handle is empty if the asset is missing.
+ */
+apemodevk::THandle< VkShaderModule > CompileShader( apemodevk::GraphicsDevice*              pNode,
+                                                    const apemode::platform::IAssetManager* pAssetManager,
+                                                    const char*                             pszPrecompiledShaderAsset );
+
+} // namespace vk
+} // namespace apemode
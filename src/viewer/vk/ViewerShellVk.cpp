@@ -210,6 +210,7 @@ bool ViewerShell::Initialize( const apemode::PlatformSurface* pPlatformSurface )
         descPoolInitParameters.MaxDescriptorSetCount                                               = 1024;
         descPoolInitParameters.MaxDescriptorPoolSizes[ VK_DESCRIPTOR_TYPE_SAMPLER ]                = 64;
         descPoolInitParameters.MaxDescriptorPoolSizes[ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ] = 1024;
+        descPoolInitParameters.MaxDescriptorPoolSizes[ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ]         = 64;
         descPoolInitParameters.MaxDescriptorPoolSizes[ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ]          = 512;
         descPoolInitParameters.MaxDescriptorPoolSizes[ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ] = 512;
 
@@ -342,6 +343,15 @@ bool ViewerShell::Initialize( const apemode::PlatformSurface* pPlatformSurface )
         recreateParams.pDescPool     = DescriptorPool;
         recreateParams.FrameCount    = uint32_t( Frames.size( ) );
 
+        const std::string bonePaletteFormat = TGetOption< std::string >( "bone-palette", "" );
+        if ( bonePaletteFormat == "affine" ) {
+            recreateParams.eBonePaletteFormat = apemode::vk::SceneRenderer::eBonePaletteFormat_Affine3x4;
+        } else if ( bonePaletteFormat == "dq" ) {
+            recreateParams.eBonePaletteFormat = apemode::vk::SceneRenderer::eBonePaletteFormat_DualQuaternion;
+        }
+
+        recreateParams.bBonePaletteSSBO = TGetOption< bool >( "bone-palette-ssbo", false );
+
         /*
         --assets "/Users/vlad.serhiienko/Projects/Home/Viewer/assets" --scene
         "/Users/vlad.serhiienko/Projects/Home/Models/FbxPipeline/rainier-ak-3d.fbxp"
@@ -387,8 +397,75 @@ bool ViewerShell::Initialize( const apemode::PlatformSurface* pPlatformSurface )
         // const std::string sceneFile = "shared/0005.fbxp";
         const std::string sceneFile = "shared/scene.fbxp";
         // TGetOption< std::string >( "scene", "" );
+        // Quantized animation tracks are optional, the error budget is in the property units (degrees for rotations).
+        apemode::SceneLoadOptions sceneLoadOptions;
+        sceneLoadOptions.bQuantizeAnimTracks       = TGetOption< bool >( "quantize-anim", false );
+        sceneLoadOptions.AnimTrackSampleRate       = TGetOption< float >( "quantize-anim-rate", sceneLoadOptions.AnimTrackSampleRate );
+        sceneLoadOptions.AnimTrackErrorBudget      = TGetOption< float >( "quantize-anim-error", sceneLoadOptions.AnimTrackErrorBudget );
+        sceneLoadOptions.bKeepNonContributingNodes = TGetOption< bool >( "keep-helper-nodes", false );
+        sceneLoadOptions.bParallelLoading          = !TGetOption< bool >( "serial-scene-loading", false );
+        sceneLoadOptions.bValidateAnimCurves       = TGetOption< bool >( "validate-anim-curves", false );
+
+        // The curve simplification is checked on the known case before validating the curves of the scene.
+        if ( sceneLoadOptions.bValidateAnimCurves && !apemode::utils::CheckAnimCurveKeySimplification( ) ) {
+            LogError( "ViewerShell: The curve simplification dropped the keys of the step curve." );
+        }
+
+        // The scene file is mapped (the payloads are not copied), it is read to memory if the mapping fails.
         auto pSceneAsset = pAssetManager->Acquire( sceneFile.c_str() );
-        mLoadedScene = LoadSceneFromBin( pSceneAsset->GetContentAsBinaryBuffer() );
+        auto pMappedScene = TGetOption< bool >( "no-scene-mmap", false ) ? nullptr : pSceneAsset->MapContent( );
+        if ( pMappedScene ) {
+            mLoadedScene = LoadSceneFromMappedBin( std::move( pMappedScene ), sceneLoadOptions );
+        } else {
+            mLoadedScene = LoadSceneFromBin( pSceneAsset->GetContentAsBinaryBuffer(), sceneLoadOptions );
+        }
+        if ( mLoadedScene.pScene ) {
+            mLoadedScene.pScene->InitializeAnimCursor( SceneAnimCursor );
+        }
+
+        bParallelTransforms = !TGetOption< bool >( "serial-transforms", false );
+
+        // The skinned nodes outside of the view are skipped (the skin bounds are calculated from the bone bounds per frame).
+        bSkinCulling = !TGetOption< bool >( "no-skin-culling", false );
+
+        // Samples the animation at the fixed rate (samples per second), and blends the samples for rendering.
+        const float poseCacheRate = TGetOption< float >( "pose-cache-rate", 0.0f );
+        bPoseCache = mLoadedScene.pScene && poseCacheRate > 0;
+        if ( bPoseCache ) {
+            mLoadedScene.pScene->InitializePoseCache( ScenePoseCache, poseCacheRate );
+        }
+
+        // Reduces the update rate of the distant skins, and skips their small leaf bones.
+        bAnimLod = mLoadedScene.pScene && TGetOption< bool >( "anim-lod", false );
+        if ( bAnimLod ) {
+            const float minBoneInfluence = TGetOption< float >( "anim-lod-bone-influence", 0.05f );
+
+            apemode::SceneAnimLod::Level animLodLevels[ 4 ];
+            animLodLevels[ 0 ].MinScreenSize    = 256;
+            animLodLevels[ 1 ].MinScreenSize    = 96;
+            animLodLevels[ 1 ].SampleRate       = 30;
+            animLodLevels[ 1 ].MinBoneInfluence = minBoneInfluence;
+            animLodLevels[ 2 ].MinScreenSize    = 32;
+            animLodLevels[ 2 ].SampleRate       = 15;
+            animLodLevels[ 2 ].MinBoneInfluence = minBoneInfluence;
+            animLodLevels[ 3 ].MinScreenSize    = 0;
+            animLodLevels[ 3 ].SampleRate       = 7.5f;
+            animLodLevels[ 3 ].MinBoneInfluence = minBoneInfluence;
+
+            mLoadedScene.pScene->InitializeAnimLod( SceneAnimLod, animLodLevels, apemodevk::utils::GetArraySizeU( animLodLevels ) );
+        }
+
+        // Compares the takes: plays the first animation stack, and cross-fades to the second one (the duration is in seconds).
+        const float animCrossFadeDuration = TGetOption< float >( "anim-crossfade", 0.0f );
+        bAnimBlend = mLoadedScene.pScene && animCrossFadeDuration > 0 && mLoadedScene.pScene->HasAnimStackLayer( 1, kAnimLayerId );
+        if ( bAnimBlend ) {
+            SceneAnimBlend.Inputs.resize( 2 );
+            SceneAnimBlend.Inputs[ 0 ].AnimStackId = 0;
+            SceneAnimBlend.Inputs[ 0 ].AnimLayerId = kAnimLayerId;
+            SceneAnimBlend.Inputs[ 1 ].AnimStackId = 1;
+            SceneAnimBlend.Inputs[ 1 ].AnimLayerId = kAnimLayerId;
+            SceneAnimBlend.CrossFade( 0, 1, animCrossFadeDuration, animCrossFadeDuration );
+        }
 
         apemode::vk::SceneUploader::UploadParameters uploadParams;
         uploadParams.pSamplerManager = pSamplerManager.get( );
@@ -402,6 +479,67 @@ bool ViewerShell::Initialize( const apemode::PlatformSurface* pPlatformSurface )
             return false;
         }
 
+        // The meshes and the textures are on the device, their pages in the mapped file are not needed.
+        DiscardUploadedPayloads( mLoadedScene );
+
+        // Evaluates the animation and the skin palettes with the compute shader (the storage buffer palettes of 4x4 matrices only).
+        // The instances share the scene, their times are offset, only the first instance is rendered.
+        bGpuAnim = mLoadedScene.pScene && TGetOption< bool >( "gpu-anim", false ) &&
+                   mLoadedScene.pScene->HasAnimStackLayer( kAnimStackId, kAnimLayerId );
+        if ( bGpuAnim && ( !recreateParams.bBonePaletteSSBO ||
+                           recreateParams.eBonePaletteFormat != apemode::vk::SceneRenderer::eBonePaletteFormat_Matrix4x4 ) ) {
+            LogWarn( "ViewerShell: GPU animation requires --bone-palette-ssbo with the default palette format." );
+            bGpuAnim = false;
+        }
+
+        if ( bGpuAnim ) {
+            apemode::vk::SceneAnimator::RecreateParameters animatorRecreateParams;
+            animatorRecreateParams.pNode         = &Surface.Node;
+            animatorRecreateParams.pAssetManager = pAssetManager;
+            animatorRecreateParams.pDescPool     = DescriptorPool;
+            animatorRecreateParams.pScene        = mLoadedScene.pScene.get( );
+            animatorRecreateParams.AnimStackId   = kAnimStackId;
+            animatorRecreateParams.AnimLayerId   = kAnimLayerId;
+            animatorRecreateParams.InstanceCount = uint32_t( std::max( 1, TGetOption< int >( "gpu-anim-instances", 1 ) ) );
+
+            pSceneAnimator = apemode::make_unique< apemode::vk::SceneAnimator >( );
+            if ( ! pSceneAnimator->Recreate( &animatorRecreateParams ) ) {
+                LogWarn( "ViewerShell: Failed to create the GPU animation, the animation is evaluated on CPU." );
+                pSceneAnimator = nullptr;
+                bGpuAnim       = false;
+            } else {
+                SceneAnimTimes.resize( pSceneAnimator->InstanceCount, 0.0f );
+            }
+        }
+
+        // The palettes are compared to the CPU ones at a few time values (including the looped ones), the animation falls back to CPU on mismatch.
+        if ( bGpuAnim && TGetOption< bool >( "gpu-anim-validate", true ) ) {
+            const float tolerance = TGetOption< float >( "gpu-anim-tolerance", apemode::vk::SceneAnimator::kValidationTolerance );
+            for ( const float validationTime : {0.0f, 1.0f, 2.5f, 25.0f} ) {
+                float maxError = -1;
+                const bool bValid = pSceneAnimator->Validate( mLoadedScene.pScene.get( ), validationTime, tolerance, &maxError );
+                LogInfo( "ViewerShell: GPU animation validation: time = {}, max error = {}, tolerance = {}", validationTime, maxError, tolerance );
+
+                if ( !bValid ) {
+                    LogWarn( "ViewerShell: GPU animation does not match the CPU one, the animation is evaluated on CPU." );
+                    pSceneAnimator = nullptr;
+                    bGpuAnim       = false;
+                    break;
+                }
+            }
+        }
+
+        // The compute shader evaluates the skin palettes only, the world matrices of the rigid meshes are still evaluated on CPU.
+        bGpuAnimRigid = false;
+        if ( bGpuAnim ) {
+            for ( const apemode::SceneNode& node : mLoadedScene.pScene->Nodes ) {
+                if ( node.MeshId != uint32_t( -1 ) && mLoadedScene.pScene->Meshes[ node.MeshId ].SkinId == uint32_t( -1 ) ) {
+                    bGpuAnimRigid = true;
+                    break;
+                }
+            }
+        }
+
         apemode::vk::SkyboxRenderer::RecreateParameters skyboxRendererRecreateParams;
         skyboxRendererRecreateParams.pNode         = &Surface.Node;
         skyboxRendererRecreateParams.pAssetManager = pAssetManager;
@@ -721,9 +859,30 @@ void ViewerShell::UpdateTime( ) {
 
 void ViewerShell::UpdateScene( ) {
     if ( mLoadedScene.pScene ) {
-        if (mLoadedScene.pScene->HasAnimStackLayer(kAnimStackId, kAnimLayerId) ) {
-            mLoadedScene.pScene->UpdateTransformProperties( TotalSecs, true, kAnimStackId, kAnimLayerId, &SceneTransformFrame );
-            mLoadedScene.pScene->UpdateTransformMatrices( SceneTransformFrame );
+        // The skin palettes are evaluated with the compute shader (see Populate), the frame is needed for the rigid meshes only.
+        if ( ( !bGpuAnim || bGpuAnimRigid ) && mLoadedScene.pScene->HasAnimStackLayer(kAnimStackId, kAnimLayerId) ) {
+            if ( bAnimBlend ) {
+                mLoadedScene.pScene->UpdateTransformPropertiesBlended( TotalSecs, true, &SceneAnimBlend, &SceneTransformFrame );
+            } else if ( bAnimLod ) {
+                // The levels are selected with the skin positions of the previous frame.
+                const float extentH     = float( Surface.Swapchain.ImgExtent.height );
+                const auto  projMatrix  = CamProjController.ProjMatrix( float( Surface.Swapchain.ImgExtent.width ), extentH );
+                const float focalLength = fabsf( XMVectorGetY( projMatrix.r[ 1 ] ) ) * extentH * 0.5f;
+
+                mLoadedScene.pScene->UpdateAnimLod( SceneAnimLod, SceneTransformFrame, pCamController->ViewMatrix( ), focalLength );
+                mLoadedScene.pScene->UpdateTransformPropertiesLod( TotalSecs, true, kAnimStackId, kAnimLayerId, &SceneTransformFrame, &SceneAnimLod, &SceneAnimCursor );
+            } else if ( bPoseCache ) {
+                mLoadedScene.pScene->UpdateTransformPropertiesCached( TotalSecs, true, kAnimStackId, kAnimLayerId, &SceneTransformFrame, &ScenePoseCache );
+            } else {
+                mLoadedScene.pScene->UpdateTransformProperties( TotalSecs, true, kAnimStackId, kAnimLayerId, &SceneTransformFrame, &SceneAnimCursor );
+            }
+
+            // The parallel update returns after all the jobs are completed, the frame is ready for rendering.
+            if ( bParallelTransforms ) {
+                mLoadedScene.pScene->UpdateTransformMatricesParallel( SceneTransformFrame );
+            } else {
+                mLoadedScene.pScene->UpdateTransformMatrices( SceneTransformFrame );
+            }
         }
     }
 }
@@ -768,13 +927,26 @@ void ViewerShell::Populate( const apemode::SceneNodeTransformFrame* pTransformFr
     renderPassBeginInfo.clearValueCount          = 2;
     renderPassBeginInfo.pClearValues             = clearValue;
 
+    // The compute passes are recorded outside of the render pass.
+    const bool bGpuAnimFrame = bGpuAnim && bEnableAnimations;
+    if ( bGpuAnimFrame ) {
+        for ( uint32_t i = 0; i < uint32_t( SceneAnimTimes.size( ) ); ++i ) {
+            SceneAnimTimes[ i ] = TotalSecs + 0.25f * float( i );
+        }
+
+        apemode::vk::SceneAnimator::UpdateParameters animatorUpdateParams;
+        animatorUpdateParams.pCmdBuffer = pCmdBuffer;
+        animatorUpdateParams.pTimes     = SceneAnimTimes.data( );
+        pSceneAnimator->Update( &animatorUpdateParams );
+    }
+
     vkCmdBeginRenderPass( pCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
 
     const XMFLOAT2 extentF{float( Surface.Swapchain.ImgExtent.width ), float( Surface.Swapchain.ImgExtent.height )};
 
     auto viewMatrix     = pCamController->ViewMatrix( );
     auto invViewMatrix  = XMMatrixInverse( nullptr, viewMatrix );
-    auto projMatrix     = CamProjController.ProjMatrix( 55, extentF.x, extentF.y, 0.1f, 1000.0f );
+    auto projMatrix     = CamProjController.ProjMatrix( extentF.x, extentF.y );
     auto projBiasMatrix = CamProjController.ProjBiasMatrix( );
     auto invProjMatrix  = XMMatrixInverse( nullptr, projMatrix );
 
@@ -818,6 +990,15 @@ void ViewerShell::Populate( const apemode::SceneNodeTransformFrame* pTransformFr
     sceneRenderParameters.LightColor                = LightColor;
     sceneRenderParameters.LightDirection            = LightDirection;
     sceneRenderParameters.pTransformFrame           = pTransformFrame;
+    sceneRenderParameters.pDeviceBonePalettes       = bGpuAnimFrame ? pSceneAnimator->GetDeviceBonePalettes( ) : nullptr;
+
+    // The bones of the GPU animation are not known on CPU, the skins are not culled.
+    if ( bSkinCulling && !bGpuAnimFrame && mLoadedScene.pScene ) {
+        mLoadedScene.pScene->UpdateSkinBounds( pTransformFrame ? *pTransformFrame : mLoadedScene.pScene->GetBindPoseTransformFrame( ),
+                                               SceneSkinBounds );
+        sceneRenderParameters.pSkinBounds = &SceneSkinBounds;
+    }
+
     XMStoreFloat4x4( &sceneRenderParameters.ProjMatrix, projMatrix );
     XMStoreFloat4x4( &sceneRenderParameters.ViewMatrix, viewMatrix );
     XMStoreFloat4x4( &sceneRenderParameters.InvViewMatrix, invViewMatrix );
@@ -934,7 +1115,7 @@ bool ViewerShell::Update( const VkExtent2D currentExtent, const apemode::platfor
     Frame& swapchainFrame = Frames[ currentFrame.BackbufferIndex ];
 
     const SceneNodeTransformFrame* pTrasformFrame =
-        bEnableAnimations && mLoadedScene.pScene->HasAnimStackLayer( kAnimStackId, kAnimLayerId ) ? &SceneTransformFrame  : 0;
+        bEnableAnimations && ( !bGpuAnim || bGpuAnimRigid ) && mLoadedScene.pScene->HasAnimStackLayer( kAnimStackId, kAnimLayerId ) ? &SceneTransformFrame  : 0;
 
     const uint32_t       queueFamilyId               = 0;
     VkPipelineStageFlags eColorAttachmentOutputStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -12,6 +12,7 @@
 #include <apemode/vk_ext/SamplerManager.Vulkan.h>
 
 #include <viewer/vk/NuklearRendererVk.h>
+#include <viewer/vk/SceneAnimatorVk.h>
 #include <viewer/vk/DebugRendererVk.h>
 #include <viewer/vk/SceneRendererVk.h>
 #include <viewer/vk/SceneUploaderVk.h>
@@ -108,15 +109,29 @@ namespace vk {
         VkSampler                                                 pRadianceCubeMapSampler   = VK_NULL_HANDLE;
         VkSampler                                                 pIrradianceCubeMapSampler = VK_NULL_HANDLE;
         apemode::unique_ptr< apemode::vk::SceneRenderer >         pSceneRenderer;
+        apemode::unique_ptr< apemode::vk::SceneAnimator >         pSceneAnimator;
         apemode::unique_ptr< apemode::vk::NuklearRenderer >       pNkRenderer;
         apemode::unique_ptr< apemode::vk::Skybox >                pSkybox;
         apemode::unique_ptr< apemode::vk::SkyboxRenderer >        pSkyboxRenderer;
         apemode::unique_ptr< apemode::vk::DebugRenderer >         pDebugRenderer;
 
-        const bool                       bLookAnimation = false;
-        bool                             bIsUsingUI     = false;
+        const bool                       bLookAnimation      = false;
+        bool                             bIsUsingUI          = false;
+        bool                             bParallelTransforms = true;
+        bool                             bPoseCache          = false;
+        bool                             bAnimLod            = false;
+        bool                             bAnimBlend          = false;
+        bool                             bGpuAnim            = false;
+        bool                             bGpuAnimRigid       = false;
+        bool                             bSkinCulling        = true;
         LoadedScene                      mLoadedScene;
         apemode::SceneNodeTransformFrame SceneTransformFrame;
+        apemode::SceneAnimCursor         SceneAnimCursor;
+        apemode::ScenePoseCache          ScenePoseCache;
+        apemode::SceneAnimLod            SceneAnimLod;
+        apemode::SceneAnimBlend          SceneAnimBlend;
+        apemode::vector< float >         SceneAnimTimes; /* GPU animation, one for each instance. */
+        apemode::SceneSkinBounds         SceneSkinBounds;
     };
 
 } // namespace vk